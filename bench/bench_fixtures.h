@@ -0,0 +1,164 @@
+#ifndef __BENCH_FIXTURES__
+#define __BENCH_FIXTURES__
+
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#pragma once
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "collision.h"
+#include "model.h"
+
+namespace bench {
+
+using namespace std::literals;
+
+// Решётка дорог size x size кварталов: горизонтальные и вертикальные дороги через каждые step единиц
+inline std::vector<model::Road> MakeGridRoads(int size, int step = 10) {
+    std::vector<model::Road> roads;
+    const int length = size * step;
+
+    for (int i = 0; i <= size; ++i) {
+        roads.emplace_back(model::Road::HORIZONTAL, model::Point{0, i * step}, length);
+        roads.emplace_back(model::Road::VERTICAL, model::Point{i * step, 0}, length);
+    }
+    return roads;
+}
+
+inline model::RoadGrid MakeRoadGrid(int size, int step = 10) {
+    model::RoadGrid grid;
+    for (const auto& road : MakeGridRoads(size, step)) {
+        grid.AddRoad(road);
+    }
+    return grid;
+}
+
+// Карта с решёткой дорог и зданиями внутри кварталов
+inline model::Map MakeGridMap(std::string id, int size, int step = 10) {
+    model::Map map{model::Map::Id{id}, "Grid "s + id};
+
+    for (const auto& road : MakeGridRoads(size, step)) {
+        map.AddRoad(road);
+    }
+    for (int x = 0; x < size; ++x) {
+        for (int y = 0; y < size; ++y) {
+            map.AddBuilding(model::Building{model::Rectangle{{x * step + 2, y * step + 2}, {step - 4, step - 4}}});
+        }
+    }
+    map.AddOffice(model::Office{model::Office::Id{"o0"s}, model::Point{0, 0}, model::Offset{1, 0}});
+    map.SetDogSpeed(3.0);
+    return map;
+}
+
+// config.json с maps картами-решётками
+inline std::string MakeGridConfig(size_t maps, int size, int step = 10) {
+    std::string config = R"({"defaultDogSpeed": 3.0, "maps": [)";
+    for (size_t i = 0; i < maps; ++i) {
+        if (i != 0) {
+            config += ',';
+        }
+        config += MakeGridMap("map"s + std::to_string(i + 1), size, step).PrintMap();
+    }
+    config += "]}";
+    return config;
+}
+
+inline std::filesystem::path WriteTempFile(const std::string& name, const std::string& data) {
+    const auto path = std::filesystem::temp_directory_path() / name;
+    std::ofstream{path, std::ios::binary | std::ios::trunc}.write(data.data(), static_cast<std::streamsize>(data.size()));
+    return path;
+}
+
+// Точки для проверки попадания на дороги: половина на дорогах, половина внутри кварталов
+inline std::vector<model::DogPoint> MakeProbePoints(int size, int step, size_t count) {
+    std::vector<model::DogPoint> points;
+    points.reserve(count);
+
+    std::mt19937 generator{42};
+    std::uniform_real_distribution<double> coord{0.0, static_cast<double>(size * step)};
+    std::uniform_int_distribution<int> line{0, size};
+    for (size_t i = 0; i < count; ++i) {
+        if (i % 2 == 0) {
+            points.push_back({static_cast<double>(line(generator) * step), coord(generator)});
+        } else {
+            points.push_back({coord(generator), coord(generator)});
+        }
+    }
+    return points;
+}
+
+// Отрезки, пройденные за тик count псами на дорогах решётки: пёс идёт вдоль своей дороги
+// на 0.1-0.4 (скорость 1-4 за тик 100 мс), каждый восьмой стоит
+inline std::vector<collision::Mover> MakeMovers(int size, int step, size_t count) {
+    std::vector<collision::Mover> movers;
+    movers.reserve(count);
+
+    std::mt19937 generator{7};
+    std::uniform_real_distribution<double> coord{0.0, static_cast<double>(size * step)};
+    std::uniform_int_distribution<int> line{0, size};
+    std::uniform_real_distribution<double> shift{0.1, 0.4};
+    for (size_t i = 0; i < count; ++i) {
+        const double road = static_cast<double>(line(generator) * step);
+        const double along = coord(generator);
+        const double delta = i % 8 == 0 ? 0.0 : (i % 2 == 0 ? shift(generator) : -shift(generator));
+        if (i % 4 < 2) {
+            movers.push_back({{along, road}, {along + delta, road}});
+        } else {
+            movers.push_back({{road, along}, {road, along + delta}});
+        }
+    }
+    return movers;
+}
+
+// Офисы на перекрёстках решётки, не больше count
+inline std::vector<collision::Item> MakeOfficeItems(int size, int step, size_t count) {
+    std::vector<collision::Item> items;
+    std::mt19937 generator{11};
+    std::uniform_int_distribution<int> line{0, size};
+    for (size_t i = 0; i < count; ++i) {
+        items.push_back({{static_cast<double>(line(generator) * step), static_cast<double>(line(generator) * step)}});
+    }
+    return items;
+}
+
+// Игра с одной картой-решёткой и players игроками, псы которых идут в случайных направлениях
+struct GameFixture {
+    explicit GameFixture(int map_size, size_t players, double interest_radius = 0.0) {
+        model::Map map = MakeGridMap("map1"s, map_size);
+        map.SetInterestRadius(interest_radius);
+        game.AddMap(std::move(map));
+        game.SetPlayerSpawn(true);
+        game.SetTickrate(10);
+
+        model::GameSession& session = game.GetGameSession(model::Map::Id{"map1"s});
+        for (size_t i = 0; i < players; ++i) {
+            std::string name = "dog"s + std::to_string(i);
+            tokens.push_back(game.AddPlayerToSession(session, name).second);
+        }
+        MoveAll();
+    }
+
+    model::GameSession& Session() {
+        return game.GetGameSession(model::Map::Id{"map1"s});
+    }
+
+    void MoveAll() {
+        static const std::string directions[] = {"U"s, "D"s, "L"s, "R"s};
+        model::GameSession& session = Session();
+        for (size_t i = 0; i < tokens.size(); ++i) {
+            session.MovePlayerWithToken(tokens[i], directions[(i + turn) % 4]);
+        }
+        ++turn;
+    }
+
+    model::Game game;
+    std::vector<std::string> tokens;
+    size_t turn = 0;
+};
+
+} // namespace bench
+
+#endif
@@ -0,0 +1,122 @@
+#include <benchmark/benchmark.h>
+
+#include "bench_fixtures.h"
+#include "request_handler.h"
+
+namespace {
+
+using namespace std::literals;
+namespace http = boost::beast::http;
+
+using Request = http::request<http::string_body>;
+
+std::shared_ptr<const Request> MakeRequest(http::verb method, std::string_view target,
+                                           std::string_view token = {}, std::string body = {}) {
+    auto req = std::make_shared<Request>(method, target, 11);
+    if (!token.empty()) {
+        req->set(http::field::authorization, "Bearer "s + std::string(token));
+    }
+    if (!body.empty()) {
+        req->set(http::field::content_type, "application/json"sv);
+        req->body() = std::move(body);
+        req->prepare_payload();
+    }
+    return req;
+}
+
+void BM_ParceURI(benchmark::State& state) {
+    const auto req = MakeRequest(http::verb::post, "/api/v1/game/player/action"sv,
+                                 "0123456789abcdef0123456789abcdef"sv, R"({"move": "L"})"s);
+
+    for (auto _ : state) {
+        http_handler::URI_Request request;
+        request.ParceURI(req);
+        benchmark::DoNotOptimize(request.GetBody());
+    }
+}
+BENCHMARK(BM_ParceURI);
+
+void BM_DecodeURL(benchmark::State& state) {
+    const std::string target = "/images/%D0%BA%D0%B0%D1%80%D1%82%D0%B0%20%E2%84%961.png"s;
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(http_handler::DecodeURL(target));
+    }
+}
+BENCHMARK(BM_DecodeURL);
+
+// Дописывает потоковое тело целиком, как это сделал бы сериализатор при записи в сокет.
+// Возвращает наибольший размер части
+size_t DrainBody(const http_server::StreamBody::value_type& body) {
+    std::string buffer;
+    size_t peak = 0;
+    for (bool more = true; more;) {
+        buffer.clear();
+        more = body.generator(buffer, body.chunk_size);
+        peak = std::max(peak, buffer.size());
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    return peak;
+}
+
+// Полный путь API-запроса без сети: разбор, маршрутизация, обработчик и формирование ответа
+void RunExecuteTarget(benchmark::State& state, const std::shared_ptr<const Request>& req, bench::GameFixture& fixture) {
+    http_handler::API_Handler api_handler;
+
+    for (auto _ : state) {
+        http_handler::URI_Request request;
+        request.ParceURI(req);
+        auto response = api_handler.ExecuteTarget(request, fixture.game);
+        if (auto* stream = std::get_if<http_handler::API_Handler::StreamResponse>(&response)) {
+            DrainBody(stream->body());
+        }
+        benchmark::DoNotOptimize(response);
+    }
+}
+
+void BM_ExecuteTarget_Maps(benchmark::State& state) {
+    bench::GameFixture fixture{16, 0};
+    RunExecuteTarget(state, MakeRequest(http::verb::get, "/api/v1/maps/map1"sv), fixture);
+}
+BENCHMARK(BM_ExecuteTarget_Maps);
+
+void BM_ExecuteTarget_State(benchmark::State& state) {
+    bench::GameFixture fixture{16, static_cast<size_t>(state.range(0))};
+    RunExecuteTarget(state, MakeRequest(http::verb::get, "/api/v1/game/state"sv, fixture.tokens.front()), fixture);
+}
+BENCHMARK(BM_ExecuteTarget_State)->Arg(10)->Arg(1000);
+
+void BM_ExecuteTarget_Action(benchmark::State& state) {
+    bench::GameFixture fixture{16, 100};
+    RunExecuteTarget(state, MakeRequest(http::verb::post, "/api/v1/game/player/action"sv,
+                                        fixture.tokens.front(), R"({"move": "R"})"s), fixture);
+}
+BENCHMARK(BM_ExecuteTarget_Action);
+
+void BM_ExecuteTarget_NotFound(benchmark::State& state) {
+    bench::GameFixture fixture{4, 0};
+    RunExecuteTarget(state, MakeRequest(http::verb::get, "/api/v1/unknown/endpoint"sv), fixture);
+}
+BENCHMARK(BM_ExecuteTarget_NotFound);
+
+// Память потокового ответа ограничена частью, а не документом
+void BM_StreamMapBody(benchmark::State& state) {
+    const auto map = std::make_shared<const model::Map>(bench::MakeGridMap("map1"s, static_cast<int>(state.range(0))));
+    http_handler::Response response_maker;
+
+    size_t peak = 0;
+    for (auto _ : state) {
+        auto response = response_maker.MakeStreamResponse(http::status::ok,
+            [map, writer = model::MapJsonWriter{}](std::string& buffer, size_t limit) mutable {
+                return writer.Write(*map, buffer, limit);
+            }, 11, true);
+        peak = DrainBody(response.body());
+    }
+    state.counters["document_bytes"] = static_cast<double>(map->PrintMap().size());
+    state.counters["peak_chunk_bytes"] = static_cast<double>(peak);
+}
+BENCHMARK(BM_StreamMapBody)->Arg(16)->Arg(128);
+
+} // namespace
+
+BENCHMARK_MAIN();
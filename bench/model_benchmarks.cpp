@@ -0,0 +1,246 @@
+#include <benchmark/benchmark.h>
+
+#include "bench_fixtures.h"
+#include "json_loader.h"
+#include "map_bundle.h"
+#include "snapshot.h"
+
+namespace {
+
+using namespace std::literals;
+
+constexpr int STEP = 10;
+
+void BM_IsPointOnGrid(benchmark::State& state) {
+    const int size = static_cast<int>(state.range(0));
+    const model::RoadGrid grid = bench::MakeRoadGrid(size, STEP);
+    const auto points = bench::MakeProbePoints(size, STEP, 1024);
+
+    size_t i = 0;
+    for (auto _ : state) {
+        const auto& start = points[i % points.size()];
+        const auto& end = points[(i + 1) % points.size()];
+        benchmark::DoNotOptimize(grid.IsPointOnGrid(start, end));
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_IsPointOnGrid)->Arg(4)->Arg(16)->Arg(64);
+
+void BM_HandleCollizion(benchmark::State& state) {
+    const int size = static_cast<int>(state.range(0));
+    const model::RoadGrid grid = bench::MakeRoadGrid(size, STEP);
+    const auto points = bench::MakeProbePoints(size, STEP, 1024);
+
+    size_t i = 0;
+    for (auto _ : state) {
+        // начало всегда на дороге (чётные точки), конец - где угодно
+        const auto& start = points[(i * 2) % points.size()];
+        const auto& end = points[(i * 2 + 1) % points.size()];
+        benchmark::DoNotOptimize(grid.HandleCollizion(start, end));
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HandleCollizion)->Arg(4)->Arg(16)->Arg(64);
+
+void BM_UpdateState(benchmark::State& state) {
+    bench::GameFixture fixture{16, static_cast<size_t>(state.range(0))};
+    model::GameSession& session = fixture.Session();
+
+    size_t i = 0;
+    for (auto _ : state) {
+        // упёршиеся в край дороги псы останавливаются, время от времени разворачиваем всех
+        if (++i % 256 == 0) {
+            state.PauseTiming();
+            fixture.MoveAll();
+            state.ResumeTiming();
+        }
+        session.UpdateState(10);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_UpdateState)->Arg(1)->Arg(100)->Arg(1000)->Arg(10000);
+
+void BM_GetPlayerData(benchmark::State& state) {
+    bench::GameFixture fixture{16, static_cast<size_t>(state.range(0))};
+    model::GameSession& session = fixture.Session();
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(session.GetPlayerData());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GetPlayerData)->Arg(10)->Arg(100)->Arg(1000);
+
+// Ответ /state с радиусом видимости 20 на карте 160x160: в ответ попадает малая часть псов
+void BM_GetPlayerDataNearby(benchmark::State& state) {
+    bench::GameFixture fixture{16, static_cast<size_t>(state.range(0)), 20.0};
+    model::GameSession& session = fixture.Session();
+
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(session.GetPlayerData(fixture.tokens[i++ % fixture.tokens.size()]));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GetPlayerDataNearby)->Arg(100)->Arg(1000)->Arg(10000);
+
+// Тик с обновлением сетки видимости
+void BM_UpdateStateWithInterestGrid(benchmark::State& state) {
+    bench::GameFixture fixture{16, static_cast<size_t>(state.range(0)), 20.0};
+    model::GameSession& session = fixture.Session();
+
+    size_t i = 0;
+    for (auto _ : state) {
+        if (++i % 256 == 0) {
+            state.PauseTiming();
+            fixture.MoveAll();
+            state.ResumeTiming();
+        }
+        session.UpdateState(10);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_UpdateStateWithInterestGrid)->Arg(1000)->Arg(10000);
+
+// Поиск контактов за один тик: псы на решётке 1280x1280 (256 дорог), офис на каждые 100 псов
+void BM_FindContacts(benchmark::State& state) {
+    constexpr int size = 128;
+    const size_t dogs = static_cast<size_t>(state.range(0));
+    const auto movers = bench::MakeMovers(size, STEP, dogs);
+    const auto offices = bench::MakeOfficeItems(size, STEP, dogs / 100);
+    collision::Broadphase broadphase;
+
+    size_t contacts = 0;
+    for (auto _ : state) {
+        contacts = broadphase.FindContacts(movers, offices).size();
+    }
+    state.counters["contacts"] = static_cast<double>(contacts);
+    state.counters["candidates"] = static_cast<double>(broadphase.GetCandidateCount());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FindContacts)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+void BM_PrintMap(benchmark::State& state) {
+    const model::Map map = bench::MakeGridMap("map"s, static_cast<int>(state.range(0)), STEP);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(map.PrintMap());
+    }
+}
+BENCHMARK(BM_PrintMap)->Arg(4)->Arg(16);
+
+// Генерация токена входит в AddPlayer
+void BM_AddPlayer(benchmark::State& state) {
+    model::Game game;
+    game.AddMap(bench::MakeGridMap("map1"s, 4, STEP));
+    model::GameSession& session = game.GetGameSession(model::Map::Id{"map1"s});
+    std::string name = "dog"s;
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(game.AddPlayerToSession(session, name));
+    }
+}
+BENCHMARK(BM_AddPlayer);
+
+void BM_TokenLookup(benchmark::State& state) {
+    bench::GameFixture fixture{4, static_cast<size_t>(state.range(0))};
+
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(fixture.game.HaveGameSessionWithToken(fixture.tokens[i++ % fixture.tokens.size()]));
+    }
+}
+BENCHMARK(BM_TokenLookup)->Arg(100)->Arg(10000);
+
+// Действие игрока переносит его таймер простоя в колесе: цена не должна зависеть от числа игроков
+void BM_MovePlayerWithRetirement(benchmark::State& state) {
+    bench::GameFixture fixture{4, static_cast<size_t>(state.range(0))};
+    fixture.game.SetRetirementTime(std::chrono::minutes{1});
+    model::GameSession& session = fixture.Session();
+    static const std::string directions[] = {"U"s, "D"s, "L"s, "R"s};
+
+    size_t i = 0;
+    for (auto _ : state) {
+        session.MovePlayerWithToken(fixture.tokens[i % fixture.tokens.size()], directions[i % 4]);
+        ++i;
+    }
+}
+BENCHMARK(BM_MovePlayerWithRetirement)->Arg(100)->Arg(100000);
+
+// Тик, на котором уходит каждый десятый игрок
+void BM_RetireIdlePlayers(benchmark::State& state) {
+    const size_t players = static_cast<size_t>(state.range(0));
+    for (auto _ : state) {
+        state.PauseTiming();
+        bench::GameFixture fixture{4, players};
+        fixture.game.SetRetirementTime(std::chrono::milliseconds{100});
+        fixture.game.UpdateStates();
+        for (size_t i = 0; i < players; ++i) {
+            if (i % 10 != 0) {
+                fixture.game.MovePlayer(fixture.tokens[i], "U"s);
+            }
+        }
+        state.ResumeTiming();
+
+        fixture.game.SetTickrate(90);
+        fixture.game.UpdateStates();
+    }
+}
+BENCHMARK(BM_RetireIdlePlayers)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+void BM_SnapshotSave(benchmark::State& state) {
+    bench::GameFixture fixture{16, static_cast<size_t>(state.range(0))};
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(snapshot::Serialize(fixture.game.MakeSnapshot()));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SnapshotSave)->Arg(1000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+// Разбор снимка и восстановление игры: то, что делает сервер при старте с --state-file
+void BM_SnapshotRestore(benchmark::State& state) {
+    bench::GameFixture fixture{16, static_cast<size_t>(state.range(0))};
+    const std::string data = snapshot::Serialize(fixture.game.MakeSnapshot());
+
+    for (auto _ : state) {
+        model::Game game;
+        game.AddMap(bench::MakeGridMap("map1"s, 16, STEP));
+        game.RestoreSnapshot(snapshot::Deserialize(data));
+        benchmark::DoNotOptimize(game);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SnapshotRestore)->Arg(1000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+// Загрузка восьми карт при старте сервера: разбор config.json против бандла game_map_compiler
+constexpr size_t LOAD_MAPS = 8;
+
+void BM_LoadGameJson(benchmark::State& state) {
+    const auto config_path = bench::WriteTempFile("bench_config.json"s,
+        bench::MakeGridConfig(LOAD_MAPS, static_cast<int>(state.range(0)), STEP));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(json_loader::LoadGame(config_path));
+    }
+    std::filesystem::remove(config_path);
+}
+BENCHMARK(BM_LoadGameJson)->Arg(16)->Arg(128)->Unit(benchmark::kMillisecond);
+
+void BM_LoadMapBundle(benchmark::State& state) {
+    const std::string config = bench::MakeGridConfig(LOAD_MAPS, static_cast<int>(state.range(0)), STEP);
+    const auto config_path = bench::WriteTempFile("bench_config.json"s, config);
+    const auto bundle_path = bench::WriteTempFile("bench_maps.bin"s,
+        map_bundle::Compile(json_loader::LoadConfig(config_path), config));
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(map_bundle::Load(bundle_path, config_path));
+    }
+    std::filesystem::remove(config_path);
+    std::filesystem::remove(bundle_path);
+}
+BENCHMARK(BM_LoadMapBundle)->Arg(16)->Arg(128)->Unit(benchmark::kMillisecond);
+
+} // namespace
@@ -0,0 +1,119 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+#include "http_server.h"
+
+// Выделения памяти считаются только в потоке сервера: клиент бенчмарка в счёт не входит.
+// Замена глобального operator new действует на всю программу, поэтому эти бенчмарки собираются
+// отдельно от game_benchmarks и не влияют на его замеры
+namespace {
+
+std::atomic<uint64_t> server_allocations{0};
+thread_local bool count_allocations = false;
+
+} // namespace
+
+void* operator new(size_t size) {
+    if (count_allocations) {
+        server_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+using namespace std::literals;
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+using tcp = net::ip::tcp;
+
+// Короткий JSON-ответ. С hop ответ готовится в отдельном strand, как API-запрос в strand игры
+struct BenchHandler {
+    net::strand<net::io_context::executor_type>* strand = nullptr;
+
+    template <typename Request, typename Send>
+    void operator()(Request&& req, Send&& send, const tcp::endpoint&) {
+        auto respond = [version = req.version(), keep_alive = req.keep_alive(), send = std::forward<Send>(send)]() mutable {
+            http::response<http::string_body> response{http::status::ok, version};
+            response.set(http::field::content_type, "application/json"sv);
+            response.body() = R"({"players":{}})"s;
+            response.keep_alive(keep_alive);
+            response.prepare_payload();
+            send(std::move(response));
+        };
+        if (strand != nullptr) {
+            return net::dispatch(*strand, std::move(respond));
+        }
+        respond();
+    }
+};
+
+// Сервер в одном потоке и клиент, который шлёт запросы по одному keep-alive соединению.
+// Аргументы: модель сессии (0 - обработчики, 1 - сопрограммы) и переход в отдельный strand
+void BM_Session(benchmark::State& state) {
+    net::io_context ioc;
+    auto strand = net::make_strand(ioc);
+    http_server::ListenerOptions options;
+    options.session_model = state.range(0) == 0 ? http_server::SessionModel::CALLBACKS : http_server::SessionModel::COROUTINES;
+
+    auto listener = std::make_shared<http_server::Listener<BenchHandler>>(
+        ioc, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0}, BenchHandler{state.range(1) != 0 ? &strand : nullptr}, options);
+    listener->Run();
+    const tcp::endpoint endpoint = listener->GetLocalEndpoint();
+    listener.reset();
+
+    std::thread server([&ioc] {
+        count_allocations = true;
+        ioc.run();
+    });
+
+    net::io_context client_ioc;
+    tcp::socket client{client_ioc};
+    client.connect(endpoint);
+    client.set_option(tcp::no_delay(true));
+    http::request<http::string_body> request{http::verb::get, "/api/v1/game/state", 11};
+    request.set(http::field::host, "127.0.0.1"sv);
+    beast::flat_buffer buffer;
+    http::response<http::string_body> response;
+
+    // Первый запрос прогревает буферы соединения и кэши кадров сопрограмм
+    http::write(client, request);
+    http::read(client, buffer, response);
+
+    const uint64_t allocations_before = server_allocations.load();
+    for (auto _ : state) {
+        http::write(client, request);
+        response = {};
+        http::read(client, buffer, response);
+        benchmark::DoNotOptimize(response.body().data());
+    }
+    const uint64_t allocations = server_allocations.load() - allocations_before;
+
+    client.close();
+    ioc.stop();
+    server.join();
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["allocs_per_request"] = benchmark::Counter(static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_Session)->ArgNames({"coroutines", "hop"})->ArgsProduct({{0, 1}, {0, 1}})->UseRealTime();
+
+} // namespace
+
+BENCHMARK_MAIN();
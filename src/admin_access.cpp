@@ -0,0 +1,43 @@
+#include "admin_access.h"
+
+namespace http_handler {
+
+using namespace std::literals;
+
+namespace {
+
+// Время сравнения не зависит от того, в каком символе токены расходятся
+bool ConstantTimeEqual(std::string_view lhs, std::string_view rhs) {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    unsigned char diff = 0;
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        diff |= static_cast<unsigned char>(lhs[i] ^ rhs[i]);
+    }
+    return diff == 0;
+}
+
+} // namespace
+
+bool IsLoopback(const net::ip::address& address) {
+    if (address.is_v6() && address.to_v6().is_v4_mapped()) {
+        return net::ip::make_address_v4(net::ip::v4_mapped, address.to_v6()).is_loopback();
+    }
+    return address.is_loopback();
+}
+
+AdminAccess::Verdict AdminAccess::Check(std::optional<std::string_view> authorization,
+                                        const net::ip::address& remote_address) const {
+    if (!HasToken()) {
+        return IsLoopback(remote_address) ? Verdict::ALLOWED : Verdict::FORBIDDEN;
+    }
+
+    constexpr std::string_view bearer = "Bearer "sv;
+    if (!authorization.has_value() || !authorization->starts_with(bearer)) {
+        return Verdict::UNAUTHORIZED;
+    }
+    return ConstantTimeEqual(authorization->substr(bearer.size()), token_) ? Verdict::ALLOWED : Verdict::UNAUTHORIZED;
+}
+
+} // namespace http_handler
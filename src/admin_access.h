@@ -0,0 +1,45 @@
+#ifndef __ADMIN_ACCESS__
+#define __ADMIN_ACCESS__
+
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#pragma once
+#include <boost/asio/ip/address.hpp>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace http_handler {
+
+namespace net = boost::asio;
+
+// Доступ к служебным эндпоинтам /admin/*. С токеном нужен заголовок "Authorization: Bearer <токен>"
+// с любого адреса, без токена эндпоинты отвечают только клиентам с loopback-адресов
+class AdminAccess {
+public:
+    enum class Verdict {
+        ALLOWED,
+        UNAUTHORIZED,  // токен задан, а в запросе его нет или он другой
+        FORBIDDEN      // токен не задан, а клиент не на этой машине
+    };
+
+    explicit AdminAccess(std::string token = {})
+        : token_{std::move(token)} {}
+
+    bool HasToken() const {
+        return !token_.empty();
+    }
+
+    // authorization - значение заголовка Authorization, если он есть
+    Verdict Check(std::optional<std::string_view> authorization, const net::ip::address& remote_address) const;
+
+private:
+    std::string token_;
+};
+
+// 127.0.0.0/8, ::1 и адреса 127.0.0.0/8, отображённые в IPv6 (::ffff:127.x.x.x)
+bool IsLoopback(const net::ip::address& address);
+
+} // namespace http_handler
+
+#endif
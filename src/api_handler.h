@@ -6,13 +6,17 @@
 #pragma once
 #include <unordered_map>
 #include <functional>
+#include <optional>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/asio/io_context.hpp>
 #include <variant>
 
 #include "uri_handler.h"
+#include "api_router.h"
 #include "response_maker.h"
 #include "model.h"
+#include "metrics.h"
+#include "tracing.h"
 
 namespace http_handler {
 
@@ -27,19 +31,33 @@ namespace pt = boost::property_tree;
 class API_Handler
 {
 public:
-    using StringResponse = http::response<http::string_body>;
-    using APIHandlerFunctionPtr = http_handler::API_Handler::StringResponse (http_handler::API_Handler::*)(http_handler::URI_Request&, model::Game&);
+    using StringResponse = Response::StringResponse;
+    using StreamResponse = Response::StreamResponse;
+    // Большие документы (карта, список игроков) отдаются потоком, остальное - строкой
+    using ApiResponse = std::variant<StringResponse, StreamResponse>;
+    using APIHandlerFunctionPtr = http_handler::API_Handler::ApiResponse (http_handler::API_Handler::*)(http_handler::URI_Request&, model::Game&);
 
     API_Handler();
-    StringResponse ExecuteTarget(URI_Request &request, model::Game &game);
+    ApiResponse ExecuteTarget(URI_Request &request, model::Game &game);
 
 private:
-    std::unordered_map<std::string, APIHandlerFunctionPtr> target_to_non_authorithed_function;
-    std::unordered_map<std::string, APIHandlerFunctionPtr> target_to_authorithed_function;
+    struct Route {
+        APIHandlerFunctionPtr function;
+        bool authorithed;
+        metrics::Counter requests = {};
+        metrics::Histogram duration = {};
+    };
+
+    void AddRoute(std::string_view pattern, std::initializer_list<http::verb> verbs, APIHandlerFunctionPtr function, bool authorithed);
+    ApiResponse ExecuteRoute(URI_Request &request, model::Game &game, const Route& route);
+
+    Router<Route> router_;
+    // запросы, для которых не нашлось маршрута
+    metrics::Counter unknown_route_requests_;
 
     static StringResponse ErrorResponce(URI_Request &request, http::status status, 
                 std::string_view allow, std::string code, std::string messege) {
-        Response responce_;
+        Response responce_{request.GetAllocator()};
         std::string body = PrintErrorResponce(code, messege);
         request.SetResponceStatus(status);
 
@@ -49,8 +67,15 @@ private:
     }
 
     template <typename Fn>
-    StringResponse ExecuteAuthorithed(URI_Request &request, model::Game &game, Fn&& action) {
-        std::string auth_token = request.GetAuthToken();
+    ApiResponse ExecuteAuthorithed(URI_Request &request, model::Game &game, Fn&& action) {
+        if (auto error = CheckToken(request, game)) {
+            return std::move(*error);
+        }
+        return (this->*action)(request, game);
+    }
+
+    static std::optional<StringResponse> CheckToken(URI_Request &request, model::Game &game) {
+        std::string_view auth_token = request.GetAuthToken();
 
         if (auth_token.empty() || auth_token.size() != 32) {
             return ErrorResponce(request, http::status::unauthorized, Response::AllowData::EMPTY, "invalidToken", "Authorization header is missing");
@@ -59,19 +84,18 @@ private:
         if (!game.HaveGameSessionWithToken(auth_token)) {
             return ErrorResponce(request, http::status::unauthorized, Response::AllowData::EMPTY, "unknownToken", "Player token has not been found");
         }
-
-        return (this->*action)(request, game);
+        return std::nullopt;
     }
 
-    StringResponse MapList(URI_Request &request, model::Game &game);
-    StringResponse MapData(URI_Request &request, model::Game &game);
-    StringResponse JoinGame(URI_Request &request, model::Game &game);
-    StringResponse Tick(URI_Request &request, model::Game &game);
-    StringResponse Update(URI_Request &request, model::Game &game);
+    ApiResponse MapList(URI_Request &request, model::Game &game);
+    ApiResponse MapData(URI_Request &request, model::Game &game);
+    ApiResponse JoinGame(URI_Request &request, model::Game &game);
+    ApiResponse Tick(URI_Request &request, model::Game &game);
+    ApiResponse Update(URI_Request &request, model::Game &game);
 
-    StringResponse Players(URI_Request &request, model::Game &game);
-    StringResponse State(URI_Request &request, model::Game &game);
-    StringResponse Action(URI_Request &request, model::Game &game);
+    ApiResponse Players(URI_Request &request, model::Game &game);
+    ApiResponse State(URI_Request &request, model::Game &game);
+    ApiResponse Action(URI_Request &request, model::Game &game);
 };
 } // namespace http_handler
 
@@ -0,0 +1,318 @@
+#ifndef __API_ROUTER__
+#define __API_ROUTER__
+
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#pragma once
+#include <boost/beast/http.hpp>
+#include <array>
+#include <charconv>
+#include <initializer_list>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace http_handler {
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+
+// Значения параметров пути, например map_id для шаблона "/api/v1/maps/{map_id}".
+// Хранит только string_view на имя из маршрутизатора и на часть target запроса
+class RouteParams {
+public:
+    static constexpr size_t MAX_PARAMS = 4;
+
+    std::optional<std::string_view> Get(std::string_view name) const {
+        for (size_t i = 0; i < size_; ++i) {
+            if (names_[i] == name) {
+                return values_[i];
+            }
+        }
+        return std::nullopt;
+    }
+
+    // Типизированный доступ: целочисленные параметры разбираются без выделения памяти
+    template <typename T>
+    std::optional<T> Get(std::string_view name) const {
+        auto value = Get(name);
+        if (!value.has_value()) {
+            return std::nullopt;
+        }
+        T result{};
+        auto [ptr, ec] = std::from_chars(value->data(), value->data() + value->size(), result);
+        if (ec != std::errc{} || ptr != value->data() + value->size()) {
+            return std::nullopt;
+        }
+        return result;
+    }
+
+    size_t Size() const {
+        return size_;
+    }
+
+    bool Push(std::string_view name, std::string_view value) {
+        if (size_ == MAX_PARAMS) {
+            return false;
+        }
+        names_[size_] = name;
+        values_[size_] = value;
+        ++size_;
+        return true;
+    }
+
+    void Clear() {
+        size_ = 0;
+    }
+
+private:
+    std::array<std::string_view, MAX_PARAMS> names_;
+    std::array<std::string_view, MAX_PARAMS> values_;
+    size_t size_ = 0;
+};
+
+// Маршрутизатор, собираемый один раз при старте. Шаблон пути разбивается на сегменты,
+// из которых строится префиксное дерево. Сегмент вида {name} или {name:int} - параметр пути.
+// Поиск делает один проход по target без выделения памяти
+template <typename Handler>
+class Router {
+public:
+    enum class Status {
+        FOUND,
+        NOT_FOUND,
+        METHOD_NOT_ALLOWED
+    };
+
+    struct Match {
+        Status status = Status::NOT_FOUND;
+        const Handler* handler = nullptr;
+        // для METHOD_NOT_ALLOWED - обработчик другого метода того же маршрута (по нему видно, например,
+        // нужна ли маршруту авторизация), значение заголовка Allow и текст ошибки
+        std::string_view allow;
+        std::string_view method_error;
+        // шаблон маршрута, по которому нашёлся target (удобно для логов и метрик)
+        std::string_view pattern;
+        RouteParams params;
+    };
+
+    Router() : root_{std::make_unique<Node>()} {}
+
+    Router(const Router&) = delete;
+    Router& operator=(const Router&) = delete;
+
+    void Add(std::string_view pattern, std::initializer_list<http::verb> methods, Handler handler) {
+        Node* node = root_.get();
+
+        ForEachSegment(pattern, [this, &node](std::string_view segment) {
+            node = (segment.starts_with('{') && segment.ends_with('}'))
+                ? GetParamChild(node, segment.substr(1, segment.size() - 2))
+                : GetStaticChild(node, segment);
+            return true;
+        });
+
+        if (node->pattern.empty()) {
+            node->pattern = pattern;
+        }
+        for (http::verb method : methods) {
+            const size_t slot = MethodSlot(method);
+            if (slot == NO_SLOT) {
+                throw std::invalid_argument(std::string("Unsupported method in route ") + std::string(pattern));
+            }
+            if (node->handlers[slot].has_value()) {
+                throw std::invalid_argument(std::string("Duplicate route ") + std::string(pattern));
+            }
+            node->handlers[slot] = handler;
+        }
+        UpdateAllow(*node);
+    }
+
+    Match Find(std::string_view target, http::verb method) const {
+        Match match;
+
+        // query-часть в маршрутизации не участвует
+        target = target.substr(0, target.find('?'));
+
+        const Node* node = root_.get();
+        ForEachSegment(target, [&node, &match](std::string_view segment) {
+            node = FindChild(*node, segment, match.params);
+            return node != nullptr;
+        });
+        // Завершающий '/' - пустой последний сегмент: "/api/v1/maps/" - карта с пустым id, а не список карт
+        if (node != nullptr && target.size() > 1 && target.ends_with('/')) {
+            node = FindChild(*node, {}, match.params);
+        }
+
+        if (node == nullptr || node->allow.empty()) {
+            return match;
+        }
+
+        match.pattern = node->pattern;
+        const size_t slot = MethodSlot(method);
+        if (slot != NO_SLOT && node->handlers[slot].has_value()) {
+            match.status = Status::FOUND;
+            match.handler = &*node->handlers[slot];
+            return match;
+        }
+
+        match.status = Status::METHOD_NOT_ALLOWED;
+        for (const auto& handler : node->handlers) {
+            if (handler.has_value()) {
+                match.handler = &*handler;
+                break;
+            }
+        }
+        match.allow = node->allow;
+        match.method_error = node->method_error;
+        return match;
+    }
+
+private:
+    static constexpr size_t NO_SLOT = static_cast<size_t>(-1);
+    static constexpr size_t SLOT_COUNT = 7;
+
+    enum class ParamType {
+        STRING,
+        INTEGER
+    };
+
+    struct Node {
+        std::vector<std::pair<std::string, std::unique_ptr<Node>>> static_children;
+
+        std::unique_ptr<Node> param_child;
+        std::string param_name;
+        ParamType param_type = ParamType::STRING;
+
+        std::string pattern;
+        std::array<std::optional<Handler>, SLOT_COUNT> handlers;
+        std::string allow;
+        std::string method_error;
+    };
+
+    // Разбивает путь на сегменты между '/'. Пустые сегменты (двойной или завершающий '/') пропускаются,
+    // завершающий '/' target отдельно учитывает Find
+    template <typename Fn>
+    static void ForEachSegment(std::string_view path, Fn&& fn) {
+        size_t pos = 0;
+        while (pos < path.size()) {
+            size_t end = path.find('/', pos);
+            if (end == std::string_view::npos) {
+                end = path.size();
+            }
+            if (end != pos && !fn(path.substr(pos, end - pos))) {
+                return;
+            }
+            pos = end + 1;
+        }
+    }
+
+    static const Node* FindChild(const Node& node, std::string_view segment, RouteParams& params) {
+        for (const auto& [name, child] : node.static_children) {
+            if (name == segment) {
+                return child.get();
+            }
+        }
+
+        if (node.param_child == nullptr) {
+            return nullptr;
+        }
+        if (node.param_type == ParamType::INTEGER && !IsInteger(segment)) {
+            return nullptr;
+        }
+        if (!params.Push(node.param_name, segment)) {
+            return nullptr;
+        }
+        return node.param_child.get();
+    }
+
+    static bool IsInteger(std::string_view segment) {
+        if (segment.starts_with('-')) {
+            segment.remove_prefix(1);
+        }
+        return !segment.empty() && segment.find_first_not_of("0123456789") == std::string_view::npos;
+    }
+
+    Node* GetStaticChild(Node* node, std::string_view segment) {
+        for (auto& [name, child] : node->static_children) {
+            if (name == segment) {
+                return child.get();
+            }
+        }
+        return node->static_children.emplace_back(std::string(segment), std::make_unique<Node>()).second.get();
+    }
+
+    Node* GetParamChild(Node* node, std::string_view param) {
+        std::string_view name = param;
+        ParamType type = ParamType::STRING;
+
+        if (auto colon = param.find(':'); colon != std::string_view::npos) {
+            name = param.substr(0, colon);
+            std::string_view type_name = param.substr(colon + 1);
+            if (type_name == "int") {
+                type = ParamType::INTEGER;
+            } else if (type_name != "string") {
+                throw std::invalid_argument(std::string("Unknown route parameter type: ") + std::string(type_name));
+            }
+        }
+
+        if (node->param_child == nullptr) {
+            node->param_child = std::make_unique<Node>();
+            node->param_name = name;
+            node->param_type = type;
+        } else if (node->param_name != name || node->param_type != type) {
+            throw std::invalid_argument(std::string("Conflicting route parameter: ") + std::string(param));
+        }
+        return node->param_child.get();
+    }
+
+    static size_t MethodSlot(http::verb method) {
+        switch (method) {
+        case http::verb::get: return 0;
+        case http::verb::head: return 1;
+        case http::verb::post: return 2;
+        case http::verb::put: return 3;
+        case http::verb::delete_: return 4;
+        case http::verb::patch: return 5;
+        case http::verb::options: return 6;
+        default: return NO_SLOT;
+        }
+    }
+
+    static constexpr std::array<std::string_view, SLOT_COUNT> SLOT_NAMES = {
+        "GET", "HEAD", "POST", "PUT", "DELETE", "PATCH", "OPTIONS"
+    };
+
+    // Заголовок Allow и текст ошибки 405 готовятся заранее, при регистрации маршрута
+    static void UpdateAllow(Node& node) {
+        std::vector<std::string_view> methods;
+        for (size_t slot = 0; slot < SLOT_COUNT; ++slot) {
+            if (node.handlers[slot].has_value()) {
+                methods.push_back(SLOT_NAMES[slot]);
+            }
+        }
+
+        node.allow.clear();
+        for (auto method : methods) {
+            if (!node.allow.empty()) {
+                node.allow += ", ";
+            }
+            node.allow += method;
+        }
+
+        if (methods.size() == 1) {
+            node.method_error = std::string("Only ") + std::string(methods.front()) + " method is expected";
+        } else if (methods == std::vector<std::string_view>{"GET", "HEAD"}) {
+            node.method_error = "Only HEAD or GET method are expected";
+        } else {
+            node.method_error = std::string("Only ") + node.allow + " methods are expected";
+        }
+    }
+
+    std::unique_ptr<Node> root_;
+};
+
+} // namespace http_handler
+
+#endif
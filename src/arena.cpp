@@ -0,0 +1,19 @@
+#include "arena.h"
+
+#include <sstream>
+
+namespace http_server {
+
+std::string ArenaStats::PrintStats() const {
+    const uint64_t requests = requests_.load(std::memory_order_relaxed);
+    const uint64_t total = total_bytes_.load(std::memory_order_relaxed);
+
+    std::ostringstream oss;
+    oss << "{\"requests\":" << requests
+        << ",\"peakBytes\":" << peak_bytes_.load(std::memory_order_relaxed)
+        << ",\"averageBytes\":" << (requests == 0 ? 0 : total / requests)
+        << ",\"overflowed\":" << overflowed_.load(std::memory_order_relaxed) << "}";
+    return oss.str();
+}
+
+} // namespace http_server
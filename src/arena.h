@@ -0,0 +1,195 @@
+#ifndef __ARENA__
+#define __ARENA__
+
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#pragma once
+#include <boost/beast/http.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <type_traits>
+
+#include "memory_stats.h"
+
+namespace http_server {
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+
+// Аллокатор поверх std::pmr::memory_resource. В отличие от std::pmr::polymorphic_allocator
+// он копируется и присваивается, как того требуют http::basic_fields и парсер Beast
+template <typename T>
+class BasicArenaAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    BasicArenaAllocator() noexcept
+        : resource_{std::pmr::get_default_resource()} {}
+
+    BasicArenaAllocator(std::pmr::memory_resource* resource) noexcept
+        : resource_{resource} {}
+
+    template <typename U>
+    BasicArenaAllocator(const BasicArenaAllocator<U>& other) noexcept
+        : resource_{other.resource()} {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(resource_->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        resource_->deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    std::pmr::memory_resource* resource() const noexcept {
+        return resource_;
+    }
+
+    template <typename U>
+    bool operator==(const BasicArenaAllocator<U>& other) const noexcept {
+        return resource_ == other.resource() || resource_->is_equal(*other.resource());
+    }
+
+private:
+    std::pmr::memory_resource* resource_;
+};
+
+// Все данные запроса и ответа (поля Beast, тела, разобранный JSON) берутся из арены соединения
+using ArenaAllocator = BasicArenaAllocator<char>;
+using ArenaFields = http::basic_fields<ArenaAllocator>;
+using ArenaStringBody = http::basic_string_body<char, std::char_traits<char>, ArenaAllocator>;
+
+// Общая статистика по всем аренам, отдаётся на /admin/arena
+class ArenaStats {
+public:
+    static ArenaStats& Instance() {
+        static ArenaStats stats;
+        return stats;
+    }
+
+    void AddRequest(size_t used_bytes, size_t capacity) {
+        requests_.fetch_add(1, std::memory_order_relaxed);
+        total_bytes_.fetch_add(used_bytes, std::memory_order_relaxed);
+        if (used_bytes > capacity) {
+            overflowed_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        size_t peak = peak_bytes_.load(std::memory_order_relaxed);
+        while (used_bytes > peak && !peak_bytes_.compare_exchange_weak(peak, used_bytes, std::memory_order_relaxed)) {
+        }
+    }
+
+    std::string PrintStats() const;
+
+private:
+    ArenaStats() = default;
+
+    std::atomic<uint64_t> requests_{0};
+    std::atomic<uint64_t> total_bytes_{0};
+    std::atomic<uint64_t> overflowed_{0};
+    std::atomic<size_t> peak_bytes_{0};
+};
+
+// Монотонная арена одного соединения. Память запроса и ответа освобождается целиком
+// после записи ответа, начальный буфер переиспользуется следующим запросом.
+// Начальный буфер и переполнения берутся у memory::Subsystem::CONNECTIONS.
+// Арена не потокобезопасна: соединение и strand игры работают с ней по очереди
+class RequestArena {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 16 * 1024;
+
+    explicit RequestArena(size_t capacity = DEFAULT_CAPACITY)
+        : capacity_{capacity}
+        , upstream_{memory::GetResource(memory::Subsystem::CONNECTIONS)}
+        , buffer_{static_cast<std::byte*>(upstream_->allocate(capacity_, alignof(std::max_align_t)))}
+        , monotonic_{buffer_, capacity_, upstream_}
+        , counting_{&monotonic_} {
+    }
+
+    ~RequestArena() {
+        monotonic_.release();
+        upstream_->deallocate(buffer_, capacity_, alignof(std::max_align_t));
+    }
+
+    RequestArena(const RequestArena&) = delete;
+    RequestArena& operator=(const RequestArena&) = delete;
+
+    std::pmr::memory_resource* Resource() {
+        return &counting_;
+    }
+
+    ArenaAllocator GetAllocator() {
+        return ArenaAllocator{&counting_};
+    }
+
+    size_t Used() const {
+        return counting_.Used();
+    }
+
+    size_t Peak() const {
+        return peak_;
+    }
+
+    // Вызывается, когда ни запрос, ни ответ больше не используются
+    void Release() {
+        const size_t used = counting_.Used();
+        if (used == 0) {
+            return;
+        }
+        peak_ = std::max(peak_, used);
+        ArenaStats::Instance().AddRequest(used, capacity_);
+
+        counting_.Reset();
+        monotonic_.release();
+    }
+
+private:
+    class CountingResource : public std::pmr::memory_resource {
+    public:
+        explicit CountingResource(std::pmr::memory_resource* upstream)
+            : upstream_{upstream} {}
+
+        size_t Used() const {
+            return used_;
+        }
+
+        void Reset() {
+            used_ = 0;
+        }
+
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override {
+            used_ += bytes;
+            return upstream_->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+            upstream_->deallocate(p, bytes, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+
+        std::pmr::memory_resource* upstream_;
+        size_t used_ = 0;
+    };
+
+    size_t capacity_;
+    std::pmr::memory_resource* upstream_;
+    std::byte* buffer_;
+    std::pmr::monotonic_buffer_resource monotonic_;
+    CountingResource counting_;
+    size_t peak_ = 0;
+};
+
+} // namespace http_server
+
+#endif
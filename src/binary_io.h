@@ -0,0 +1,134 @@
+#ifndef __BINARY_IO__
+#define __BINARY_IO__
+
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#pragma once
+#include <unistd.h>
+
+#include <bit>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+namespace binary_io {
+
+// Запись чисел (little-endian) и строк с длиной в конец буфера
+class Writer {
+public:
+    explicit Writer(std::string& buffer)
+        : buffer_{buffer} {}
+
+    template <typename T>
+    void Write(T value) {
+        static_assert(std::is_arithmetic_v<T>);
+        static_assert(std::endian::native == std::endian::little, "Only little-endian hosts are supported");
+        const size_t offset = buffer_.size();
+        buffer_.resize(offset + sizeof(T));
+        std::memcpy(buffer_.data() + offset, &value, sizeof(T));
+    }
+
+    template <typename Size = uint32_t>
+    void WriteString(std::string_view str) {
+        Write(static_cast<Size>(str.size()));
+        buffer_.append(str);
+    }
+
+    void WriteBytes(std::string_view bytes) {
+        buffer_.append(bytes);
+    }
+
+private:
+    std::string& buffer_;
+};
+
+// Чтение из готового буфера. При выходе за его границы бросает std::out_of_range
+class Reader {
+public:
+    explicit Reader(std::string_view data)
+        : data_{data} {}
+
+    template <typename T>
+    T Read() {
+        static_assert(std::is_arithmetic_v<T>);
+        T value;
+        std::memcpy(&value, Take(sizeof(T)).data(), sizeof(T));
+        return value;
+    }
+
+    template <typename Size = uint32_t>
+    std::string_view ReadString() {
+        return Take(Read<Size>());
+    }
+
+    std::string_view Take(size_t size) {
+        if (size > data_.size() - offset_) {
+            throw std::out_of_range("Unexpected end of binary data");
+        }
+        std::string_view result = data_.substr(offset_, size);
+        offset_ += size;
+        return result;
+    }
+
+    bool AtEnd() const {
+        return offset_ == data_.size();
+    }
+
+    size_t Offset() const {
+        return offset_;
+    }
+
+private:
+    std::string_view data_;
+    size_t offset_ = 0;
+};
+
+// FNV-1a: быстрый хеш для проверки, что данные не изменились
+inline uint64_t Hash(std::string_view data) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char ch : data) {
+        hash = (hash ^ ch) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// Записывает буфер в файловый дескриптор целиком, повторяя прерванные вызовы write
+inline void WriteAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        const ssize_t written = ::write(fd, data.data(), data.size());
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "write");
+        }
+        data.remove_prefix(static_cast<size_t>(written));
+    }
+}
+
+// Всё содержимое файла одним чтением. nullopt, если файл не открылся
+inline std::optional<std::string> ReadFile(const std::filesystem::path& path) {
+    std::ifstream file{path, std::ios::binary | std::ios::ate};
+    if (!file.is_open()) {
+        return std::nullopt;
+    }
+
+    std::string data(static_cast<size_t>(file.tellg()), '\0');
+    file.seekg(0);
+    if (!file.read(data.data(), static_cast<std::streamsize>(data.size()))) {
+        throw std::runtime_error("Can't read " + path.string());
+    }
+    return data;
+}
+
+} // namespace binary_io
+
+#endif
@@ -0,0 +1,186 @@
+#include "collision.h"
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+namespace collision {
+
+namespace {
+
+// Момент наибольшего сближения точки, движущейся из start в start + velocity за тик, с началом координат
+double ClosestTime(DogPoint start, DogPoint velocity) {
+    const double speed2 = velocity.x * velocity.x + velocity.y * velocity.y;
+    if (speed2 == 0.0) {
+        return 0.0;
+    }
+    return std::clamp(-(start.x * velocity.x + start.y * velocity.y) / speed2, 0.0, 1.0);
+}
+
+double SquaredLength(DogPoint start, DogPoint velocity, double time) {
+    const double x = start.x + velocity.x * time;
+    const double y = start.y + velocity.y * time;
+    return x * x + y * y;
+}
+
+} // namespace
+
+Broadphase::Broadphase(double cell_size)
+    : cell_size_{cell_size > 0.0 ? cell_size : 1.0} {
+}
+
+int64_t Broadphase::CellOf(double coord) const {
+    return static_cast<int64_t>(std::floor(coord / cell_size_));
+}
+
+uint64_t Broadphase::Key(int64_t x, int64_t y) const {
+    if (dense_) {
+        return static_cast<uint64_t>(x - origin_x_) * height_ + static_cast<uint64_t>(y - origin_y_);
+    }
+    return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+}
+
+void Broadphase::AddEntries(uint32_t index, const Box& box) {
+    const int64_t x1 = CellOf(box.max_x);
+    const int64_t y1 = CellOf(box.max_y);
+    for (int64_t x = CellOf(box.min_x); x <= x1; ++x) {
+        for (int64_t y = CellOf(box.min_y); y <= y1; ++y) {
+            entries_.push_back({Key(x, y), index});
+        }
+    }
+}
+
+const std::vector<Contact>& Broadphase::FindContacts(const std::vector<Mover>& movers, const std::vector<Item>& items) {
+    boxes_.clear();
+    entries_.clear();
+    contacts_.clear();
+    candidates_ = 0;
+
+    // Псы - индексы [0, movers.size()), офисы - следом за ними
+    for (const auto& mover : movers) {
+        const double half = mover.width / 2;
+        boxes_.push_back({std::min(mover.start.x, mover.end.x) - half, std::min(mover.start.y, mover.end.y) - half,
+                          std::max(mover.start.x, mover.end.x) + half, std::max(mover.start.y, mover.end.y) + half});
+    }
+    for (const auto& item : items) {
+        const double half = item.width / 2;
+        boxes_.push_back({item.position.x - half, item.position.y - half, item.position.x + half, item.position.y + half});
+    }
+    if (boxes_.empty()) {
+        return contacts_;
+    }
+
+    // Занятая область сетки. Если ячеек в ней не сильно больше, чем объектов, их нумерация плотная
+    Box bounds = boxes_.front();
+    for (const Box& box : boxes_) {
+        bounds = {std::min(bounds.min_x, box.min_x), std::min(bounds.min_y, box.min_y),
+                  std::max(bounds.max_x, box.max_x), std::max(bounds.max_y, box.max_y)};
+    }
+    origin_x_ = CellOf(bounds.min_x);
+    origin_y_ = CellOf(bounds.min_y);
+    width_ = static_cast<uint64_t>(CellOf(bounds.max_x) - origin_x_ + 1);
+    height_ = static_cast<uint64_t>(CellOf(bounds.max_y) - origin_y_ + 1);
+    dense_ = width_ <= (uint64_t{1} << 20) && height_ <= (uint64_t{1} << 20)
+        && width_ * height_ <= 8 * boxes_.size() + 1024;
+
+    for (size_t i = 0; i < boxes_.size(); ++i) {
+        AddEntries(static_cast<uint32_t>(i), boxes_[i]);
+    }
+    GroupByCell();
+
+    for (size_t begin = 0; begin < entries_.size();) {
+        const uint64_t cell = entries_[begin].cell;
+        size_t end = begin + 1;
+        while (end < entries_.size() && entries_[end].cell == cell) {
+            ++end;
+        }
+
+        // Пары перебираются от движущихся псов: стоящие в одной ячейке псы не дают
+        // квадратичного числа проверок
+        for (size_t p = begin; p < end; ++p) {
+            const uint32_t a = entries_[p].index;
+            if (a >= movers.size() || !movers[a].IsMoving()) {
+                continue;
+            }
+            for (size_t q = begin; q < end; ++q) {
+                const uint32_t b = entries_[q].index;
+                // пару двух движущихся псов проверяет пёс с меньшим индексом
+                if (b == a || (b < movers.size() && movers[b].IsMoving() && b < a)) {
+                    continue;
+                }
+                TestPair(cell, a, b, movers, items);
+            }
+        }
+        begin = end;
+    }
+
+    std::sort(contacts_.begin(), contacts_.end(), [](const Contact& lhs, const Contact& rhs) {
+        return std::tie(lhs.time, lhs.type, lhs.first, lhs.second) < std::tie(rhs.time, rhs.type, rhs.first, rhs.second);
+    });
+    return contacts_;
+}
+
+void Broadphase::GroupByCell() {
+    if (!dense_) {
+        // Порядок внутри ячейки не важен: итоговые контакты сортируются отдельно
+        std::sort(entries_.begin(), entries_.end(), [](const Entry& lhs, const Entry& rhs) {
+            return lhs.cell < rhs.cell;
+        });
+        return;
+    }
+
+    // Сортировка подсчётом по номеру ячейки
+    cell_starts_.assign(width_ * height_ + 1, 0);
+    for (const Entry& entry : entries_) {
+        ++cell_starts_[entry.cell + 1];
+    }
+    for (size_t i = 1; i < cell_starts_.size(); ++i) {
+        cell_starts_[i] += cell_starts_[i - 1];
+    }
+    sorted_.resize(entries_.size());
+    for (const Entry& entry : entries_) {
+        sorted_[cell_starts_[entry.cell]++] = entry;
+    }
+    entries_.swap(sorted_);
+}
+
+void Broadphase::TestPair(uint64_t cell, uint32_t a, uint32_t b, const std::vector<Mover>& movers, const std::vector<Item>& items) {
+    const Box& lhs = boxes_[a];
+    const Box& rhs = boxes_[b];
+    const double min_x = std::max(lhs.min_x, rhs.min_x);
+    const double min_y = std::max(lhs.min_y, rhs.min_y);
+    if (min_x > std::min(lhs.max_x, rhs.max_x) || min_y > std::min(lhs.max_y, rhs.max_y)) {
+        return;
+    }
+    // Пересекающиеся прямоугольники делят несколько ячеек - пару проверяет одна из них
+    if (Key(CellOf(min_x), CellOf(min_y)) != cell) {
+        return;
+    }
+    ++candidates_;
+
+    const Mover& dog = movers[a];
+    const DogPoint dog_velocity{dog.end.x - dog.start.x, dog.end.y - dog.start.y};
+
+    if (b >= movers.size()) {
+        const Item& item = items[b - movers.size()];
+        const DogPoint start{dog.start.x - item.position.x, dog.start.y - item.position.y};
+        const double time = ClosestTime(start, dog_velocity);
+        const double reach = (dog.width + item.width) / 2;
+        if (SquaredLength(start, dog_velocity, time) <= reach * reach) {
+            contacts_.push_back({ContactType::DOG_OFFICE, a, b - movers.size(), time});
+        }
+        return;
+    }
+
+    // Два пса: движение одного относительно другого
+    const Mover& other = movers[b];
+    const DogPoint start{dog.start.x - other.start.x, dog.start.y - other.start.y};
+    const DogPoint velocity{dog_velocity.x - (other.end.x - other.start.x), dog_velocity.y - (other.end.y - other.start.y)};
+    const double time = ClosestTime(start, velocity);
+    const double reach = (dog.width + other.width) / 2;
+    if (SquaredLength(start, velocity, time) <= reach * reach) {
+        contacts_.push_back({ContactType::DOG_DOG, std::min(a, b), std::max(a, b), time});
+    }
+}
+
+} // namespace collision
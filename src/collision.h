@@ -0,0 +1,106 @@
+#ifndef __COLLISION__
+#define __COLLISION__
+
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "map.h"
+
+namespace collision {
+
+using model::DogPoint;
+
+// Ширина пса и офиса: контакт - когда центры сближаются на полусумму ширин
+constexpr double DOG_WIDTH = 0.6;
+constexpr double OFFICE_WIDTH = 0.5;
+
+enum class ContactType : uint8_t {
+    DOG_OFFICE,
+    DOG_DOG
+};
+
+// Отрезок, пройденный псом за тик
+struct Mover {
+    DogPoint start;
+    DogPoint end;
+    double width = DOG_WIDTH;
+
+    bool IsMoving() const {
+        return start.x != end.x || start.y != end.y;
+    }
+};
+
+// Неподвижный объект карты (офис)
+struct Item {
+    DogPoint position;
+    double width = OFFICE_WIDTH;
+};
+
+// Сближение за тик. first - индекс пса, second - индекс офиса или второго пса.
+// time - доля тика [0, 1], на которой они ближе всего
+struct Contact {
+    ContactType type;
+    size_t first;
+    size_t second;
+    double time;
+};
+
+// Поиск контактов за тик. Широкая фаза - равномерная сетка: каждый отрезок (с запасом на ширину)
+// попадает во все ячейки, которые пересекает его ограничивающий прямоугольник, и проверяется
+// только с соседями по ячейкам. Записи группируются по ячейкам сортировкой подсчётом, если
+// занятая область сетки невелика, иначе обычной сортировкой. Узкая фаза - точное наибольшее
+// сближение на отрезке.
+// Контакты порождает только движение: стоящие псы не сближаются ни друг с другом, ни с офисами.
+// Буферы переиспользуются между тиками
+class Broadphase {
+public:
+    explicit Broadphase(double cell_size = 2.0);
+
+    // Контакты, упорядоченные по времени, затем по типу и индексам.
+    // Ссылка действительна до следующего вызова
+    const std::vector<Contact>& FindContacts(const std::vector<Mover>& movers, const std::vector<Item>& items);
+
+    // Пар, дошедших до узкой фазы в последнем вызове
+    size_t GetCandidateCount() const {
+        return candidates_;
+    }
+
+private:
+    struct Box {
+        double min_x, min_y, max_x, max_y;
+    };
+
+    struct Entry {
+        uint64_t cell;
+        uint32_t index;
+    };
+
+    void AddEntries(uint32_t index, const Box& box);
+    void GroupByCell();
+    void TestPair(uint64_t cell, uint32_t a, uint32_t b, const std::vector<Mover>& movers, const std::vector<Item>& items);
+
+    int64_t CellOf(double coord) const;
+    uint64_t Key(int64_t x, int64_t y) const;
+
+    double cell_size_;
+    // Плотная нумерация ячеек в прямоугольнике [origin_x_, origin_x_ + width_) x [origin_y_, origin_y_ + height_)
+    bool dense_ = false;
+    int64_t origin_x_ = 0;
+    int64_t origin_y_ = 0;
+    uint64_t width_ = 0;
+    uint64_t height_ = 0;
+
+    std::vector<Box> boxes_;
+    std::vector<Entry> entries_;
+    std::vector<Entry> sorted_;
+    std::vector<uint32_t> cell_starts_;
+    std::vector<Contact> contacts_;
+    size_t candidates_ = 0;
+};
+
+} // namespace collision
+
+#endif
@@ -0,0 +1,159 @@
+#include "cpu_topology.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace cpu_topology {
+
+using namespace std::literals;
+
+namespace {
+
+std::optional<std::string> ReadFirstLine(const std::filesystem::path& path) {
+    std::ifstream file{path};
+    std::string line;
+    if (!file || !std::getline(file, line)) {
+        return std::nullopt;
+    }
+    return line;
+}
+
+std::optional<long long> ParseNumber(std::string_view text) {
+    long long value = 0;
+    const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc{} || end != text.data() + text.size()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+std::optional<double> MakeLimit(std::optional<long long> quota, std::optional<long long> period) {
+    // Отрицательная квота (v1) - лимита нет
+    if (!quota || !period || *quota <= 0 || *period <= 0) {
+        return std::nullopt;
+    }
+    return static_cast<double>(*quota) / static_cast<double>(*period);
+}
+
+} // namespace
+
+std::optional<double> ReadCgroupCpuLimit(const std::filesystem::path& root) {
+    // cgroup v2: "<квота> <период>" или "max <период>"
+    if (auto line = ReadFirstLine(root / "cpu.max"); line.has_value()) {
+        const size_t space = line->find(' ');
+        if (space == std::string::npos || std::string_view{*line}.substr(0, space) == "max"sv) {
+            return std::nullopt;
+        }
+        return MakeLimit(ParseNumber(std::string_view{*line}.substr(0, space)),
+                         ParseNumber(std::string_view{*line}.substr(space + 1)));
+    }
+
+    // cgroup v1: контроллер cpu смонтирован отдельно или вместе с cpuacct
+    for (const char* controller : {"cpu", "cpu,cpuacct"}) {
+        auto quota = ReadFirstLine(root / controller / "cpu.cfs_quota_us");
+        auto period = ReadFirstLine(root / controller / "cpu.cfs_period_us");
+        if (quota.has_value() && period.has_value()) {
+            return MakeLimit(ParseNumber(*quota), ParseNumber(*period));
+        }
+    }
+    return std::nullopt;
+}
+
+unsigned GetAffinityCpuCount() {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        return static_cast<unsigned>(std::max(CPU_COUNT(&set), 1));
+    }
+#endif
+    return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+unsigned GetAvailableCpus() {
+    unsigned cpus = GetAffinityCpuCount();
+    if (auto limit = ReadCgroupCpuLimit(); limit.has_value()) {
+        // Квота 1.5 ядра даёт 2 потока: второй поток загружен наполовину
+        cpus = std::min(cpus, static_cast<unsigned>(std::ceil(*limit)));
+    }
+    return std::max(cpus, 1u);
+}
+
+std::vector<unsigned> ParseCpuList(std::string_view list) {
+    std::vector<unsigned> cpus;
+    auto parse_cpu = [list](std::string_view text) {
+        auto value = ParseNumber(text);
+        if (!value || *value < 0 || *value >= 4096) {
+            throw std::invalid_argument("Invalid CPU list: "s + std::string(list));
+        }
+        return static_cast<unsigned>(*value);
+    };
+
+    while (!list.empty()) {
+        const size_t comma = std::min(list.find(','), list.size());
+        const std::string_view item = list.substr(0, comma);
+        if (const size_t dash = item.find('-'); dash != std::string_view::npos) {
+            const unsigned first = parse_cpu(item.substr(0, dash));
+            const unsigned last = parse_cpu(item.substr(dash + 1));
+            if (first > last) {
+                throw std::invalid_argument("Invalid CPU range: "s + std::string(item));
+            }
+            for (unsigned cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        } else if (!item.empty()) {
+            cpus.push_back(parse_cpu(item));
+        }
+        list.remove_prefix(std::min(comma + 1, list.size()));
+    }
+    return cpus;
+}
+
+bool PinCurrentThread(unsigned cpu) {
+#ifdef __linux__
+    if (cpu >= CPU_SETSIZE) {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+bool ThreadRole::Pin(unsigned index) const {
+    if (cpus.empty()) {
+        return true;
+    }
+    return PinCurrentThread(cpus[index % cpus.size()]);
+}
+
+void ThreadTopology::ApplyDefaults(unsigned cpus) {
+    cpus = std::max(cpus, 1u);
+    // Сеть и тик работают постоянно и занимают все ядра. Потоки симуляции нагружены только
+    // во время тика, пока strand игры ждёт их, поэтому тоже получают по потоку на ядро
+    if (io.threads == 0) {
+        io.threads = cpus;
+    }
+    if (simulation.threads == 0) {
+        simulation.threads = cpus;
+    }
+    // Чтение статики в основном ждёт диск, нескольких потоков хватает
+    if (file_io.threads == 0) {
+        file_io.threads = std::clamp(cpus / 4, 1u, 4u);
+    }
+}
+
+} // namespace cpu_topology
@@ -0,0 +1,52 @@
+#ifndef __CPU_TOPOLOGY__
+#define __CPU_TOPOLOGY__
+
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#pragma once
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace cpu_topology {
+
+// Лимит процессора из cgroup в ядрах (cpu.max для v2, cpu.cfs_quota_us / cpu.cfs_period_us для v1).
+// nullopt - лимита нет или cgroup недоступна
+std::optional<double> ReadCgroupCpuLimit(const std::filesystem::path& root = "/sys/fs/cgroup");
+
+// Ядра, на которых процессу разрешено работать (sched_getaffinity, учитывает cpuset контейнера)
+unsigned GetAffinityCpuCount();
+
+// Ядра, доступные процессу с учётом affinity и квоты cgroup. В отличие от
+// std::thread::hardware_concurrency() не видит ядер хоста сверх лимита контейнера. Не меньше 1
+unsigned GetAvailableCpus();
+
+// Список ядер вида "0-3,8,10-11". Бросает std::invalid_argument при ошибке разбора
+std::vector<unsigned> ParseCpuList(std::string_view list);
+
+// Привязывает текущий поток к ядру cpu. false - привязка не удалась (ядра нет или нет прав)
+bool PinCurrentThread(unsigned cpu);
+
+// Потоки одной роли. Если cpus не пуст, i-й поток роли привязывается к cpus[i % cpus.size()]
+struct ThreadRole {
+    unsigned threads = 0;
+    std::vector<unsigned> cpus;
+
+    // Привязывает текущий поток как index-й поток роли, без списка ядер ничего не делает
+    bool Pin(unsigned index) const;
+};
+
+// Роли потоков сервера
+struct ThreadTopology {
+    ThreadRole io;          // приём соединений, сеть и strand игры
+    ThreadRole simulation;  // параллельное обновление экземпляров карт на тике
+    ThreadRole file_io;     // блокирующее чтение статических файлов
+
+    // Заполняет незаданные (0) числа потоков исходя из cpus доступных ядер
+    void ApplyDefaults(unsigned cpus);
+};
+
+} // namespace cpu_topology
+
+#endif
@@ -1,14 +1,169 @@
 #include "http_server.h"
 
 #include <boost/asio/dispatch.hpp>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+
+#ifdef __linux__
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
 
 namespace http_server {
-    void SessionBase::Run() {
+
+namespace {
+
+// Целочисленная опция сокета, которой нет среди готовых опций Asio
+template <int Level, int Name>
+class IntegerOption {
+public:
+    explicit IntegerOption(int value)
+        : value_{value} {
+    }
+
+    template <typename Protocol>
+    int level(const Protocol&) const {
+        return Level;
+    }
+
+    template <typename Protocol>
+    int name(const Protocol&) const {
+        return Name;
+    }
+
+    template <typename Protocol>
+    const int* data(const Protocol&) const {
+        return &value_;
+    }
+
+    template <typename Protocol>
+    size_t size(const Protocol&) const {
+        return sizeof(value_);
+    }
+
+private:
+    int value_;
+};
+
+template <typename Socket, typename Option>
+void SetOption(Socket& socket, const Option& option, std::string_view what) {
+    sys::error_code ec;
+    socket.set_option(option, ec);
+    if (ec) {
+        ReportError(ec, what);
+    }
+}
+
+#ifdef __linux__
+std::optional<tcp_info> GetTcpInfo(int fd) {
+    tcp_info info{};
+    socklen_t size = sizeof(info);
+    if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &size) != 0) {
+        return std::nullopt;
+    }
+    return info;
+}
+#endif
+
+} // namespace
+
+void SessionBase::Run() {
     // Вызываем метод Read, используя executor объекта stream_.
     // Таким образом вся работа со stream_ будет выполняться, используя его executor
     net::dispatch(stream_.get_executor(),
                   beast::bind_front_handler(&SessionBase::Read, GetSharedThis()));
+}
+
+void ConfigureAcceptor(tcp::acceptor& acceptor, const ListenerOptions& options) {
+    if (options.receive_buffer > 0) {
+        SetOption(acceptor, net::socket_base::receive_buffer_size(options.receive_buffer), "SO_RCVBUF"sv);
+    }
+#ifdef __linux__
+    if (options.defer_accept > 0) {
+        SetOption(acceptor, IntegerOption<IPPROTO_TCP, TCP_DEFER_ACCEPT>(options.defer_accept), "TCP_DEFER_ACCEPT"sv);
+    }
+    if (options.fastopen_queue > 0) {
+        SetOption(acceptor, IntegerOption<IPPROTO_TCP, TCP_FASTOPEN>(options.fastopen_queue), "TCP_FASTOPEN"sv);
+    }
+#endif
+}
+
+void ConfigureSocket(tcp::socket& socket, const ListenerOptions& options) {
+    if (options.tcp_nodelay) {
+        SetOption(socket, tcp::no_delay(true), "TCP_NODELAY"sv);
+    }
+    if (options.send_buffer > 0) {
+        SetOption(socket, net::socket_base::send_buffer_size(options.send_buffer), "SO_SNDBUF"sv);
     }
+    if (options.keepalive_idle > 0) {
+        SetOption(socket, net::socket_base::keep_alive(true), "SO_KEEPALIVE"sv);
+#ifdef __linux__
+        SetOption(socket, IntegerOption<IPPROTO_TCP, TCP_KEEPIDLE>(options.keepalive_idle), "TCP_KEEPIDLE"sv);
+        if (options.keepalive_interval > 0) {
+            SetOption(socket, IntegerOption<IPPROTO_TCP, TCP_KEEPINTVL>(options.keepalive_interval), "TCP_KEEPINTVL"sv);
+        }
+        if (options.keepalive_count > 0) {
+            SetOption(socket, IntegerOption<IPPROTO_TCP, TCP_KEEPCNT>(options.keepalive_count), "TCP_KEEPCNT"sv);
+        }
+#endif
+    }
+}
+
+std::optional<std::chrono::microseconds> GetAcceptWait([[maybe_unused]] tcp::socket& socket) {
+#ifdef __linux__
+    // У нового соединения время последнего пакета клиента - это ACK рукопожатия или первый запрос
+    if (auto info = GetTcpInfo(socket.native_handle()); info.has_value()) {
+        return std::chrono::milliseconds{info->tcpi_last_ack_recv};
+    }
+#endif
+    return std::nullopt;
+}
+
+std::optional<uint64_t> GetAcceptQueueLength([[maybe_unused]] tcp::acceptor& acceptor) {
+#ifdef __linux__
+    // У слушающего сокета tcpi_unacked - текущая длина очереди принятых соединений
+    if (auto info = GetTcpInfo(acceptor.native_handle()); info.has_value()) {
+        return info->tcpi_unacked;
+    }
+#endif
+    return std::nullopt;
+}
+
+std::optional<uint64_t> ReadListenOverflows() {
+    // Строки парами: "TcpExt: <имена>" и "TcpExt: <значения>" в том же порядке
+    std::ifstream file{"/proc/net/netstat"};
+    std::string names;
+    std::string values;
+    while (std::getline(file, names) && std::getline(file, values)) {
+        if (!names.starts_with("TcpExt:"sv)) {
+            continue;
+        }
+        std::istringstream name_stream{names};
+        std::istringstream value_stream{values};
+        std::string name;
+        std::string value;
+        while (name_stream >> name && value_stream >> value) {
+            if (name == "ListenOverflows"sv) {
+                return std::stoull(value);
+            }
+        }
+    }
+    return std::nullopt;
+}
+
+const ListenerMetrics& ListenerMetrics::Get() {
+    static const ListenerMetrics listener_metrics{
+        metrics::Registry::Instance().AddCounter("http_accepted_total"sv, "Accepted TCP connections"sv),
+        metrics::Registry::Instance().AddCounter("http_accept_errors_total"sv, "Failed accept calls"sv),
+        metrics::Registry::Instance().AddHistogram("http_accept_wait_seconds"sv,
+            "Time an accepted connection waited in the listen queue (since the last client packet)"sv),
+        metrics::Registry::Instance().AddGauge("http_accept_queue_length"sv,
+            "Connections waiting in the listen queue, sampled every second"sv),
+        metrics::Registry::Instance().AddCounter("http_listen_overflows_total"sv,
+            "Connections dropped by the host because a listen queue was full (ListenOverflows)"sv)};
+    return listener_metrics;
+}
 
 }  // namespace http_server
@@ -5,15 +5,28 @@
 
 #pragma once
 #include "sdk.h"
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/co_spawn.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/use_awaitable.hpp>
 #include <boost/asio/strand.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
 #include <boost/json.hpp>
 
+#include <atomic>
+#include <chrono>
 #include <iostream>
+#include <memory_resource>
+#include <optional>
+#include <utility>
 
 #include "logger.h"
+#include "arena.h"
+#include "metrics.h"
+#include "tracing.h"
 
 namespace http_server {
 
@@ -24,50 +37,141 @@ namespace http = beast::http;
 
 using tcp = net::ip::tcp;
 using namespace std::literals;
-using HttpRequest = http::request<http::string_body>;
+using HttpRequest = http::request<ArenaStringBody, ArenaFields>;
 
 inline void ReportError(beast::error_code ec, std::string_view what) {
     boost::json::value custom_data{{"code"s, ec.value()}, {"text", ec.message()}, {"where", what}};
     logger::LogJSON(custom_data, "error"sv);
 }
 
+// Как устроена обработка соединения
+enum class SessionModel {
+    CALLBACKS,   // цепочка обработчиков Read -> OnRead -> HandleRequest -> Write -> OnWrite (Session)
+    COROUTINES   // одна сопрограмма на соединение (RunCoroSession)
+};
+
+// Настройки слушающего и принятых сокетов. 0 - значение ОС по умолчанию или опция выключена
+struct ListenerOptions {
+    bool tcp_nodelay = true;          // TCP_NODELAY: ответ уходит сразу, без задержки Нейгла
+    int defer_accept = 0;             // TCP_DEFER_ACCEPT, секунд: соединение отдаётся, когда пришёл запрос
+    int fastopen_queue = 0;           // TCP_FASTOPEN: длина очереди соединений с данными в SYN
+    int send_buffer = 0;              // SO_SNDBUF, байт
+    int receive_buffer = 0;           // SO_RCVBUF, байт: задаётся слушающему сокету, принятые его наследуют
+    int keepalive_idle = 0;           // SO_KEEPALIVE и TCP_KEEPIDLE, секунд простоя до первой пробы
+    int keepalive_interval = 0;       // TCP_KEEPINTVL, секунд между пробами
+    int keepalive_count = 0;          // TCP_KEEPCNT, проб до разрыва
+    unsigned concurrent_accepts = 1;  // одновременно ожидающих async_accept
+    int backlog = net::socket_base::max_listen_connections;
+    SessionModel session_model = SessionModel::CALLBACKS;
+};
+
+// Опции слушающего сокета, которые надо задать до listen. Ошибки пишутся в лог
+void ConfigureAcceptor(tcp::acceptor& acceptor, const ListenerOptions& options);
+// Опции принятого соединения
+void ConfigureSocket(tcp::socket& socket, const ListenerOptions& options);
+
+// Сколько принятое соединение ждало в очереди: время с последнего пакета клиента (TCP_INFO,
+// точность - миллисекунды). Если клиент успел прислать запрос, оценка меньше настоящей
+std::optional<std::chrono::microseconds> GetAcceptWait(tcp::socket& socket);
+// Соединения в очереди слушающего сокета, ещё не принятые приложением
+std::optional<uint64_t> GetAcceptQueueLength(tcp::acceptor& acceptor);
+// Счётчик ListenOverflows из /proc/net/netstat: соединения, отброшенные из-за полной очереди,
+// по всем слушающим сокетам машины
+std::optional<uint64_t> ReadListenOverflows();
+
+// Метрики приёма соединений, общие для всех Listener
+struct ListenerMetrics {
+    metrics::Counter accepted;
+    metrics::Counter accept_errors;
+    metrics::Histogram accept_wait;
+    metrics::Gauge accept_queue;
+    metrics::Counter listen_overflows;
+
+    static const ListenerMetrics& Get();
+};
+
+inline const metrics::Gauge& OpenSessions() {
+    static const metrics::Gauge gauge = metrics::Registry::Instance().AddGauge(
+        "http_open_sessions"sv, "Number of open HTTP connections"sv);
+    return gauge;
+}
+
 class SessionBase {
 public:
     SessionBase(const SessionBase&) = delete;
     SessionBase& operator=(const SessionBase&) = delete;
-    ~SessionBase() = default;
+    ~SessionBase() {
+        OpenSessions().Add(-1);
+    }
     void Run();
 
 protected:
     template <typename Body, typename Fields>
     void Write(http::response<Body, Fields>&& response) {
-        // Запись выполняется асинхронно, поэтому response перемещаем в область кучи
-        auto safe_response = std::make_shared<http::response<Body, Fields>>(std::move(response));
-
-        auto self = GetSharedThis();
-        http::async_write(stream_, *safe_response,
-                          [safe_response, self](beast::error_code ec, std::size_t bytes_written) {
-                              self->OnWrite(safe_response->need_eof(), ec, bytes_written);
-                          });
+        // Запись выполняется асинхронно, поэтому response перемещаем в арену соединения
+        PendingWrite<http::response<Body, Fields>> write{GetSharedThis(), std::allocate_shared<http::response<Body, Fields>>(
+            arena_.GetAllocator(), std::move(response))};
+
+        // Ответ может прийти из strand игры или пула файлов: запись начинается в executor соединения,
+        // иначе её завершение на другом потоке гонится с инициирующим вызовом
+        net::dispatch(stream_.get_executor(), [write = std::move(write)]() mutable {
+            auto& self = *write.self;
+            auto& response = *write.response;
+            http::async_write(self.stream_, response,
+                              [write = std::move(write), write_start = tracing::Now()](beast::error_code ec, std::size_t bytes_written) mutable {
+                                  auto self = std::move(write.self);
+                                  // сериализация ответа и запись в сокет
+                                  tracing::Complete("http.write", self->trace_id_, write_start);
+
+                                  // ответ должен быть разрушен до освобождения арены в OnWrite
+                                  const bool close = write.response->need_eof();
+                                  write.response.reset();
+                                  self->OnWrite(close, ec, bytes_written);
+                              });
+        });
     }
 
     explicit SessionBase(tcp::socket&& socket)
         : stream_(std::move(socket)) {
+        OpenSessions().Add(1);
+        // Адрес клиента запоминаем сразу: после закрытия соединения remote_endpoint() уже недоступен
+        sys::error_code ec;
+        remote_endpoint_ = stream_.socket().remote_endpoint(ec);
+    }
+
+    const tcp::endpoint& GetRemoteEndpoint() const {
+        return remote_endpoint_;
     }
 
 private:
+    // Ответ лежит в арене сессии. Члены разрушаются в обратном порядке, поэтому ответ освобождается
+    // раньше сессии и тогда, когда обработчик записи уничтожается без вызова при остановке io_context
+    template <typename Response>
+    struct PendingWrite {
+        std::shared_ptr<SessionBase> self;
+        std::shared_ptr<Response> response;
+    };
+
     // tcp_stream содержит внутри себя сокет и добавляет поддержку таймаутов
     beast::tcp_stream stream_;
-    beast::flat_buffer buffer_;
-    HttpRequest request_;
+    tcp::endpoint remote_endpoint_;
+    // Буфер чтения живёт всё соединение, его память учитывается в memory::Subsystem::CONNECTIONS
+    beast::basic_flat_buffer<ArenaAllocator> buffer_{ArenaAllocator{memory::GetResource(memory::Subsystem::CONNECTIONS)}};
+    RequestArena arena_;
+    std::optional<HttpRequest> request_;
+    // номер запроса в трассировке и время окончания его чтения
+    uint64_t trace_id_ = 0;
+    tracing::Clock::time_point request_start_;
 
     void Read() {
         using namespace std::literals;
-        // Очищаем запрос от прежнего значения (метод Read может быть вызван несколько раз)
-        request_ = {};
+        // Создаём новый запрос в арене соединения (метод Read может быть вызван несколько раз)
+        request_.emplace(std::piecewise_construct,
+                         std::make_tuple(arena_.GetAllocator()),
+                         std::make_tuple(arena_.GetAllocator()));
         stream_.expires_after(30s);
         // Считываем request_ из stream_, используя buffer_ для хранения считанных данных
-        http::async_read(stream_, buffer_, request_,
+        http::async_read(stream_, buffer_, *request_,
                          // По окончании операции будет вызван метод OnRead
                          beast::bind_front_handler(&SessionBase::OnRead, GetSharedThis()));
     }
@@ -81,7 +185,12 @@ private:
         if (ec) {
             return ReportError(ec, "read"sv);
         }
-        HandleRequest(std::move(request_));
+
+        request_start_ = tracing::Now();
+        trace_id_ = request_start_ != tracing::Clock::time_point{} ? tracing::Tracer::Instance().NextId() : 0;
+        // обработчик и всё, что он вызывает синхронно, видят номер запроса через tracing::CurrentId()
+        tracing::ScopedId scoped_id{trace_id_};
+        HandleRequest(std::move(*request_));
     }
 
     void Close() {
@@ -89,6 +198,11 @@ private:
     }
 
     void OnWrite(bool close, beast::error_code ec, [[maybe_unused]] std::size_t bytes_written) {
+        // Запрос и ответ больше не нужны - освобождаем всю память запроса разом
+        request_.reset();
+        arena_.Release();
+        tracing::Complete("http.request", trace_id_, request_start_);
+
         if (ec) {
             return ReportError(ec, "write"sv);
         }
@@ -125,7 +239,7 @@ private:
         // Используется generic-лямбда функция, способная принять response произвольного типа
         request_handler_(std::move(request), [self = this->shared_from_this()](auto&& response) {
             self->Write(std::move(response));
-        });
+        }, GetRemoteEndpoint());
     }
 
     std::shared_ptr<SessionBase> GetSharedThis() override {
@@ -133,15 +247,244 @@ private:
     }
 };
 
+// Ответ, который обработчик передал сопрограмме соединения. Тип ответа выбирает обработчик,
+// поэтому он хранится за виртуальным интерфейсом в арене соединения
+class PendingResponse {
+public:
+    virtual ~PendingResponse() = default;
+
+    virtual net::awaitable<size_t> Write(beast::tcp_stream& stream, beast::error_code& ec) = 0;
+    virtual bool NeedEof() const = 0;
+};
+
+template <typename Response>
+class PendingResponseImpl final : public PendingResponse {
+public:
+    explicit PendingResponseImpl(Response&& response)
+        : response_{std::move(response)} {
+    }
+
+    // Не сопрограмма: отдаёт ожидание самой записи, без лишнего кадра на запрос
+    net::awaitable<size_t> Write(beast::tcp_stream& stream, beast::error_code& ec) override {
+        return http::async_write(stream, response_, net::redirect_error(net::use_awaitable, ec));
+    }
+
+    bool NeedEof() const override {
+        return response_.need_eof();
+    }
+
+private:
+    Response response_;
+};
+
+// Место встречи сопрограммы соединения и обработчика запроса. Живёт в кадре сопрограммы.
+// Сопрограмма продолжается, когда разрушена последняя копия функции отправки: к этому моменту
+// ответ уже в слоте (или обработчик отказался отвечать), и слот можно готовить к следующему запросу.
+// Копии считаются атомарно - обработчик может передать функцию отправки в strand игры или пул файлов
+class ResponseSlot {
+public:
+    class Sender {
+    public:
+        Sender(ResponseSlot& slot, RequestArena& arena)
+            : slot_{&slot}
+            , arena_{&arena} {
+        }
+
+        Sender(const Sender& other)
+            : slot_{other.slot_}
+            , arena_{other.arena_} {
+            if (slot_) {
+                slot_->senders_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        Sender(Sender&& other) noexcept
+            : slot_{std::exchange(other.slot_, nullptr)}
+            , arena_{other.arena_} {
+        }
+
+        Sender& operator=(const Sender&) = delete;
+        Sender& operator=(Sender&&) = delete;
+
+        ~Sender() {
+            if (slot_ && slot_->senders_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                slot_->Complete();
+            }
+        }
+
+        // Сопрограмма ждёт слот и не трогает арену, поэтому ответ строится в ней прямо в потоке обработчика.
+        // Как и в Session, ответ забирается и из lvalue
+        template <typename Response>
+        void operator()(Response&& response) const {
+            using Pending = PendingResponseImpl<std::decay_t<Response>>;
+            if (slot_->response_ != nullptr) {
+                return;
+            }
+            std::pmr::polymorphic_allocator<> allocator{arena_->Resource()};
+            slot_->response_ = allocator.new_object<Pending>(std::move(response));
+        }
+
+    private:
+        ResponseSlot* slot_;
+        RequestArena* arena_;
+    };
+
+    explicit ResponseSlot(net::any_io_executor executor)
+        : executor_{executor}
+        , signal_{executor, net::steady_timer::time_point::max()} {
+    }
+
+    ResponseSlot(const ResponseSlot&) = delete;
+    ResponseSlot& operator=(const ResponseSlot&) = delete;
+
+    // Кадр сопрограммы разрушается и посреди записи, например при остановке io_context
+    ~ResponseSlot() {
+        Reset();
+    }
+
+    // Функция отправки очередного запроса. Предыдущий ответ к этому моменту должен быть сброшен
+    Sender MakeSender(RequestArena& arena) {
+        senders_.store(1, std::memory_order_relaxed);
+        completed_ = false;
+        return Sender{*this, arena};
+    }
+
+    bool IsCompleted() const {
+        return completed_;
+    }
+
+    // Ожидание Complete. Таймер без срока служит событием: Complete отменяет ожидание
+    net::awaitable<void> Wait() {
+        return signal_.async_wait(net::redirect_error(net::use_awaitable, wait_ec_));
+    }
+
+    // Ответ обработчика. nullptr - функция отправки разрушена без ответа
+    PendingResponse* GetResponse() const {
+        return response_;
+    }
+
+    // Разрушает ответ. Его память вернётся при освобождении арены
+    void Reset() {
+        if (response_ != nullptr) {
+            response_->~PendingResponse();
+            response_ = nullptr;
+        }
+    }
+
+private:
+    // Вызывается последней копией Sender в любом потоке
+    void Complete() {
+        // Уже в strand соединения (обычно обработчик ответил синхронно) - dispatch с копией исполнителя не нужен
+        if (const auto* strand = executor_.target<net::strand<net::io_context::executor_type>>();
+            strand != nullptr && strand->running_in_this_thread()) {
+            return Signal();
+        }
+        net::dispatch(executor_, [this] {
+            Signal();
+        });
+    }
+
+    void Signal() {
+        completed_ = true;
+        signal_.cancel();
+    }
+
+    net::any_io_executor executor_;
+    net::steady_timer signal_;
+    beast::error_code wait_ec_;
+    std::atomic<unsigned> senders_{0};
+    bool completed_ = false;
+    PendingResponse* response_ = nullptr;
+};
+
+// Сессия на сопрограммах: состояние соединения - локальные переменные одного кадра сопрограммы,
+// запрос и ответ переиспользуют арену соединения, а ожидание обработчика (strand игры, пул файлов)
+// - это co_await, а не переход к следующему обработчику с shared_from_this
+template <typename RequestHandler>
+net::awaitable<void> RunCoroSession(tcp::socket socket, RequestHandler request_handler) {
+    OpenSessions().Add(1);
+    struct SessionGuard {
+        ~SessionGuard() {
+            OpenSessions().Add(-1);
+        }
+    } session_guard;
+
+    // Адрес клиента запоминаем сразу: после закрытия соединения remote_endpoint() уже недоступен
+    sys::error_code endpoint_ec;
+    const tcp::endpoint remote_endpoint = socket.remote_endpoint(endpoint_ec);
+    beast::tcp_stream stream{std::move(socket)};
+    beast::basic_flat_buffer<ArenaAllocator> buffer{ArenaAllocator{memory::GetResource(memory::Subsystem::CONNECTIONS)}};
+    RequestArena arena;
+    std::optional<HttpRequest> request;
+    ResponseSlot slot{stream.get_executor()};
+
+    for (;;) {
+        request.emplace(std::piecewise_construct,
+                        std::make_tuple(arena.GetAllocator()),
+                        std::make_tuple(arena.GetAllocator()));
+        stream.expires_after(30s);
+
+        beast::error_code ec;
+        co_await http::async_read(stream, buffer, *request, net::redirect_error(net::use_awaitable, ec));
+        if (ec == http::error::end_of_stream) {
+            // Нормальная ситуация - клиент закрыл соединение
+            stream.socket().shutdown(tcp::socket::shutdown_send, ec);
+            co_return;
+        }
+        if (ec) {
+            ReportError(ec, "read"sv);
+            co_return;
+        }
+
+        const auto request_start = tracing::Now();
+        const uint64_t trace_id = request_start != tracing::Clock::time_point{} ? tracing::Tracer::Instance().NextId() : 0;
+        {
+            tracing::ScopedId scoped_id{trace_id};
+            request_handler(std::move(*request), slot.MakeSender(arena), remote_endpoint);
+        }
+
+        // Пока обработчик работает в strand игры или в пуле файлов, сопрограмма ждёт здесь
+        while (!slot.IsCompleted()) {
+            co_await slot.Wait();
+        }
+        PendingResponse* response = slot.GetResponse();
+        bool close = true;
+        if (response != nullptr) {
+            const auto write_start = tracing::Now();
+            co_await response->Write(stream, ec);
+            tracing::Complete("http.write", trace_id, write_start);
+            close = response->NeedEof();
+        }
+
+        // Ответ и запрос больше не нужны - освобождаем всю память запроса разом
+        slot.Reset();
+        request.reset();
+        arena.Release();
+        tracing::Complete("http.request", trace_id, request_start);
+
+        if (ec) {
+            ReportError(ec, "write"sv);
+            co_return;
+        }
+        if (close) {
+            // Семантика ответа требует закрыть соединение
+            stream.socket().shutdown(tcp::socket::shutdown_send, ec);
+            co_return;
+        }
+    }
+}
+
 template <typename RequestHandler>
 class Listener : public std::enable_shared_from_this<Listener<RequestHandler>> {
 public:
     template <typename Handler>
-    Listener(net::io_context& ioc, const tcp::endpoint& endpoint, Handler&& request_handler)
+    Listener(net::io_context& ioc, const tcp::endpoint& endpoint, Handler&& request_handler, ListenerOptions options = {})
         : ioc_(ioc)
         // Обработчики асинхронных операций acceptor_ будут вызываться в своём strand
         , acceptor_(net::make_strand(ioc))
-        , request_handler_(std::forward<Handler>(request_handler)) {
+        , sample_timer_(acceptor_.get_executor())
+        , request_handler_(std::forward<Handler>(request_handler))
+        , options_(std::move(options)) {
         // Открываем acceptor, используя протокол (IPv4 или IPv6), указанный в endpoint
         acceptor_.open(endpoint.protocol());
 
@@ -152,17 +495,58 @@ public:
         acceptor_.set_option(net::socket_base::reuse_address(true));
         // Привязываем acceptor к адресу и порту endpoint
         acceptor_.bind(endpoint);
+        ConfigureAcceptor(acceptor_, options_);
         // Переводим acceptor в состояние, в котором он способен принимать новые соединения
         // Благодаря этому новые подключения будут помещаться в очередь ожидающих соединений
-        acceptor_.listen(net::socket_base::max_listen_connections);
+        acceptor_.listen(options_.backlog);
     }
 
-void Run() {
-        DoAccept();
+    void Run() {
+        // Несколько ожидающих accept разбирают очередь после волны переподключений быстрее одного:
+        // каждый завершившийся accept сразу ставит следующий
+        for (unsigned i = 0; i < std::max(options_.concurrent_accepts, 1u); ++i) {
+            DoAccept();
+        }
+        listen_overflows_ = ReadListenOverflows();
+        SampleQueue();
+    }
+
+    // Адрес слушающего сокета, в том числе порт, выбранный ОС для порта 0
+    tcp::endpoint GetLocalEndpoint() const {
+        return acceptor_.local_endpoint();
     }
 
 private:
+    // Раз в секунду: длина очереди и прирост переполнений очереди на машине
+    void SampleQueue() {
+        if (auto length = GetAcceptQueueLength(acceptor_); length.has_value()) {
+            ListenerMetrics::Get().accept_queue.Set(static_cast<int64_t>(*length));
+        }
+        if (auto overflows = ReadListenOverflows(); overflows.has_value()) {
+            if (listen_overflows_.has_value() && *overflows > *listen_overflows_) {
+                ListenerMetrics::Get().listen_overflows.Inc(*overflows - *listen_overflows_);
+            }
+            listen_overflows_ = overflows;
+        }
+
+        sample_timer_.expires_after(std::chrono::seconds{1});
+        sample_timer_.async_wait([self = this->shared_from_this()](sys::error_code ec) {
+            if (!ec) {
+                self->SampleQueue();
+            }
+        });
+    }
+
     void AsyncRunSession(tcp::socket&& socket) {
+        if (options_.session_model == SessionModel::COROUTINES) {
+            // Исключение обработчика, как и в Session, выходит из io_context::run
+            auto executor = socket.get_executor();
+            return net::co_spawn(executor, RunCoroSession(std::move(socket), request_handler_), [](std::exception_ptr e) {
+                if (e) {
+                    std::rethrow_exception(e);
+                }
+            });
+        }
         std::make_shared<Session<RequestHandler>>(std::move(socket), request_handler_)->Run();
     }
 
@@ -187,8 +571,23 @@ private:
         using namespace std::literals;
 
         if (ec) {
-            return ReportError(ec, "accept"sv);
+            if (ec == net::error::operation_aborted) {
+                return;
+            }
+            // Например, кончились дескрипторы: accept повторяется чуть позже, а не прекращается навсегда
+            ReportError(ec, "accept"sv);
+            ListenerMetrics::Get().accept_errors.Inc();
+            auto retry = std::make_shared<net::steady_timer>(acceptor_.get_executor(), std::chrono::milliseconds{10});
+            return retry->async_wait([self = this->shared_from_this(), retry](sys::error_code) {
+                self->DoAccept();
+            });
+        }
+
+        ListenerMetrics::Get().accepted.Inc();
+        if (auto wait = GetAcceptWait(socket); wait.has_value()) {
+            ListenerMetrics::Get().accept_wait.Observe(*wait);
         }
+        ConfigureSocket(socket, options_);
 
         // Асинхронно обрабатываем сессию
         AsyncRunSession(std::move(socket));
@@ -199,16 +598,19 @@ private:
 
     net::io_context& ioc_;
     tcp::acceptor acceptor_;
+    net::steady_timer sample_timer_;
     RequestHandler request_handler_;
+    ListenerOptions options_;
+    std::optional<uint64_t> listen_overflows_;
 };
 
 template <typename RequestHandler>
-void ServeHttp(net::io_context& ioc, const tcp::endpoint& endpoint, RequestHandler&& handler) {
+void ServeHttp(net::io_context& ioc, const tcp::endpoint& endpoint, RequestHandler&& handler, ListenerOptions options = {}) {
     // При помощи decay_t исключим ссылки из типа RequestHandler,
     // чтобы Listener хранил RequestHandler по значению
     using MyListener = Listener<std::decay_t<RequestHandler>>;
 
-    std::make_shared<MyListener>(ioc, endpoint, std::forward<RequestHandler>(handler))->Run();
+    std::make_shared<MyListener>(ioc, endpoint, std::forward<RequestHandler>(handler), std::move(options))->Run();
 }
 
 }  // namespace http_server
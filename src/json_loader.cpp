@@ -1,12 +1,20 @@
 #include "json_loader.h"
 
+#include <algorithm>
+#include <optional>
+
+#include "binary_io.h"
+#include "map_bundle.h"
+#include "parallel.h"
+
 namespace json_loader {
 namespace json = boost::json;
 
-std::vector<model::Road> ParseRoads(json::array data) {
-    std::vector<model::Road> parsed_data;
+model::Map::Roads ParseRoads(const json::array& data) {
+    model::Map::Roads parsed_data{memory::GetResource(memory::Subsystem::MAPS)};
+    parsed_data.reserve(data.size());
 
-    for (auto node : data) {
+    for (const auto& node : data) {
         int x0 = node.at("x0").as_int64();
         int y0 = node.at("y0").as_int64();
 
@@ -22,10 +30,11 @@ std::vector<model::Road> ParseRoads(json::array data) {
     return parsed_data;
 }
 
-std::vector<model::Building> ParseBuildings(json::array data) {
+std::vector<model::Building> ParseBuildings(const json::array& data) {
     std::vector<model::Building> parsed_data;
+    parsed_data.reserve(data.size());
 
-    for (auto node : data) {
+    for (const auto& node : data) {
         int x = node.at("x").as_int64();
         int y = node.at("y").as_int64();
         int w = node.at("w").as_int64();
@@ -36,10 +45,11 @@ std::vector<model::Building> ParseBuildings(json::array data) {
     return parsed_data;
 }
 
-std::vector<model::Office> ParseOffices(json::array data) {
+std::vector<model::Office> ParseOffices(const json::array& data) {
     std::vector<model::Office> parsed_data;
+    parsed_data.reserve(data.size());
 
-    for (auto node : data) {
+    for (const auto& node : data) {
         model::Office::Id id( node.at("id").as_string().c_str() );
         int x = node.at("x").as_int64();
         int y = node.at("y").as_int64();
@@ -51,27 +61,126 @@ std::vector<model::Office> ParseOffices(json::array data) {
     return parsed_data;
 }
 
-model::Game LoadGame(const std::filesystem::path& json_path) {
+// Загрузить содержимое файла json_path и распарсить его. Если файл не открылся - nullopt
+std::optional<json::value> ReadConfig(const std::filesystem::path& json_path) {
     using namespace std::literals;
 
-    model::Game game;
-    std::ifstream file;
-
-    // Загрузить содержимое файла json_path, например, в виде строки
-    std::string json_data = "";
-    std::string buffer;
-    file.open(json_path);
-    if (!file.is_open()) {
+    // Файл читается одним вызовом, без построчной склейки
+    auto json_data = binary_io::ReadFile(json_path);
+    if (!json_data.has_value()) {
         boost::json::value custom_data{{"filename"s, json_path.string()}, {"address"s, "0.0.0.0"s}};
         logger::LogJSON(custom_data, "Error opening file"sv);
-        return game;
+        return std::nullopt;
+    }
+
+    return json::parse(*json_data);
+}
+
+http_handler::TokenBucketConfig ParseTokenBucket(const json::value& node) {
+    http_handler::TokenBucketConfig bucket;
+
+    bucket.rate = node.at("rate").to_number<double>();
+    // если burst не задан, корзина вмещает одну секунду трафика
+    if (auto burst = node.as_object().if_contains("burst"); burst != nullptr) {
+        bucket.burst = burst->to_number<double>();
+    } else {
+        bucket.burst = bucket.rate;
+    }
+    bucket.burst = std::max(bucket.burst, 1.0);
+    return bucket;
+}
+
+model::Map ParseMap(const json::value& map, double defaultDogSpeed, size_t defaultMaxPlayers, double defaultInterestRadius) {
+    // пытаемся забрать dogSpeed
+    double dogSpeed = defaultDogSpeed;
+    try {
+        dogSpeed = double(map.at("dogSpeed").as_double());
+    } catch(...) { }
+
+    // игроков в одном экземпляре карты, при переполнении создаётся новый экземпляр
+    size_t maxPlayers = defaultMaxPlayers;
+    if (auto value = map.as_object().if_contains("maxPlayers"); value != nullptr) {
+        maxPlayers = static_cast<size_t>(std::max<int64_t>(value->as_int64(), 0));
+    }
+
+    // радиус видимости других псов в /api/v1/game/state
+    double interestRadius = defaultInterestRadius;
+    if (auto value = map.as_object().if_contains("interestRadius"); value != nullptr) {
+        interestRadius = value->to_number<double>();
+    }
+
+    // Создать карту
+    model::Map::Id id( map.at("id").as_string().c_str() );
+    std::string name( map.at("name").as_string().c_str() );
+    model::Map new_map(id, name);
+
+    // Добавить дороги: сетка строится сразу для всех
+    auto roads = ParseRoads(map.at("roads").as_array());
+    model::RoadGrid grid;
+    for (const auto& road : roads) {
+        grid.AddRoad(road);
+    }
+    new_map.SetRoads(std::move(roads), std::move(grid));
+
+    // Добавить здания
+    for (const auto& build : ParseBuildings(map.at("buildings").as_array())) {
+        new_map.AddBuilding(build);
+    }
+
+    // Добавить офисы
+    for (auto& office : ParseOffices(map.at("offices").as_array())) {
+        new_map.AddOffice(std::move(office));
+    }
+
+    // Добавить скорость
+    new_map.SetDogSpeed(dogSpeed);
+    new_map.SetMaxPlayers(maxPlayers);
+    new_map.SetInterestRadius(interestRadius);
+    return new_map;
+}
+
+http_handler::RateLimitConfig ParseRateLimits(const json::object& limits_data) {
+    http_handler::RateLimitConfig rate_limits;
+
+    if (auto per_token = limits_data.if_contains("perToken"); per_token != nullptr) {
+        rate_limits.per_token = ParseTokenBucket(*per_token);
     }
+    if (auto per_address = limits_data.if_contains("perAddress"); per_address != nullptr) {
+        rate_limits.per_address = ParseTokenBucket(*per_address);
+    }
+    if (auto per_endpoint = limits_data.if_contains("perEndpoint"); per_endpoint != nullptr) {
+        for (const auto& node : per_endpoint->as_array()) {
+            rate_limits.per_endpoint.push_back({node.at("prefix").as_string().c_str(), ParseTokenBucket(node)});
+        }
+    }
+    return rate_limits;
+}
 
-    while (std::getline(file, buffer)) {
-        json_data += buffer;
+Config LoadConfig(const std::filesystem::path& json_path) {
+    using namespace std::literals;
+    constexpr std::chrono::milliseconds DEFAULT_RETIREMENT_TIME{60'000};
+
+    Config loaded;
+    model::Game& game = loaded.game;
+    game.SetRetirementTime(DEFAULT_RETIREMENT_TIME);
+
+    auto config = ReadConfig(json_path);
+    if (!config.has_value()) {
+        return loaded;
+    }
+    const auto& parsed_data = *config;
+
+    // dogRetirementTime читается тем же разбором, что и карты, и применяется при их перезагрузке
+    if (auto value = parsed_data.as_object().if_contains("dogRetirementTime"); value != nullptr) {
+        const double seconds = std::max(value->to_number<double>(), 0.0);
+        game.SetRetirementTime(std::chrono::milliseconds{static_cast<int64_t>(seconds * 1000)});
     }
 
-    auto parsed_data = json::parse(json_data);
+    // rateLimits разбирается там же, но при перезагрузке карт не применяется:
+    // ограничитель частоты создаётся один раз при запуске
+    if (auto limits = parsed_data.as_object().if_contains("rateLimits"); limits != nullptr) {
+        loaded.rate_limits = ParseRateLimits(limits->as_object());
+    }
 
     // пытаемся забрать defaultDogSpeed
     double defaultDogSpeed;
@@ -81,46 +190,53 @@ model::Game LoadGame(const std::filesystem::path& json_path) {
         defaultDogSpeed = 1.0;
     }
 
-    // Распарсить строку как JSON, используя boost::json::parse
-    auto maps_data = parsed_data.at("maps").as_array();
+    // defaultMaxPlayers необязателен, без него экземпляр карты один
+    size_t defaultMaxPlayers = 0;
+    if (auto value = parsed_data.as_object().if_contains("defaultMaxPlayers"); value != nullptr) {
+        defaultMaxPlayers = static_cast<size_t>(std::max<int64_t>(value->as_int64(), 0));
+    }
 
-    for (auto map : maps_data) {
-        // пытаемся забрать dogSpeed
-        double dogSpeed = defaultDogSpeed;
-        try {
-            dogSpeed = double(map.at("dogSpeed").as_double());
-        } catch(...) { }
+    // defaultInterestRadius необязателен, без него игрок видит всех псов сессии
+    double defaultInterestRadius = 0.0;
+    if (auto value = parsed_data.as_object().if_contains("defaultInterestRadius"); value != nullptr) {
+        defaultInterestRadius = value->to_number<double>();
+    }
 
-        // Создать карту
-        model::Map::Id id( map.at("id").as_string().c_str() );
-        std::string name( map.at("name").as_string().c_str() );
-        model::Map new_map(id, name);
+    // Карты независимы друг от друга, поэтому собираются параллельно, а добавляются в игру по порядку
+    const auto& maps_data = parsed_data.at("maps").as_array();
+    std::vector<std::optional<model::Map>> maps(maps_data.size());
+    util::ParallelFor(maps_data.size(), [&](size_t i) {
+        maps[i].emplace(ParseMap(maps_data[i], defaultDogSpeed, defaultMaxPlayers, defaultInterestRadius));
+    });
 
-        // Добавить дороги
-        auto roads = std::move(ParseRoads(map.at("roads").as_array()));
-        for (const auto& road : roads) {
-            new_map.AddRoad(road);
-        }
+    for (auto& map : maps) {
+        game.AddMap(std::move(*map));
+    }
+    return loaded;
+}
 
-        // Добавить здания
-        auto buildings = std::move(ParseBuildings(map.at("buildings").as_array()));
-        for (const auto& build : buildings) {
-            new_map.AddBuilding(build);
-        }
+Config LoadConfig(const std::filesystem::path& json_path, const std::filesystem::path& bundle_path) {
+    using namespace std::literals;
 
-        // Добавить офисы
-        auto offices = std::move( ParseOffices(map.at("offices").as_array()));
-        for (const auto& office : offices) {
-            new_map.AddOffice(office);
+    try {
+        if (auto loaded = map_bundle::Load(bundle_path, json_path); loaded.has_value()) {
+            return std::move(*loaded);
         }
-
-        // Добавить скорость
-        new_map.SetDogSpeed(dogSpeed);
-
-        game.AddMap(std::move(new_map));
+        boost::json::value custom_data{{"filename"s, bundle_path.string()}};
+        logger::LogJSON(custom_data, "map bundle is missing or stale, loading config"sv);
+    } catch (const std::exception& ex) {
+        boost::json::value custom_data{{"filename"s, bundle_path.string()}, {"exception"s, ex.what()}};
+        logger::LogJSON(custom_data, "map bundle is broken, loading config"sv);
     }
+    return LoadConfig(json_path);
+}
+
+model::Game LoadGame(const std::filesystem::path& json_path) {
+    return std::move(LoadConfig(json_path).game);
+}
 
-    return game;
+model::Game LoadGame(const std::filesystem::path& json_path, const std::filesystem::path& bundle_path) {
+    return std::move(LoadConfig(json_path, bundle_path).game);
 }
 
 }  // namespace json_loader
@@ -6,15 +6,32 @@
 #pragma once
 
 #include <boost/json.hpp>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 
 #include "model.h"
+#include "rate_limiter.h"
 
 namespace json_loader {
 
+	// Всё, что сервер берёт из config.json, читается одним разбором
+	struct Config {
+		model::Game game;
+		// Секция rateLimits необязательна, без неё ограничения выключены
+		http_handler::RateLimitConfig rate_limits;
+	};
+
+	// Карты, dogRetirementTime (секунды простоя до ухода игрока, по умолчанию 60; 0 - игроки не уходят) и rateLimits
+	Config LoadConfig(const std::filesystem::path& json_path);
+	// Из бинарного бандла (см. game_map_compiler). Если бандла нет, он устарел
+	// или повреждён - из json_path
+	Config LoadConfig(const std::filesystem::path& json_path, const std::filesystem::path& bundle_path);
+
+	// Только модель игры из LoadConfig
 	model::Game LoadGame(const std::filesystem::path& json_path);
+	model::Game LoadGame(const std::filesystem::path& json_path, const std::filesystem::path& bundle_path);
 
 }  // namespace json_loader
 
@@ -0,0 +1,222 @@
+#include "log_backend.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <sstream>
+#include <stdexcept>
+
+namespace logger {
+
+using namespace std::literals;
+
+// ------------------------------ ThreadBuffer ------------------------------
+AsyncLogBackend::ThreadBuffer::ThreadBuffer(size_t capacity)
+    : slots(std::bit_ceil(std::max<size_t>(capacity, 2)))
+    , mask{slots.size() - 1} {
+}
+
+AsyncLogBackend::ThreadBufferHolder::~ThreadBufferHolder() {
+    if (buffer) {
+        // Оставшиеся записи ещё выведет фоновый поток, после чего удалит буфер
+        buffer->orphaned.store(true, std::memory_order_release);
+    }
+}
+
+// ------------------------------ AsyncLogBackend ------------------------------
+AsyncLogBackend::~AsyncLogBackend() {
+    Stop();
+}
+
+void AsyncLogBackend::Start(const AsyncLogOptions& options) {
+    if (IsRunning()) {
+        return;
+    }
+
+    options_ = options;
+    options_.sample_rate = std::max<size_t>(options_.sample_rate, 1);
+    stopping_.store(false, std::memory_order_release);
+    running_.store(true, std::memory_order_release);
+    writer_ = std::thread([this] {
+        Run();
+    });
+}
+
+void AsyncLogBackend::Stop() {
+    if (!IsRunning()) {
+        return;
+    }
+
+    // Новые записи пойдут через синхронный Boost.Log
+    running_.store(false, std::memory_order_seq_cst);
+
+    // Потоки, увидевшие running_ до остановки, дописывают свои записи, пока фоновый поток ещё работает.
+    // После этого в буферы никто не пишет, и последний проход фонового потока выводит всё
+    while (producers_.load(std::memory_order_seq_cst) != 0) {
+        std::this_thread::yield();
+    }
+
+    {
+        std::lock_guard lock{wake_mutex_};
+        stopping_.store(true, std::memory_order_release);
+    }
+    wake_.notify_one();
+    writer_.join();
+}
+
+AsyncLogBackend::ThreadBuffer& AsyncLogBackend::GetThreadBuffer() {
+    thread_local ThreadBufferHolder holder;
+
+    if (!holder.buffer) {
+        holder.buffer = std::make_shared<ThreadBuffer>(options_.buffer_size);
+
+        std::lock_guard lock{registry_mutex_};
+        buffers_.push_back(holder.buffer);
+    }
+    return *holder.buffer;
+}
+
+bool AsyncLogBackend::TryPush(ThreadBuffer& buffer, std::string& line) {
+    const size_t tail = buffer.tail.load(std::memory_order_relaxed);
+    const size_t used = tail - buffer.head.load(std::memory_order_acquire);
+    const size_t capacity = buffer.slots.size();
+
+    if (options_.overflow == OverflowPolicy::SAMPLE && used >= capacity / 4 * 3) {
+        if (++buffer.sample_counter % options_.sample_rate != 0) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    if (used == capacity) {
+        return false;
+    }
+
+    buffer.slots[tail & buffer.mask] = std::move(line);
+    buffer.tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+bool AsyncLogBackend::Push(std::string line) {
+    // Stop ждёт, пока счётчик не обнулится: запись либо попадёт в буфер до последнего
+    // прохода фонового потока, либо вызывающий увидит остановку и выведет её сам
+    producers_.fetch_add(1, std::memory_order_seq_cst);
+    if (!running_.load(std::memory_order_seq_cst)) {
+        producers_.fetch_sub(1, std::memory_order_release);
+        return false;
+    }
+
+    ThreadBuffer& buffer = GetThreadBuffer();
+
+    bool blocked = false;
+    while (!TryPush(buffer, line)) {
+        if (options_.overflow != OverflowPolicy::BLOCK) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+        if (!blocked) {
+            blocked = true;
+            blocked_.fetch_add(1, std::memory_order_relaxed);
+        }
+        wake_.notify_one();
+        std::this_thread::yield();
+    }
+
+    producers_.fetch_sub(1, std::memory_order_release);
+    return true;
+}
+
+void AsyncLogBackend::Run() {
+    std::string batch;
+
+    while (true) {
+        {
+            std::unique_lock lock{wake_mutex_};
+            wake_.wait_for(lock, options_.flush_period, [this] {
+                return stopping_.load(std::memory_order_acquire);
+            });
+        }
+        const bool stopping = stopping_.load(std::memory_order_acquire);
+
+        while (Drain(batch) > 0) {
+            WriteBatch(batch);
+            batch.clear();
+        }
+
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+size_t AsyncLogBackend::Drain(std::string& batch) {
+    // Не копим в памяти больше этого объёма за один вызов write
+    constexpr size_t MAX_BATCH_BYTES = 1 << 20;
+    size_t records = 0;
+
+    std::lock_guard lock{registry_mutex_};
+    for (auto& buffer : buffers_) {
+        const size_t tail = buffer->tail.load(std::memory_order_acquire);
+        size_t head = buffer->head.load(std::memory_order_relaxed);
+
+        for (; head != tail && batch.size() < MAX_BATCH_BYTES; ++head) {
+            std::string& slot = buffer->slots[head & buffer->mask];
+            batch += slot;
+            batch += '\n';
+            std::string{}.swap(slot);
+            ++records;
+        }
+        buffer->head.store(head, std::memory_order_release);
+    }
+
+    // Буферы завершившихся потоков удаляем, когда в них ничего не осталось
+    std::erase_if(buffers_, [](const auto& buffer) {
+        return buffer->orphaned.load(std::memory_order_acquire) && buffer->Size() == 0;
+    });
+
+    written_.fetch_add(records, std::memory_order_relaxed);
+    return records;
+}
+
+void AsyncLogBackend::WriteBatch(const std::string& batch) {
+    size_t offset = 0;
+    while (offset < batch.size()) {
+        ssize_t written = ::write(options_.fd, batch.data() + offset, batch.size() - offset);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        offset += static_cast<size_t>(written);
+    }
+    batches_.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::string AsyncLogBackend::PrintStats() const {
+    std::ostringstream oss;
+
+    oss << "{\"mode\":\"" << (IsRunning() ? "async" : "sync") << "\""
+        << ",\"written\":" << written_.load(std::memory_order_relaxed)
+        << ",\"dropped\":" << dropped_.load(std::memory_order_relaxed)
+        << ",\"blocked\":" << blocked_.load(std::memory_order_relaxed)
+        << ",\"batches\":" << batches_.load(std::memory_order_relaxed) << "}";
+    return oss.str();
+}
+
+OverflowPolicy ParseOverflowPolicy(std::string_view name) {
+    if (name == "block"sv) {
+        return OverflowPolicy::BLOCK;
+    }
+    if (name == "drop"sv) {
+        return OverflowPolicy::DROP;
+    }
+    if (name == "sample"sv) {
+        return OverflowPolicy::SAMPLE;
+    }
+    throw std::invalid_argument("Unknown log overflow policy: "s + std::string(name));
+}
+
+} // namespace logger
@@ -0,0 +1,117 @@
+#ifndef __LOG_BACKEND__
+#define __LOG_BACKEND__
+
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace logger {
+
+// Что делать, если буфер потока переполнен
+enum class OverflowPolicy {
+    BLOCK,  // ждать, пока фоновый поток освободит место
+    DROP,   // отбросить запись
+    SAMPLE  // при заполнении буфера на 3/4 пропускать только каждую N-ю запись, при полном - отбрасывать
+};
+
+struct AsyncLogOptions {
+    size_t buffer_size = 8192;  // записей на поток
+    OverflowPolicy overflow = OverflowPolicy::BLOCK;
+    size_t sample_rate = 10;
+    std::chrono::milliseconds flush_period{5};
+    int fd = 1;  // stdout
+};
+
+// Асинхронный вывод логов: каждый поток пишет готовые JSON-строки в свой кольцевой буфер
+// без блокировок, фоновый поток собирает их пачкой и выводит одним системным вызовом write
+class AsyncLogBackend {
+public:
+    static AsyncLogBackend& Instance() {
+        static AsyncLogBackend backend;
+        return backend;
+    }
+
+    AsyncLogBackend(const AsyncLogBackend&) = delete;
+    AsyncLogBackend& operator=(const AsyncLogBackend&) = delete;
+    ~AsyncLogBackend();
+
+    void Start(const AsyncLogOptions& options);
+    // Останавливает фоновый поток, предварительно выведя всё накопленное
+    void Stop();
+
+    bool IsRunning() const {
+        return running_.load(std::memory_order_acquire);
+    }
+
+    // line - готовая строка лога без завершающего перевода строки.
+    // false, если вывод уже остановлен: запись не принята, и её нужно вывести синхронно
+    bool Push(std::string line);
+
+    // Счётчики в виде JSON для /admin/logging
+    std::string PrintStats() const;
+
+private:
+    AsyncLogBackend() = default;
+
+    // Кольцевой буфер одного потока: один писатель (поток-владелец), один читатель (фоновый поток)
+    struct ThreadBuffer {
+        explicit ThreadBuffer(size_t capacity);
+
+        size_t Size() const {
+            return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+        }
+
+        std::vector<std::string> slots;
+        size_t mask;
+        std::atomic<size_t> head{0};
+        std::atomic<size_t> tail{0};
+        std::atomic<bool> orphaned{false};
+        size_t sample_counter = 0;
+    };
+
+    // Удерживает буфер потока и помечает его брошенным, когда поток завершается
+    struct ThreadBufferHolder {
+        std::shared_ptr<ThreadBuffer> buffer;
+        ~ThreadBufferHolder();
+    };
+
+    ThreadBuffer& GetThreadBuffer();
+    bool TryPush(ThreadBuffer& buffer, std::string& line);
+    void Run();
+    size_t Drain(std::string& batch);
+    void WriteBatch(const std::string& batch);
+
+    AsyncLogOptions options_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> stopping_{false};
+    // Потоки внутри Push
+    std::atomic<size_t> producers_{0};
+    std::thread writer_;
+
+    std::mutex registry_mutex_;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+
+    std::atomic<uint64_t> written_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> batches_{0};
+    std::atomic<uint64_t> blocked_{0};
+};
+
+// Разбор значений опций командной строки
+OverflowPolicy ParseOverflowPolicy(std::string_view name);
+
+} // namespace logger
+
+#endif
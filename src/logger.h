@@ -17,6 +17,8 @@
 #include <string_view>
 #include <iostream>
 
+#include "log_backend.h"
+
 namespace logger {
     using namespace std::literals;
     using namespace boost::posix_time;
@@ -33,7 +35,24 @@ namespace logger {
     BOOST_LOG_ATTRIBUTE_KEYWORD(additional_data, "AdditionalData", boost::json::value)
     BOOST_LOG_ATTRIBUTE_KEYWORD(timestamp, "TimeStamp", boost::posix_time::ptime)
 
+    // Строка в том же формате, что и у MyFormatter
+    inline std::string FormatJSONLine(const boost::json::value& custom_data, std::string_view messege) {
+        std::string line = "{\"timestamp\":\""s;
+        line += boost::posix_time::to_iso_extended_string(boost::posix_time::microsec_clock::local_time());
+        line += "\",\"data\":"sv;
+        line += boost::json::serialize(custom_data);
+        line += ",\"message\":\""sv;
+        line += messege;
+        line += "\"}"sv;
+        return line;
+    }
+
     inline void LogJSON(boost::json::value custom_data, std::string_view messege) {
+        // Push откажет, если вывод остановили после проверки IsRunning
+        if (auto& backend = AsyncLogBackend::Instance(); backend.IsRunning()
+            && backend.Push(FormatJSONLine(custom_data, messege))) {
+            return;
+        }
         BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data, custom_data) << messege;
     }
 
@@ -50,6 +69,16 @@ namespace logger {
                                     logging::keywords::auto_flush = true);
         boost::log::add_common_attributes();
     }
+
+    // Переключает LogJSON на асинхронный вывод пачками. Boost.Log остаётся для записей после остановки
+    inline void InitAsyncLogging(const AsyncLogOptions& options) {
+        std::cout.flush();
+        AsyncLogBackend::Instance().Start(options);
+    }
+
+    inline void StopAsyncLogging() {
+        AsyncLogBackend::Instance().Stop();
+    }
 }//logger
 
 #endif
\ No newline at end of file
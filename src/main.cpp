@@ -11,6 +11,7 @@
 #include <thread>
 #include <format>
 #include <chrono>
+#include <cstdlib>
 #include <functional>
 #include <fstream>
 #include <optional>
@@ -20,6 +21,11 @@
 #include "request_handler.h"
 #include "logger.h"
 #include "ticker.h"
+#include "tracing.h"
+#include "snapshot.h"
+#include "wal.h"
+#include "map_reloader.h"
+#include "cpu_topology.h"
 
 using namespace std::literals;
 using namespace std::chrono;
@@ -34,8 +40,33 @@ using Milliseconds = std::chrono::milliseconds;
 struct Args {
     int tick = 0; // uninitialize
     std::string config;
+    std::string map_bundle;
     std::string static_root;
     bool randomize_spawn = false;
+    std::string log_mode = "sync";
+    std::string log_overflow = "block";
+    size_t log_buffer = 8192;
+    size_t log_sample = 10;
+    size_t trace_buffer = 0;
+    std::string record_file;
+    std::string admin_token;
+    std::string state_file;
+    int save_state_period = 0;
+    std::string wal_dir;
+    std::string wal_durability = "group";
+    int wal_flush_period = 20;
+    int port = 8080;
+    int shard_index = -1;
+    std::string maps;
+    unsigned io_threads = 0;
+    std::string io_cpus;
+    unsigned simulation_threads = 0;
+    std::string simulation_cpus;
+    unsigned file_io_threads = 0;
+    std::string file_io_cpus;
+    std::string static_io = "pool";
+    std::string sessions = "callbacks";
+    http_server::ListenerOptions listener{.concurrent_accepts = 4};
 };
 
 [[nodiscard]] std::optional<Args> ParseCommandLine(int argc, const char* const argv[]) {
@@ -49,8 +80,43 @@ struct Args {
         ("help,h", "Show help")
         ("tick-period,t", po::value<int>(&args.tick)->value_name("milliseconds"s), "set tick period")
         ("config-file,c", po::value(&args.config)->value_name("file"s), "set config file path")
+        ("map-bundle", po::value(&args.map_bundle)->value_name("file"s), "load maps from a bundle built by game_map_compiler")
         ("www-root,w", po::value(&args.static_root)->value_name("dir"s), "set static files root")
-        ("randomize-spawn-points", "spawn dogs at random positions");
+        ("randomize-spawn-points", "spawn dogs at random positions")
+        ("log-mode", po::value(&args.log_mode)->value_name("sync|async"s), "write logs synchronously or from a background thread")
+        ("log-overflow", po::value(&args.log_overflow)->value_name("block|drop|sample"s), "what async logging does when a thread buffer is full")
+        ("log-buffer", po::value(&args.log_buffer)->value_name("records"s), "async log buffer size per thread")
+        ("log-sample", po::value(&args.log_sample)->value_name("N"s), "keep every N-th record when the buffer is nearly full (sample policy)")
+        ("trace-buffer", po::value(&args.trace_buffer)->value_name("spans"s), "enable request and tick tracing, keeping the last N spans per thread")
+        ("record-file", po::value(&args.record_file)->value_name("file"s), "record API requests for game_replay")
+        ("admin-token", po::value(&args.admin_token)->value_name("token"s),
+            "require 'Authorization: Bearer <token>' for /admin/* (GAME_SERVER_ADMIN_TOKEN; without it /admin/* is loopback-only)")
+        ("state-file", po::value(&args.state_file)->value_name("file"s), "restore game state from file on start and save it there")
+        ("save-state-period", po::value(&args.save_state_period)->value_name("milliseconds"s), "save game state snapshots with this period")
+        ("wal-dir", po::value(&args.wal_dir)->value_name("dir"s), "log every game change to this directory and replay it on start")
+        ("wal-durability", po::value(&args.wal_durability)->value_name("group|async"s), "fdatasync each WAL batch or leave flushing to the OS")
+        ("wal-flush-period", po::value(&args.wal_flush_period)->value_name("milliseconds"s), "write WAL batches at least this often when there are no ticks")
+        ("port", po::value(&args.port)->value_name("port"s), "listen on this port")
+        ("tcp-nodelay", po::value(&args.listener.tcp_nodelay)->value_name("bool"s), "disable Nagle's algorithm on connections (true)")
+        ("tcp-defer-accept", po::value(&args.listener.defer_accept)->value_name("seconds"s), "accept a connection only once its first request has arrived (off)")
+        ("tcp-fastopen", po::value(&args.listener.fastopen_queue)->value_name("queue"s), "enable TCP Fast Open with this pending queue length (off)")
+        ("socket-send-buffer", po::value(&args.listener.send_buffer)->value_name("bytes"s), "SO_SNDBUF of connections (OS default)")
+        ("socket-receive-buffer", po::value(&args.listener.receive_buffer)->value_name("bytes"s), "SO_RCVBUF of connections (OS default)")
+        ("tcp-keepalive-idle", po::value(&args.listener.keepalive_idle)->value_name("seconds"s), "send keepalive probes after this idle time (off)")
+        ("tcp-keepalive-interval", po::value(&args.listener.keepalive_interval)->value_name("seconds"s), "interval between keepalive probes (OS default)")
+        ("tcp-keepalive-count", po::value(&args.listener.keepalive_count)->value_name("N"s), "unanswered keepalive probes before the connection is dropped (OS default)")
+        ("accept-concurrency", po::value(&args.listener.concurrent_accepts)->value_name("N"s), "outstanding accepts on the listening socket (4)")
+        ("listen-backlog", po::value(&args.listener.backlog)->value_name("N"s), "listen queue length, capped by net.core.somaxconn (system maximum)")
+        ("sessions", po::value(&args.sessions)->value_name("callbacks|coroutines"s), "serve connections with callback chains or one coroutine per connection (callbacks)")
+        ("shard-index", po::value(&args.shard_index)->value_name("0-255"s), "run as a shard behind game_router: tag player tokens with this index")
+        ("io-threads", po::value(&args.io_threads)->value_name("N"s), "serve connections and the game strand on N threads (available cores)")
+        ("io-cpus", po::value(&args.io_cpus)->value_name("list"s), "pin I/O threads to these cores, e.g. 0-3,8")
+        ("simulation-threads", po::value(&args.simulation_threads)->value_name("N"s), "update map instances on N threads each tick (available cores)")
+        ("simulation-cpus", po::value(&args.simulation_cpus)->value_name("list"s), "pin simulation threads to these cores")
+        ("file-io-threads", po::value(&args.file_io_threads)->value_name("N"s), "read static files on N threads (a quarter of available cores, 1-4)")
+        ("file-io-cpus", po::value(&args.file_io_cpus)->value_name("list"s), "pin static file threads to these cores")
+        ("static-io", po::value(&args.static_io)->value_name("pool|uring"s), "read static files on file I/O threads or through io_uring (io_uring builds only)")
+        ("maps", po::value(&args.maps)->value_name("id1,id2"s), "serve only these maps from the config");
 
     // variables_map хранит значения опций после разбора
     po::variables_map vm;
@@ -75,6 +141,37 @@ struct Args {
     if (vm.contains("randomize-spawn-points")) {
         args.randomize_spawn = true;
     }
+    if (!vm.contains("admin-token"s)) {
+        // Из окружения токен не виден в списке процессов
+        if (const char* token = std::getenv("GAME_SERVER_ADMIN_TOKEN")) {
+            args.admin_token = token;
+        }
+    }
+    if (args.log_mode != "sync"s && args.log_mode != "async"s) {
+        throw std::runtime_error("log-mode must be sync or async"s);
+    }
+    if (args.static_io != "pool"s && args.static_io != "uring"s) {
+        throw std::runtime_error("static-io must be pool or uring"s);
+    }
+#ifndef BOOST_ASIO_HAS_FILE
+    if (args.static_io == "uring"s) {
+        throw std::runtime_error("static-io uring needs a build with -DGAME_SERVER_IO_URING=ON"s);
+    }
+#endif
+    if (args.port <= 0 || args.port > 65535) {
+        throw std::runtime_error("port must be in 1-65535"s);
+    }
+    if (args.sessions == "coroutines"s) {
+        args.listener.session_model = http_server::SessionModel::COROUTINES;
+    } else if (args.sessions != "callbacks"s) {
+        throw std::runtime_error("sessions must be callbacks or coroutines"s);
+    }
+    if (args.listener.concurrent_accepts == 0) {
+        throw std::runtime_error("accept-concurrency must be positive"s);
+    }
+    if (vm.contains("shard-index"s) && (args.shard_index < 0 || args.shard_index >= static_cast<int>(model::MAX_SHARDS))) {
+        throw std::runtime_error("shard-index must be in 0-255"s);
+    }
 
     // С опциями программы всё в порядке, возвращаем структуру args
     return args;
@@ -82,19 +179,90 @@ struct Args {
 
 namespace {
 
-// Запускает функцию fn на n потоках, включая текущий
+// Механизм ожидания событий Asio, выбранный при сборке
+constexpr std::string_view IO_BACKEND =
+#if defined(BOOST_ASIO_HAS_IO_URING) && defined(BOOST_ASIO_DISABLE_EPOLL)
+    "io_uring"sv;
+#else
+    "epoll"sv;
+#endif
+
+// Разбивает список через запятую, пустые элементы пропускаются
+std::vector<std::string> SplitList(std::string_view list) {
+    std::vector<std::string> items;
+    while (!list.empty()) {
+        const size_t comma = std::min(list.find(','), list.size());
+        if (comma > 0) {
+            items.emplace_back(list.substr(0, comma));
+        }
+        list.remove_prefix(std::min(comma + 1, list.size()));
+    }
+    return items;
+}
+
+// Запускает функцию fn(index) на n потоках, включая текущий (index 0)
 template <typename Fn>
 void RunWorkers(unsigned n, const Fn& fn) {
     n = std::max(1u, n);
     std::vector<std::jthread> workers;
     workers.reserve(n - 1);
     // Запускаем n-1 рабочих потоков, выполняющих функцию fn
-    while (--n) {
-        workers.emplace_back(fn);
+    for (unsigned index = 1; index < n; ++index) {
+        workers.emplace_back(fn, index);
     }
-    fn();
+    fn(0u);
+}
+
+// Роли потоков: число потоков из опций, а незаданные - по числу ядер, доступных контейнеру
+cpu_topology::ThreadTopology MakeThreadTopology(const Args& args) {
+    cpu_topology::ThreadTopology topology;
+    topology.io = {args.io_threads, cpu_topology::ParseCpuList(args.io_cpus)};
+    topology.simulation = {args.simulation_threads, cpu_topology::ParseCpuList(args.simulation_cpus)};
+    topology.file_io = {args.file_io_threads, cpu_topology::ParseCpuList(args.file_io_cpus)};
+    topology.ApplyDefaults(cpu_topology::GetAvailableCpus());
+    return topology;
 }
 
+void PinThread(const cpu_topology::ThreadRole& role, unsigned index, std::string_view role_name) {
+    if (!role.Pin(index)) {
+        boost::json::value custom_data{{"role"s, role_name}, {"index"s, index}};
+        logger::LogJSON(custom_data, "thread pinning failed"sv);
+    }
+}
+
+// Потоки для блокирующих операций со своим io_context, чтобы они не занимали потоки сети
+class BlockingPool {
+public:
+    explicit BlockingPool(const cpu_topology::ThreadRole& role)
+        : work_{net::make_work_guard(ioc_)} {
+        for (unsigned index = 0; index < role.threads; ++index) {
+            threads_.emplace_back([this, role, index] {
+                PinThread(role, index, "file_io"sv);
+                ioc_.run();
+            });
+        }
+    }
+
+    // Задачи, не начатые к остановке, отбрасываются
+    ~BlockingPool() {
+        work_.reset();
+        ioc_.stop();
+        threads_.clear();
+    }
+
+    BlockingPool(const BlockingPool&) = delete;
+    BlockingPool& operator=(const BlockingPool&) = delete;
+
+    net::io_context::executor_type GetExecutor() {
+        return ioc_.get_executor();
+    }
+
+private:
+    net::io_context ioc_;
+    net::executor_work_guard<net::io_context::executor_type> work_;
+    std::vector<std::jthread> threads_;
+};
+
 }  // namespace
 
 
@@ -107,15 +275,90 @@ int main(int argc, const char* argv[]) {
 
         // 0. Настраиваем логгер
         logger::InitBoostLogFilter();
+        if (args.value().log_mode == "async"s) {
+            logger::AsyncLogOptions log_options;
+            log_options.buffer_size = args.value().log_buffer;
+            log_options.overflow = logger::ParseOverflowPolicy(args.value().log_overflow);
+            log_options.sample_rate = args.value().log_sample;
+            logger::InitAsyncLogging(log_options);
+        }
+        tracing::Tracer::Instance().Enable(args.value().trace_buffer);
 
         // 1. Загружаем карту из файла и построить модель игры
-        model::Game game = json_loader::LoadGame(args.value().config);
+        const auto load_start = steady_clock::now();
+        json_loader::Config config = args.value().map_bundle.empty()
+            ? json_loader::LoadConfig(args.value().config)
+            : json_loader::LoadConfig(args.value().config, args.value().map_bundle);
+        model::Game& game = config.game;
+        {
+            boost::json::value custom_data{{"maps"s, game.GetMaps().size()},
+                {"load_time_ms"s, duration_cast<milliseconds>(steady_clock::now() - load_start).count()}};
+            logger::LogJSON(custom_data, "game loaded"sv);
+        }
         game.SetPlayerSpawn(args.value().randomize_spawn);
         game.SetTickrate(args.value().tick);
 
+        // Потоки ролей: сеть, симуляция тика и чтение файлов
+        const cpu_topology::ThreadTopology topology = MakeThreadTopology(args.value());
+        {
+            const auto cgroup_limit = cpu_topology::ReadCgroupCpuLimit();
+            boost::json::value custom_data{{"available_cpus"s, cpu_topology::GetAvailableCpus()},
+                {"cgroup_cpu_limit"s, cgroup_limit.has_value() ? boost::json::value(*cgroup_limit) : boost::json::value(nullptr)},
+                {"io_threads"s, topology.io.threads}, {"simulation_threads"s, topology.simulation.threads},
+                {"file_io_threads"s, topology.file_io.threads}, {"io_backend"s, IO_BACKEND},
+                {"static_io"s, args.value().static_io}, {"sessions"s, args.value().sessions}};
+            logger::LogJSON(custom_data, "thread topology"sv);
+        }
+        // Потоки пула нумеруются с 1: нулевой - поток strand игры, вызывающий ParallelFor, он из потоков сети.
+        // Поэтому первое ядро списка достаётся потоку 1
+        game.SetSimulationThreads(topology.simulation.threads, [role = topology.simulation](unsigned index) {
+            PinThread(role, index - 1, "simulation"sv);
+        });
+
+        // 1.0. В режиме шарда процесс обслуживает только свои карты, а токены помечаются номером шарда
+        const std::vector<std::string> map_filter = SplitList(args.value().maps);
+        if (!map_filter.empty()) {
+            game.ReplaceMaps(map_reload::SelectMaps(game.GetMaps(), map_filter));
+        }
+        if (args.value().shard_index >= 0) {
+            game.SetTokenPrefix(model::MakeShardTag(static_cast<unsigned>(args.value().shard_index)));
+        }
+
+        // 1.1. Восстанавливаем состояние игры из снимка, если он есть
+        const std::string& state_file = args.value().state_file;
+        if (!state_file.empty()) {
+            const auto start = steady_clock::now();
+            if (auto snapshot = snapshot::LoadFromFile(state_file); snapshot.has_value()) {
+                game.RestoreSnapshot(std::move(*snapshot));
+
+                boost::json::value custom_data{{"filename"s, state_file},
+                    {"restore_time_ms"s, duration_cast<milliseconds>(steady_clock::now() - start).count()}};
+                logger::LogJSON(custom_data, "game state restored"sv);
+            }
+        }
+
+        // 1.2. Доигрываем изменения из журнала, не вошедшие в снимок, и продолжаем журнал
+        std::optional<wal::WalWriter> wal_writer;
+        if (const std::string& wal_dir = args.value().wal_dir; !wal_dir.empty()) {
+            const auto start = steady_clock::now();
+            const wal::ReplayResult replayed = wal::Replay(wal_dir, game);
+
+            boost::json::value custom_data{{"dir"s, wal_dir}, {"applied"s, replayed.applied},
+                {"last_event"s, replayed.last_event}, {"truncated"s, replayed.truncated},
+                {"replay_time_ms"s, duration_cast<milliseconds>(steady_clock::now() - start).count()}};
+            logger::LogJSON(custom_data, "wal replayed"sv);
+
+            wal::WalOptions wal_options;
+            wal_options.dir = wal_dir;
+            wal_options.durability = wal::ParseDurability(args.value().wal_durability);
+            wal_options.flush_period = milliseconds(std::max(1, args.value().wal_flush_period));
+            wal_writer.emplace(std::move(wal_options), game.GetLastEvent() + 1);
+            game.SetEventListener(&*wal_writer);
+        }
+
         // 2. Инициализируем io_context
-        const unsigned num_threads = std::thread::hardware_concurrency();
-        net::io_context ioc(num_threads);
+        const unsigned num_threads = topology.io.threads;
+        net::io_context ioc(static_cast<int>(num_threads));
 
         // 3. Добавляем асинхронный обработчик сигналов SIGINT и SIGTERM
         net::signal_set signals(ioc, SIGINT, SIGTERM);
@@ -132,19 +375,50 @@ int main(int argc, const char* argv[]) {
         net::strand<net::io_context::executor_type> strand{ net::make_strand(ioc) };
         boost::asio::steady_timer t(strand, boost::asio::chrono::milliseconds(game.GetTickrate()));
 
-        http_handler::LoggingRequestHandler handler{strand, game, args.value().static_root};
+        http_handler::LoggingRequestHandler handler{strand, game, args.value().static_root,
+            std::move(config.rate_limits)};
+        handler.SetAdminToken(args.value().admin_token);
+        if (!args.value().record_file.empty()) {
+            handler.SetRecorder(std::make_shared<recording::TrafficRecorder>(args.value().record_file));
+        }
+
+        // 4.1. Карты перечитываются из конфига по SIGHUP или POST /admin/maps/reload
+        auto map_reloader = std::make_shared<map_reload::MapReloader>(strand, game, args.value().config, args.value().map_bundle);
+        map_reloader->SetMapFilter(map_filter);
+        handler.SetMapReloader(map_reloader);
+
+        // 4.2. Статические файлы читаются на отдельных потоках или через io_uring на потоках сети.
+        // Пул объявлен после обработчика и останавливается раньше него
+        std::optional<BlockingPool> file_pool;
+#ifdef BOOST_ASIO_HAS_FILE
+        if (args.value().static_io == "uring"s) {
+            handler.SetAsyncFileExecutor(ioc.get_executor());
+        }
+#endif
+        if (args.value().static_io == "pool"s) {
+            file_pool.emplace(topology.file_io);
+            handler.SetFileExecutor(file_pool->GetExecutor());
+        }
+
+        net::signal_set reload_signals(ioc, SIGHUP);
+        std::function<void(const sys::error_code&, int)> on_reload_signal = [&](const sys::error_code& ec, int) {
+            if (!ec) {
+                map_reloader->Reload();
+                reload_signals.async_wait(on_reload_signal);
+            }
+        };
+        reload_signals.async_wait(on_reload_signal);
 
         // 5. Запустить обработчик HTTP-запросов, делегируя их обработчику запросов
         const auto address = net::ip::make_address("0.0.0.0");
-        constexpr net::ip::port_type port = 8080;
+        const auto port = static_cast<net::ip::port_type>(args.value().port);
 
-        const tcp::endpoint& end_point = {address, port};
-        http_server::ServeHttp(ioc, {address, port}, [&handler, &end_point](auto&& req, auto&& send) {
-            handler(std::forward<decltype(req)>(req), std::forward<decltype(send)>(send), end_point);
-        });
+        http_server::ServeHttp(ioc, {address, port}, [&handler](auto&& req, auto&& send, const tcp::endpoint& remote_endpoint) {
+            handler(std::forward<decltype(req)>(req), std::forward<decltype(send)>(send), remote_endpoint);
+        }, args.value().listener);
 
         // Эта надпись сообщает тестам о том, что сервер запущен и готов обрабатывать запросы
-        boost::json::value custom_data{{"port"s, 8080}, {"address", "0.0.0.0"}};
+        boost::json::value custom_data{{"port"s, args.value().port}, {"address", "0.0.0.0"}};
         logger::LogJSON(custom_data, "server started"sv);
 
         //Говорим игре обновлять своё состояние каждые N тиков
@@ -156,13 +430,46 @@ int main(int argc, const char* argv[]) {
             ticker->Start();
         }
 
+        // Периодические снимки: копия состояния снимается в strand, на диск пишет фоновый поток
+        std::optional<snapshot::SnapshotWriter> snapshot_writer;
+        if (!state_file.empty() && args.value().save_state_period > 0) {
+            // Сохранённый снимок делает ненужными сегменты журнала, целиком в него вошедшие
+            snapshot_writer.emplace(state_file, [&wal_writer](const model::GameSnapshot& saved) {
+                if (wal_writer.has_value()) {
+                    wal_writer->Checkpoint(saved.last_event);
+                }
+            });
+            auto saver = std::make_shared<Ticker>(strand, std::chrono::milliseconds(args.value().save_state_period),
+                [&game, &snapshot_writer]([[maybe_unused]] std::chrono::milliseconds delta) { snapshot_writer->Submit(game.MakeSnapshot()); }
+            );
+            saver->Start();
+        }
+
         // 6. Запускаем обработку асинхронных операций
-        RunWorkers(std::max(1u, num_threads), [&ioc] {
+        RunWorkers(std::max(1u, num_threads), [&ioc, &topology](unsigned index) {
+            PinThread(topology.io, index, "io"sv);
             ioc.run();
         });
+
+        // Потоки остановлены - сохраняем итоговое состояние синхронно
+        if (!state_file.empty()) {
+            if (snapshot_writer.has_value()) {
+                snapshot_writer->Stop();
+            }
+            const model::GameSnapshot final_snapshot = game.MakeSnapshot();
+            snapshot::SaveToFile(final_snapshot, state_file);
+            if (wal_writer.has_value()) {
+                wal_writer->Checkpoint(final_snapshot.last_event);
+            }
+        }
+        if (wal_writer.has_value()) {
+            wal_writer->Stop();
+        }
+        logger::StopAsyncLogging();
     } catch (const std::exception& ex) {
         boost::json::value custom_data{{"code"s, EXIT_FAILURE}, {"exception", ex.what()}};
         logger::LogJSON(custom_data, "server exited"sv);
+        logger::StopAsyncLogging();
 
         return EXIT_FAILURE;
     }
@@ -1,11 +1,13 @@
 #include "map.h"
 
+#include <limits>
+
 namespace model {
 
 using Id = util::Tagged<std::string, Map>;
-using Roads = std::vector<Road>;
-using Buildings = std::vector<Building>;
-using Offices = std::vector<Office>;
+using Roads = Map::Roads;
+using Buildings = Map::Buildings;
+using Offices = Map::Offices;
 
 double RoundToOnePoint(double x) {
    return static_cast<double>(x * 10.) / 10.;
@@ -80,15 +82,40 @@ const double& Map::GetDogSpeed() const noexcept {
     return dog_speed_;
 }
 
+const RoadGrid& Map::GetGrid() const noexcept {
+    return grid_;
+}
+
+size_t Map::GetMaxPlayers() const noexcept {
+    return max_players_;
+}
+
+double Map::GetInterestRadius() const noexcept {
+    return interest_radius_;
+}
+
 void Map::SetDogSpeed(double new_speed) {
     dog_speed_ = new_speed;
 }
 
+void Map::SetMaxPlayers(size_t max_players) {
+    max_players_ = max_players;
+}
+
+void Map::SetInterestRadius(double radius) {
+    interest_radius_ = std::max(radius, 0.0);
+}
+
 void Map::AddRoad(const Road& road) {
     roads_.emplace_back(road);
     grid_.AddRoad(road);
 }
 
+void Map::SetRoads(Roads roads, RoadGrid grid) {
+    roads_ = std::move(roads);
+    grid_ = std::move(grid);
+}
+
 void Map::AddBuilding(const Building& building) {
     buildings_.emplace_back(building);
 }
@@ -192,15 +219,107 @@ pt::ptree Map::PrepareOffices() const {
 }
 
 std::string Map::PrintMap() const {
-    pt::ptree data;
-
-    data.put("id", *id_);
-    data.put("name", name_);
-    data.add_child("roads", PrepareRoads());
-    data.add_child("buildings", PrepareBuildings());
-    data.add_child("offices", PrepareOffices());
+    std::string result;
+    MapJsonWriter writer;
+    while (writer.Write(*this, result, std::numeric_limits<size_t>::max())) {
+    }
+    return result;
+}
+
+// ------------------------------ MapJsonWriter ------------------------------
+void AppendJsonString(std::string& out, std::string_view value) {
+    constexpr std::string_view hex = "0123456789abcdef";
+    out += '"';
+    for (char ch : value) {
+        switch (ch) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(ch) < 0x20) {
+                out += "\\u00";
+                out += hex[(ch >> 4) & 0xf];
+                out += hex[ch & 0xf];
+            } else {
+                out += ch;
+            }
+        }
+    }
+    out += '"';
+}
 
-    return PtreeToString(data);
+bool MapJsonWriter::Write(const Map& map, std::string& buffer, size_t limit) {
+    // Элементы массивов дописываются целиком, поэтому buffer может превысить limit на один элемент.
+    // Каждый вызов дописывает хотя бы один элемент, даже если buffer уже полон
+    auto separator = [this, &buffer]() {
+        if (index_ != 0) {
+            buffer += ',';
+        }
+    };
+
+    do {
+        switch (stage_) {
+        case Stage::HEADER:
+            buffer += "{\"id\":";
+            AppendJsonString(buffer, *map.GetId());
+            buffer += ",\"name\":";
+            AppendJsonString(buffer, map.GetName());
+            buffer += ",\"roads\":[";
+            stage_ = Stage::ROADS;
+            break;
+
+        case Stage::ROADS:
+            if (index_ == map.GetRoads().size()) {
+                buffer += "],\"buildings\":[";
+                stage_ = Stage::BUILDINGS;
+                index_ = 0;
+            } else {
+                const Road& road = map.GetRoads()[index_];
+                separator();
+                buffer += "{\"x0\":" + std::to_string(road.GetStart().x) + ",\"y0\":" + std::to_string(road.GetStart().y);
+                buffer += road.IsHorizontal() ? ",\"x1\":" + std::to_string(road.GetEnd().x) + "}"
+                                              : ",\"y1\":" + std::to_string(road.GetEnd().y) + "}";
+                ++index_;
+            }
+            break;
+
+        case Stage::BUILDINGS:
+            if (index_ == map.GetBuildings().size()) {
+                buffer += "],\"offices\":[";
+                stage_ = Stage::OFFICES;
+                index_ = 0;
+            } else {
+                const Rectangle& bounds = map.GetBuildings()[index_].GetBounds();
+                separator();
+                buffer += "{\"x\":" + std::to_string(bounds.position.x) + ",\"y\":" + std::to_string(bounds.position.y)
+                    + ",\"w\":" + std::to_string(bounds.size.width) + ",\"h\":" + std::to_string(bounds.size.height) + "}";
+                ++index_;
+            }
+            break;
+
+        case Stage::OFFICES:
+            if (index_ == map.GetOffices().size()) {
+                buffer += "]}";
+                stage_ = Stage::DONE;
+            } else {
+                const Office& office = map.GetOffices()[index_];
+                separator();
+                buffer += "{\"id\":";
+                AppendJsonString(buffer, *office.GetId());
+                buffer += ",\"x\":" + std::to_string(office.GetPosition().x) + ",\"y\":" + std::to_string(office.GetPosition().y)
+                    + ",\"offsetX\":" + std::to_string(office.GetOffset().dx)
+                    + ",\"offsetY\":" + std::to_string(office.GetOffset().dy) + "}";
+                ++index_;
+            }
+            break;
+
+        case Stage::DONE:
+            return false;
+        }
+    } while (buffer.size() < limit);
+    return stage_ != Stage::DONE;
 }
 
 // ------------------------------ RoadBounces ------------------------------
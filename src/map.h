@@ -14,11 +14,14 @@
 #include <boost/property_tree/json_parser.hpp>
 #include <format>
 #include <memory>
+#include <memory_resource>
 #include <random>
 #include <optional>
 #include <regex>
+#include <string_view>
 
 #include "http_server.h"
+#include "memory_stats.h"
 #include "tagged.h"
 
 
@@ -161,12 +164,22 @@ struct RoadBounces {
 
 class RoadGrid{
 public:
+    RoadGrid() = default;
+    // Готовые границы дорог, например из бинарного бандла карт
+    explicit RoadGrid(const std::vector<RoadBounces>& bounces)
+        : roads_(bounces.begin(), bounces.end(), memory::GetResource(memory::Subsystem::MAPS)) {
+    }
+
     void AddRoad(const Road& road);
+    const std::pmr::vector<RoadBounces>& GetBounces() const noexcept {
+        return roads_;
+    }
+
     bool IsPointOnGrid(DogPoint start, DogPoint end) const;
     DogPoint HandleCollizion(DogPoint start, DogPoint end) const;
     std::vector<RoadBounces> GetAllGrids(DogPoint point) const;
 private:
-    std::vector<RoadBounces> roads_;
+    std::pmr::vector<RoadBounces> roads_{memory::GetResource(memory::Subsystem::MAPS)};
     const RoadBounces& GetGridWithPoint(DogPoint point) const;
     int CountPointWithGrid(DogPoint point) const;
     bool GridPoint(DogPoint point) const;
@@ -175,9 +188,10 @@ private:
 class Map {
 public:
     using Id = util::Tagged<std::string, Map>;
-    using Roads = std::vector<Road>;
-    using Buildings = std::vector<Building>;
-    using Offices = std::vector<Office>;
+    // Память карт учитывается в memory::Subsystem::MAPS
+    using Roads = std::pmr::vector<Road>;
+    using Buildings = std::pmr::vector<Building>;
+    using Offices = std::pmr::vector<Office>;
 
     Map(Id id, std::string name) noexcept
         : id_(std::move(id))
@@ -191,14 +205,23 @@ public:
     const Roads& GetRoads() const noexcept;
     const Offices& GetOffices() const noexcept;
     const double& GetDogSpeed() const noexcept;
+    const RoadGrid& GetGrid() const noexcept;
+    // Сколько игроков помещается в один экземпляр карты, 0 - без ограничения
+    size_t GetMaxPlayers() const noexcept;
+    // Радиус, в котором игрок видит других псов в /state, 0 - видит всех
+    double GetInterestRadius() const noexcept;
 
     void AddRoad(const Road& road);
+    // Заменяет все дороги разом вместе с уже построенной для них сеткой
+    void SetRoads(Roads roads, RoadGrid grid);
     void AddBuilding(const Building& building);
     void AddOffice(Office office);
 
     bool IsPointOnRoad(DogPoint start, DogPoint end) const;
     DogPoint HandleCollizion(DogPoint start, DogPoint end) const;
     void SetDogSpeed(double new_speed);
+    void SetMaxPlayers(size_t max_players);
+    void SetInterestRadius(double radius);
 
     std::pair<double, double> GetRandomRoadPoint() const;
     std::pair<double, double> GetDefaultPoint() const;
@@ -210,17 +233,43 @@ public:
     std::string PrintMap() const;
 
 private:
-    using OfficeIdToIndex = std::unordered_map<Office::Id, size_t, util::TaggedHasher<Office::Id>>;
+    using OfficeIdToIndex = std::pmr::unordered_map<Office::Id, size_t, util::TaggedHasher<Office::Id>>;
 
     Id id_;
     std::string name_;
-    Roads roads_;
-    Buildings buildings_;
+    Roads roads_{memory::GetResource(memory::Subsystem::MAPS)};
+    Buildings buildings_{memory::GetResource(memory::Subsystem::MAPS)};
     RoadGrid grid_;
 
-    OfficeIdToIndex warehouse_id_to_index_;
-    Offices offices_;
+    OfficeIdToIndex warehouse_id_to_index_{memory::GetResource(memory::Subsystem::MAPS)};
+    Offices offices_{memory::GetResource(memory::Subsystem::MAPS)};
     double dog_speed_;
+    size_t max_players_ = 0;
+    double interest_radius_ = 0.0;
+};
+
+// Дописывает в out строку value в кавычках JSON
+void AppendJsonString(std::string& out, std::string_view value);
+
+// JSON карты для /api/v1/maps/{id}, записываемый по частям: Write дописывает в buffer дороги,
+// здания и офисы, пока buffer не дорастёт до limit, и продолжает с того же места при следующем
+// вызове. Сам писатель хранит только позицию, поэтому карта передаётся в каждый вызов
+class MapJsonWriter {
+public:
+    // false - документ дописан до конца
+    bool Write(const Map& map, std::string& buffer, size_t limit);
+
+private:
+    enum class Stage {
+        HEADER,
+        ROADS,
+        BUILDINGS,
+        OFFICES,
+        DONE
+    };
+
+    Stage stage_ = Stage::HEADER;
+    size_t index_ = 0;
 };
 
 } // namespace model
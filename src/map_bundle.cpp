@@ -0,0 +1,302 @@
+#include "map_bundle.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include "binary_io.h"
+#include "parallel.h"
+
+namespace map_bundle {
+
+using namespace std::literals;
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr std::string_view MAGIC = "GMAP"sv;
+constexpr uint32_t VERSION = 5;
+
+// Записи плотных массивов бандла
+struct RoadRecord {
+    int32_t x0, y0, x1, y1;
+};
+
+struct BuildingRecord {
+    int32_t x, y, w, h;
+};
+
+static_assert(std::is_trivially_copyable_v<model::RoadBounces> && sizeof(model::RoadBounces) == 4 * sizeof(double));
+
+template <typename T, typename Allocator>
+void WriteArray(binary_io::Writer& writer, const std::vector<T, Allocator>& items) {
+    writer.Write<uint32_t>(static_cast<uint32_t>(items.size()));
+    writer.WriteBytes({reinterpret_cast<const char*>(items.data()), items.size() * sizeof(T)});
+}
+
+template <typename T>
+std::vector<T> ReadArray(binary_io::Reader& reader) {
+    const auto count = reader.Read<uint32_t>();
+    const std::string_view bytes = reader.Take(static_cast<size_t>(count) * sizeof(T));
+
+    std::vector<T> items(count);
+    std::memcpy(items.data(), bytes.data(), bytes.size());
+    return items;
+}
+
+void WriteMap(binary_io::Writer& writer, const model::Map& map) {
+    writer.WriteString<uint16_t>(*map.GetId());
+    writer.WriteString<uint16_t>(map.GetName());
+    writer.Write(map.GetDogSpeed());
+    writer.Write<uint32_t>(static_cast<uint32_t>(map.GetMaxPlayers()));
+    writer.Write(map.GetInterestRadius());
+
+    std::vector<RoadRecord> roads;
+    roads.reserve(map.GetRoads().size());
+    for (const auto& road : map.GetRoads()) {
+        roads.push_back({road.GetStart().x, road.GetStart().y, road.GetEnd().x, road.GetEnd().y});
+    }
+    WriteArray(writer, roads);
+    WriteArray(writer, map.GetGrid().GetBounces());
+
+    std::vector<BuildingRecord> buildings;
+    buildings.reserve(map.GetBuildings().size());
+    for (const auto& building : map.GetBuildings()) {
+        const auto& bounds = building.GetBounds();
+        buildings.push_back({bounds.position.x, bounds.position.y, bounds.size.width, bounds.size.height});
+    }
+    WriteArray(writer, buildings);
+
+    writer.Write<uint32_t>(static_cast<uint32_t>(map.GetOffices().size()));
+    for (const auto& office : map.GetOffices()) {
+        writer.WriteString<uint16_t>(*office.GetId());
+        writer.Write<int32_t>(office.GetPosition().x);
+        writer.Write<int32_t>(office.GetPosition().y);
+        writer.Write<int32_t>(office.GetOffset().dx);
+        writer.Write<int32_t>(office.GetOffset().dy);
+    }
+}
+
+model::Map ReadMap(std::string_view block) {
+    binary_io::Reader reader{block};
+
+    model::Map::Id id{std::string(reader.ReadString<uint16_t>())};
+    model::Map map{std::move(id), std::string(reader.ReadString<uint16_t>())};
+    map.SetDogSpeed(reader.Read<double>());
+    map.SetMaxPlayers(reader.Read<uint32_t>());
+    map.SetInterestRadius(reader.Read<double>());
+
+    const auto road_records = ReadArray<RoadRecord>(reader);
+    model::Map::Roads roads{memory::GetResource(memory::Subsystem::MAPS)};
+    roads.reserve(road_records.size());
+    for (const auto& road : road_records) {
+        if (road.y0 == road.y1) {
+            roads.emplace_back(model::Road::HORIZONTAL, model::Point{road.x0, road.y0}, road.x1);
+        } else {
+            roads.emplace_back(model::Road::VERTICAL, model::Point{road.x0, road.y0}, road.y1);
+        }
+    }
+    auto bounces = ReadArray<model::RoadBounces>(reader);
+    if (bounces.size() != roads.size()) {
+        throw std::runtime_error("Road index doesn't match roads in map bundle"s);
+    }
+    map.SetRoads(std::move(roads), model::RoadGrid{std::move(bounces)});
+
+    for (const auto& building : ReadArray<BuildingRecord>(reader)) {
+        map.AddBuilding(model::Building{model::Rectangle{{building.x, building.y}, {building.w, building.h}}});
+    }
+
+    const auto offices = reader.Read<uint32_t>();
+    for (uint32_t i = 0; i < offices; ++i) {
+        model::Office::Id office_id{std::string(reader.ReadString<uint16_t>())};
+        const auto x = reader.Read<int32_t>();
+        const auto y = reader.Read<int32_t>();
+        const auto dx = reader.Read<int32_t>();
+        const auto dy = reader.Read<int32_t>();
+        map.AddOffice(model::Office{std::move(office_id), {x, y}, {dx, dy}});
+    }
+
+    if (!reader.AtEnd()) {
+        throw std::runtime_error("Trailing data in map bundle block"s);
+    }
+    return map;
+}
+
+void WriteBucket(binary_io::Writer& writer, const http_handler::TokenBucketConfig& bucket) {
+    writer.Write(bucket.rate);
+    writer.Write(bucket.burst);
+}
+
+http_handler::TokenBucketConfig ReadBucket(binary_io::Reader& reader) {
+    http_handler::TokenBucketConfig bucket;
+    bucket.rate = reader.Read<double>();
+    bucket.burst = reader.Read<double>();
+    return bucket;
+}
+
+void WriteRateLimits(binary_io::Writer& writer, const http_handler::RateLimitConfig& rate_limits) {
+    WriteBucket(writer, rate_limits.per_token);
+    WriteBucket(writer, rate_limits.per_address);
+    writer.Write<uint32_t>(static_cast<uint32_t>(rate_limits.per_endpoint.size()));
+    for (const auto& endpoint : rate_limits.per_endpoint) {
+        writer.WriteString<uint16_t>(endpoint.prefix);
+        WriteBucket(writer, endpoint.bucket);
+    }
+}
+
+http_handler::RateLimitConfig ReadRateLimits(binary_io::Reader& reader) {
+    http_handler::RateLimitConfig rate_limits;
+    rate_limits.per_token = ReadBucket(reader);
+    rate_limits.per_address = ReadBucket(reader);
+    const auto endpoints = reader.Read<uint32_t>();
+    for (uint32_t i = 0; i < endpoints; ++i) {
+        std::string prefix{reader.ReadString<uint16_t>()};
+        rate_limits.per_endpoint.push_back({std::move(prefix), ReadBucket(reader)});
+    }
+    return rate_limits;
+}
+
+// Файл, отображённый в память только для чтения
+class MappedFile {
+public:
+    explicit MappedFile(const fs::path& path) {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "open "s + path.string());
+        }
+
+        struct stat st{};
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::system_error(errno, std::generic_category(), "fstat "s + path.string());
+        }
+        size_ = static_cast<size_t>(st.st_size);
+
+        if (size_ > 0) {
+            data_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        ::close(fd);
+        if (data_ == MAP_FAILED) {
+            data_ = nullptr;
+            throw std::system_error(errno, std::generic_category(), "mmap "s + path.string());
+        }
+        if (data_ != nullptr) {
+            // Карты всё равно читаются целиком - просим ядро подгрузить файл заранее
+            ::madvise(data_, size_, MADV_WILLNEED);
+        }
+    }
+
+    ~MappedFile() {
+        if (data_ != nullptr) {
+            ::munmap(data_, size_);
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view Data() const {
+        return {static_cast<const char*>(data_), size_};
+    }
+
+private:
+    void* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+} // namespace
+
+uint64_t Fingerprint(const model::Map& map) {
+    std::string block;
+    binary_io::Writer writer{block};
+    WriteMap(writer, map);
+    return binary_io::Hash(block);
+}
+
+std::string Compile(const json_loader::Config& config, std::string_view source_config) {
+    const model::Game& game = config.game;
+    const auto& maps = game.GetMaps();
+
+    // Сначала блоки карт, затем заголовок с оглавлением, в котором уже известны их смещения
+    std::vector<std::string> blocks(maps.size());
+    util::ParallelFor(maps.size(), [&](size_t i) {
+        binary_io::Writer writer{blocks[i]};
+        WriteMap(writer, *maps[i]);
+    });
+
+    std::string bundle;
+    binary_io::Writer writer{bundle};
+    writer.WriteBytes(MAGIC);
+    writer.Write(VERSION);
+    writer.Write(binary_io::Hash(source_config));
+    writer.Write<uint64_t>(static_cast<uint64_t>(game.GetRetirementTime().count()));
+    WriteRateLimits(writer, config.rate_limits);
+    writer.Write<uint32_t>(static_cast<uint32_t>(blocks.size()));
+
+    uint64_t offset = bundle.size() + blocks.size() * 2 * sizeof(uint64_t);
+    for (const auto& block : blocks) {
+        writer.Write<uint64_t>(offset);
+        writer.Write<uint64_t>(block.size());
+        offset += block.size();
+    }
+    for (const auto& block : blocks) {
+        writer.WriteBytes(block);
+    }
+    return bundle;
+}
+
+std::optional<json_loader::Config> Load(const fs::path& bundle_path, const fs::path& config_path) {
+    if (!fs::exists(bundle_path)) {
+        return std::nullopt;
+    }
+
+    MappedFile file{bundle_path};
+    binary_io::Reader reader{file.Data()};
+
+    if (reader.Take(MAGIC.size()) != MAGIC) {
+        throw std::runtime_error("Not a map bundle: "s + bundle_path.string());
+    }
+    if (reader.Read<uint32_t>() != VERSION) {
+        return std::nullopt;
+    }
+    // Бандл устарел, если config.json поменялся после сборки
+    const auto source_hash = reader.Read<uint64_t>();
+    if (auto config = binary_io::ReadFile(config_path); config.has_value() && binary_io::Hash(*config) != source_hash) {
+        return std::nullopt;
+    }
+    const auto retirement_time = reader.Read<uint64_t>();
+    auto rate_limits = ReadRateLimits(reader);
+
+    std::vector<std::string_view> blocks(reader.Read<uint32_t>());
+    for (auto& block : blocks) {
+        const auto offset = reader.Read<uint64_t>();
+        const auto size = reader.Read<uint64_t>();
+        if (offset > file.Data().size() || size > file.Data().size() - offset) {
+            throw std::runtime_error("Map bundle block out of file bounds"s);
+        }
+        block = file.Data().substr(offset, size);
+    }
+
+    std::vector<std::optional<model::Map>> maps(blocks.size());
+    util::ParallelFor(blocks.size(), [&](size_t i) {
+        maps[i].emplace(ReadMap(blocks[i]));
+    });
+
+    json_loader::Config loaded;
+    loaded.game.SetRetirementTime(std::chrono::milliseconds{retirement_time});
+    for (auto& map : maps) {
+        loaded.game.AddMap(std::move(*map));
+    }
+    loaded.rate_limits = std::move(rate_limits);
+    return loaded;
+}
+
+} // namespace map_bundle
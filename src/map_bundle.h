@@ -0,0 +1,33 @@
+#ifndef __MAP_BUNDLE__
+#define __MAP_BUNDLE__
+
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "json_loader.h"
+#include "model.h"
+
+namespace map_bundle {
+
+// Бинарный бандл карт: сигнатура, версия, хеш исходного config.json, dogRetirementTime в мс, rateLimits, оглавление
+// (смещение и размер блока каждой карты), затем блоки карт. Дороги, границы дорог для RoadGrid, здания и офисы лежат
+// плотными массивами и копируются из отображённого в память файла целиком, без разбора
+std::string Compile(const json_loader::Config& config, std::string_view source_config);
+
+// Хеш содержимого карты в формате бандла: совпадает, только если карты не отличаются ничем
+uint64_t Fingerprint(const model::Map& map);
+
+// Загружает карты из бандла через mmap, собирая карты параллельно.
+// nullopt, если файла нет, версия не поддерживается или бандл собран не из этого config_path.
+// Повреждённый бандл - std::runtime_error / std::out_of_range
+std::optional<json_loader::Config> Load(const std::filesystem::path& bundle_path, const std::filesystem::path& config_path);
+
+} // namespace map_bundle
+
+#endif
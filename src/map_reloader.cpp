@@ -0,0 +1,180 @@
+#include "map_reloader.h"
+
+#include <boost/asio/post.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+#include "json_loader.h"
+#include "logger.h"
+#include "map_bundle.h"
+
+namespace map_reload {
+
+using namespace std::literals;
+
+model::Game::Maps SelectMaps(const model::Game::Maps& maps, const std::vector<std::string>& ids) {
+    if (ids.empty()) {
+        return maps;
+    }
+
+    model::Game::Maps selected;
+    for (const std::string& id : ids) {
+        auto it = std::find_if(maps.begin(), maps.end(), [&id](const auto& map) {
+            return *map->GetId() == id;
+        });
+        if (it == maps.end()) {
+            throw std::invalid_argument("Map "s + id + " not found in config"s);
+        }
+        selected.push_back(*it);
+    }
+    return selected;
+}
+
+MapReloader::MapReloader(Strand& strand, model::Game& game, std::filesystem::path config_path,
+                         std::filesystem::path bundle_path)
+    : strand_{strand}
+    , game_{game}
+    , config_path_{std::move(config_path)}
+    , bundle_path_{std::move(bundle_path)}
+    , current_{game.GetMaps()} {
+}
+
+MapReloader::~MapReloader() {
+    std::thread worker;
+    {
+        std::lock_guard lock{mutex_};
+        worker = std::move(worker_);
+    }
+    // Поток в конце берёт mutex_, поэтому ждём его без блокировки
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void MapReloader::SetMapFilter(std::vector<std::string> map_ids) {
+    std::lock_guard lock{mutex_};
+    map_filter_ = std::move(map_ids);
+}
+
+bool MapReloader::Reload() {
+    std::lock_guard lock{mutex_};
+    if (in_progress_) {
+        return false;
+    }
+    in_progress_ = true;
+
+    // Предыдущий поток уже закончил работу, осталось его присоединить
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+    worker_ = std::thread([this] {
+        Run();
+    });
+    return true;
+}
+
+void MapReloader::Run() {
+    const auto start = std::chrono::steady_clock::now();
+    std::ostringstream oss;
+    bool failed = false;
+
+    try {
+        model::Game loaded = bundle_path_.empty()
+            ? json_loader::LoadGame(config_path_)
+            : json_loader::LoadGame(config_path_, bundle_path_);
+        if (loaded.GetMaps().empty()) {
+            throw std::runtime_error("No maps loaded from "s + config_path_.string());
+        }
+        std::vector<std::string> map_filter;
+        {
+            std::lock_guard lock{mutex_};
+            map_filter = map_filter_;
+        }
+        const Result result = Swap(SelectMaps(loaded.GetMaps(), map_filter), loaded.GetRetirementTime());
+        const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+        oss << "{\"added\":" << result.added << ",\"changed\":" << result.changed
+            << ",\"unchanged\":" << result.unchanged << ",\"removed\":" << result.removed
+            << ",\"load_time_ms\":" << duration.count() << "}";
+
+        boost::json::value custom_data{{"added"s, result.added}, {"changed"s, result.changed},
+            {"unchanged"s, result.unchanged}, {"removed"s, result.removed}, {"load_time_ms"s, duration.count()}};
+        logger::LogJSON(custom_data, "maps reloaded"sv);
+    } catch (const std::exception& ex) {
+        oss.str({});
+        oss << "{\"error\":" << boost::json::serialize(boost::json::value(ex.what())) << "}";
+
+        boost::json::value custom_data{{"filename"s, config_path_.string()}, {"exception"s, ex.what()}};
+        logger::LogJSON(custom_data, "maps reload failed"sv);
+        failed = true;
+    }
+
+    std::lock_guard lock{mutex_};
+    ++reloads_;
+    failed_ += failed ? 1 : 0;
+    last_result_ = oss.str();
+    in_progress_ = false;
+}
+
+uint64_t MapReloader::GetFingerprint(const model::Map& map) {
+    if (auto it = fingerprints_.find(&map); it != fingerprints_.end()) {
+        return it->second;
+    }
+    const uint64_t fingerprint = map_bundle::Fingerprint(map);
+    fingerprints_.emplace(&map, fingerprint);
+    return fingerprint;
+}
+
+MapReloader::Result MapReloader::Swap(model::Game::Maps loaded, std::chrono::milliseconds retirement_time) {
+    Result result;
+
+    std::unordered_map<std::string_view, const std::shared_ptr<const model::Map>*> old_maps;
+    for (const auto& map : current_) {
+        old_maps.emplace(*map->GetId(), &map);
+    }
+
+    // Карты сравниваются вне strand: старые неизменяемы, новые ещё никому не видны
+    for (auto& map : loaded) {
+        auto it = old_maps.find(*map->GetId());
+        if (it == old_maps.end()) {
+            ++result.added;
+        } else if (GetFingerprint(**it->second) == GetFingerprint(*map)) {
+            map = *it->second;
+            ++result.unchanged;
+        } else {
+            ++result.changed;
+        }
+        old_maps.erase(*map->GetId());
+    }
+    result.removed = old_maps.size();
+
+    // Отпечатки нужны только для карт, которые останутся текущими
+    std::unordered_map<const model::Map*, uint64_t> fingerprints;
+    for (const auto& map : loaded) {
+        fingerprints.emplace(map.get(), GetFingerprint(*map));
+    }
+    fingerprints_ = std::move(fingerprints);
+    current_ = loaded;
+
+    net::post(strand_, [&game = game_, maps = std::move(loaded), retirement_time]() mutable {
+        game.ReplaceMaps(std::move(maps));
+        // Сессии с прежним сроком простоя не трогаются, с новым - начинают отсчёт заново
+        game.SetRetirementTime(retirement_time);
+    });
+    return result;
+}
+
+std::string MapReloader::PrintStats() const {
+    std::lock_guard lock{mutex_};
+    std::ostringstream oss;
+
+    oss << "{\"inProgress\":" << (in_progress_ ? "true" : "false")
+        << ",\"reloads\":" << reloads_
+        << ",\"failed\":" << failed_
+        << ",\"last\":" << last_result_ << "}";
+    return oss.str();
+}
+
+} // namespace map_reload
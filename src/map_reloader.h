@@ -0,0 +1,87 @@
+#ifndef __MAP_RELOADER__
+#define __MAP_RELOADER__
+
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#pragma once
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/strand.hpp>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "model.h"
+
+namespace map_reload {
+
+namespace net = boost::asio;
+
+// Карты с перечисленными id в порядке maps. Пустой ids - все карты.
+// Id, которого нет среди maps, - std::invalid_argument
+model::Game::Maps SelectMaps(const model::Game::Maps& maps, const std::vector<std::string>& ids);
+
+// Перезагрузка карт из конфига без перезапуска сервера (SIGHUP или POST /admin/maps/reload).
+// Конфиг разбирается, а новые карты с сетками дорог строятся в фоновом потоке. Карты, не
+// изменившиеся по содержимому, остаются прежними объектами, поэтому их сессии не затрагиваются.
+// В strand игры лишь подменяются указатели на карты и dogRetirementTime, а сессии изменённых карт
+// переходят на новые на ближайшем тике. rateLimits не перечитываются - они действуют с запуска сервера
+class MapReloader {
+public:
+    using Strand = net::strand<net::io_context::executor_type>;
+
+    // bundle_path может быть пустым - тогда карты читаются только из config_path
+    MapReloader(Strand& strand, model::Game& game, std::filesystem::path config_path,
+                std::filesystem::path bundle_path = {});
+    ~MapReloader();
+
+    MapReloader(const MapReloader&) = delete;
+    MapReloader& operator=(const MapReloader&) = delete;
+
+    // Запускает перезагрузку и сразу возвращается. false, если предыдущая ещё не закончилась
+    bool Reload();
+
+    // Оставлять при перезагрузке только эти карты (шард обслуживает часть карт конфига)
+    void SetMapFilter(std::vector<std::string> map_ids);
+
+    // Итог последней перезагрузки в виде JSON для /admin/maps
+    std::string PrintStats() const;
+
+private:
+    struct Result {
+        size_t added = 0;
+        size_t changed = 0;
+        size_t unchanged = 0;
+        size_t removed = 0;
+    };
+
+    void Run();
+    Result Swap(model::Game::Maps loaded, std::chrono::milliseconds retirement_time);
+    uint64_t GetFingerprint(const model::Map& map);
+
+    Strand& strand_;
+    model::Game& game_;
+    std::filesystem::path config_path_;
+    std::filesystem::path bundle_path_;
+    std::vector<std::string> map_filter_;
+
+    mutable std::mutex mutex_;
+    bool in_progress_ = false;
+    uint64_t reloads_ = 0;
+    uint64_t failed_ = 0;
+    std::string last_result_ = "null";
+    std::thread worker_;
+
+    // Карты, отданные игре последней перезагрузкой, и их отпечатки. Меняются только в фоновом потоке
+    model::Game::Maps current_;
+    std::unordered_map<const model::Map*, uint64_t> fingerprints_;
+};
+
+} // namespace map_reload
+
+#endif
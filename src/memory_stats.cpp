@@ -0,0 +1,50 @@
+#include "memory_stats.h"
+
+#include <sstream>
+
+namespace memory {
+
+using namespace std::literals;
+
+std::string_view GetSubsystemName(Subsystem subsystem) {
+    switch (subsystem) {
+        case Subsystem::SESSIONS:
+            return "sessions"sv;
+        case Subsystem::PLAYERS:
+            return "players"sv;
+        case Subsystem::TOKENS:
+            return "tokens"sv;
+        case Subsystem::MAPS:
+            return "maps"sv;
+        case Subsystem::CONNECTIONS:
+            return "connections"sv;
+        case Subsystem::COUNT:
+            break;
+    }
+    return "unknown"sv;
+}
+
+std::string CountingResource::PrintStats() const {
+    std::ostringstream oss;
+    oss << "{\"liveBytes\":" << GetLiveBytes()
+        << ",\"peakBytes\":" << GetPeakBytes()
+        << ",\"allocations\":" << GetAllocations() << "}";
+    return oss.str();
+}
+
+std::string Accounting::PrintStats() const {
+    std::string result = "{";
+    for (size_t i = 0; i < resources_.size(); ++i) {
+        if (i > 0) {
+            result += ',';
+        }
+        result += '"';
+        result += GetSubsystemName(static_cast<Subsystem>(i));
+        result += "\":";
+        result += resources_[i].PrintStats();
+    }
+    result += '}';
+    return result;
+}
+
+} // namespace memory
@@ -0,0 +1,110 @@
+#ifndef __MEMORY_STATS__
+#define __MEMORY_STATS__
+
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+
+namespace memory {
+
+// Ресурс, считающий живые и пиковые байты всех выделений через него. Счётчики атомарные:
+// экземпляры карт, чьи ресурсы смотрят в общий ресурс подсистемы, обновляются параллельно
+class CountingResource : public std::pmr::memory_resource {
+public:
+    explicit CountingResource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource()) noexcept
+        : upstream_{upstream} {}
+
+    CountingResource(const CountingResource&) = delete;
+    CountingResource& operator=(const CountingResource&) = delete;
+
+    size_t GetLiveBytes() const noexcept {
+        return live_bytes_.load(std::memory_order_relaxed);
+    }
+
+    size_t GetPeakBytes() const noexcept {
+        return peak_bytes_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t GetAllocations() const noexcept {
+        return allocations_.load(std::memory_order_relaxed);
+    }
+
+    std::string PrintStats() const;
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        void* p = upstream_->allocate(bytes, alignment);
+        allocations_.fetch_add(1, std::memory_order_relaxed);
+        const size_t live = live_bytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        size_t peak = peak_bytes_.load(std::memory_order_relaxed);
+        while (live > peak && !peak_bytes_.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+        }
+        return p;
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        upstream_->deallocate(p, bytes, alignment);
+        live_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    std::pmr::memory_resource* upstream_;
+    std::atomic<size_t> live_bytes_{0};
+    std::atomic<size_t> peak_bytes_{0};
+    std::atomic<uint64_t> allocations_{0};
+};
+
+// Подсистемы, чья память учитывается отдельно
+enum class Subsystem {
+    SESSIONS,     // экземпляры карт и их индексы в Game
+    PLAYERS,      // игроки всех сессий (token_to_player_)
+    TOKENS,       // индекс токен -> сессия
+    MAPS,         // дороги, здания, офисы и сетки дорог карт
+    CONNECTIONS,  // буферы чтения и арены соединений
+    COUNT
+};
+
+std::string_view GetSubsystemName(Subsystem subsystem);
+
+// Ресурсы подсистем на всё время работы процесса, отдаются на /admin/memory
+class Accounting {
+public:
+    static Accounting& Instance() {
+        static Accounting accounting;
+        return accounting;
+    }
+
+    CountingResource& Get(Subsystem subsystem) {
+        return resources_[static_cast<size_t>(subsystem)];
+    }
+
+    const CountingResource& Get(Subsystem subsystem) const {
+        return resources_[static_cast<size_t>(subsystem)];
+    }
+
+    // {"players":{"liveBytes":..,"peakBytes":..,"allocations":..},...}
+    std::string PrintStats() const;
+
+private:
+    Accounting() = default;
+
+    std::array<CountingResource, static_cast<size_t>(Subsystem::COUNT)> resources_;
+};
+
+inline std::pmr::memory_resource* GetResource(Subsystem subsystem) {
+    return &Accounting::Instance().Get(subsystem);
+}
+
+} // namespace memory
+
+#endif
@@ -0,0 +1,241 @@
+#include "metrics.h"
+
+#include <bit>
+#include <sstream>
+#include <stdexcept>
+
+namespace metrics {
+
+using namespace std::literals;
+
+// ------------------------------ HistogramBuckets ------------------------------
+size_t HistogramBuckets::Index(uint64_t value) {
+    if (value < SUB_BUCKETS) {
+        return static_cast<size_t>(value);
+    }
+
+    const size_t exponent = 63 - std::countl_zero(value);
+    if (exponent >= MAX_EXPONENT) {
+        return COUNT - 1;
+    }
+    const size_t sub_bucket = (value >> (exponent - 2)) & (SUB_BUCKETS - 1);
+    return SUB_BUCKETS + (exponent - 2) * SUB_BUCKETS + sub_bucket;
+}
+
+uint64_t HistogramBuckets::UpperBound(size_t index) {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+
+    const size_t exponent = (index - SUB_BUCKETS) / SUB_BUCKETS + 2;
+    const uint64_t sub_bucket = (index - SUB_BUCKETS) % SUB_BUCKETS;
+    return ((SUB_BUCKETS + sub_bucket + 1) << (exponent - 2)) - 1;
+}
+
+// ------------------------------ LatencyHistogram ------------------------------
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < buckets_.size(); ++i) {
+        buckets_[i] += other.buckets_[i];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+}
+
+uint64_t LatencyHistogram::Quantile(double q) const {
+    if (count_ == 0) {
+        return 0;
+    }
+
+    const auto rank = static_cast<uint64_t>(q * static_cast<double>(count_ - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets_.size(); ++i) {
+        seen += buckets_[i];
+        if (seen >= rank) {
+            return HistogramBuckets::UpperBound(i);
+        }
+    }
+    return HistogramBuckets::UpperBound(buckets_.size() - 1);
+}
+
+// ------------------------------ Registry ------------------------------
+Registry::Shard& Registry::GetThreadShard() {
+    thread_local Shard* shard = nullptr;
+
+    if (shard == nullptr) {
+        auto new_shard = std::make_unique<Shard>();
+        shard = new_shard.get();
+
+        // Шард живёт до конца программы: значения завершившихся потоков продолжают учитываться
+        std::lock_guard lock{mutex_};
+        shards_.push_back(std::move(new_shard));
+    }
+    return *shard;
+}
+
+size_t Registry::AddSeries(std::string_view name, std::string_view help, Type type, std::string_view labels, size_t id) {
+    for (auto& family : families_) {
+        if (family.name == name) {
+            if (family.type != type) {
+                throw std::invalid_argument("Metric "s + std::string(name) + " registered with another type"s);
+            }
+            family.series.push_back({std::string(labels), id});
+            return id;
+        }
+    }
+
+    families_.push_back({std::string(name), std::string(help), type, {{std::string(labels), id}}});
+    return id;
+}
+
+Counter Registry::AddCounter(std::string_view name, std::string_view help, std::string_view labels) {
+    std::lock_guard lock{mutex_};
+    if (counters_count_ == MAX_COUNTERS) {
+        throw std::length_error("Too many counters");
+    }
+    return Counter{AddSeries(name, help, Type::COUNTER, labels, counters_count_++)};
+}
+
+Histogram Registry::AddHistogram(std::string_view name, std::string_view help, std::string_view labels) {
+    std::lock_guard lock{mutex_};
+    if (histograms_count_ == MAX_HISTOGRAMS) {
+        throw std::length_error("Too many histograms");
+    }
+    return Histogram{AddSeries(name, help, Type::HISTOGRAM, labels, histograms_count_++)};
+}
+
+Gauge Registry::AddGauge(std::string_view name, std::string_view help, std::string_view labels) {
+    std::lock_guard lock{mutex_};
+    gauges_.push_back(std::make_unique<std::atomic<int64_t>>(0));
+    AddSeries(name, help, Type::GAUGE, labels, gauges_.size() - 1);
+    return Gauge{gauges_.back().get()};
+}
+
+namespace {
+
+void AppendSeriesName(std::string& out, std::string_view name, std::string_view suffix,
+                      std::string_view labels, std::string_view extra_label = {}) {
+    out += name;
+    out += suffix;
+    if (!labels.empty() || !extra_label.empty()) {
+        out += '{';
+        out += labels;
+        if (!labels.empty() && !extra_label.empty()) {
+            out += ',';
+        }
+        out += extra_label;
+        out += '}';
+    }
+    out += ' ';
+}
+
+} // namespace
+
+void Registry::ScrapeCounter(const Family& family, std::string& out) const {
+    for (const auto& series : family.series) {
+        uint64_t value = 0;
+        for (const auto& shard : shards_) {
+            value += shard->counters[series.id].load(std::memory_order_relaxed);
+        }
+        AppendSeriesName(out, family.name, {}, series.labels);
+        out += std::to_string(value);
+        out += '\n';
+    }
+}
+
+void Registry::ScrapeGauge(const Family& family, std::string& out) const {
+    for (const auto& series : family.series) {
+        AppendSeriesName(out, family.name, {}, series.labels);
+        out += std::to_string(gauges_[series.id]->load(std::memory_order_relaxed));
+        out += '\n';
+    }
+}
+
+void Registry::ScrapeHistogram(const Family& family, std::string& out) const {
+    for (const auto& series : family.series) {
+        std::array<uint64_t, HistogramBuckets::COUNT> buckets{};
+        uint64_t count = 0;
+        uint64_t sum = 0;
+
+        for (const auto& shard : shards_) {
+            const auto& histogram = shard->histograms[series.id];
+            for (size_t i = 0; i < buckets.size(); ++i) {
+                buckets[i] += histogram.buckets[i].load(std::memory_order_relaxed);
+            }
+            count += histogram.count.load(std::memory_order_relaxed);
+            sum += histogram.sum.load(std::memory_order_relaxed);
+        }
+
+        // Наружу отдаём границы по степеням двойки (в секундах), внутри точность выше
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < buckets.size(); ++i) {
+            cumulative += buckets[i];
+            if (i + 1 < HistogramBuckets::SUB_BUCKETS || (i + 1) % HistogramBuckets::SUB_BUCKETS != 0) {
+                continue;
+            }
+
+            std::ostringstream le;
+            le << "le=\"" << static_cast<double>(HistogramBuckets::UpperBound(i)) / 1e6 << "\"";
+            AppendSeriesName(out, family.name, "_bucket"sv, series.labels, le.str());
+            out += std::to_string(cumulative);
+            out += '\n';
+        }
+        AppendSeriesName(out, family.name, "_bucket"sv, series.labels, "le=\"+Inf\""sv);
+        out += std::to_string(count);
+        out += '\n';
+
+        std::ostringstream sum_seconds;
+        sum_seconds << static_cast<double>(sum) / 1e6;
+        AppendSeriesName(out, family.name, "_sum"sv, series.labels);
+        out += sum_seconds.str();
+        out += '\n';
+
+        AppendSeriesName(out, family.name, "_count"sv, series.labels);
+        out += std::to_string(count);
+        out += '\n';
+    }
+}
+
+std::string Registry::Scrape() const {
+    std::string out;
+    std::lock_guard lock{mutex_};
+
+    for (const auto& family : families_) {
+        out += "# HELP "sv;
+        out += family.name;
+        out += ' ';
+        out += family.help;
+        out += "\n# TYPE "sv;
+        out += family.name;
+
+        switch (family.type) {
+        case Type::COUNTER:
+            out += " counter\n"sv;
+            ScrapeCounter(family, out);
+            break;
+        case Type::GAUGE:
+            out += " gauge\n"sv;
+            ScrapeGauge(family, out);
+            break;
+        case Type::HISTOGRAM:
+            out += " histogram\n"sv;
+            ScrapeHistogram(family, out);
+            break;
+        }
+    }
+    return out;
+}
+
+std::string Label(std::string_view name, std::string_view value) {
+    std::string label{name};
+    label += "=\""sv;
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            label += '\\';
+        }
+        label += c;
+    }
+    label += '"';
+    return label;
+}
+
+} // namespace metrics
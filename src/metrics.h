@@ -0,0 +1,208 @@
+#ifndef __METRICS__
+#define __METRICS__
+
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace metrics {
+
+// Корзины гистограммы в духе HDR: до 4 мкс - точные значения, дальше на каждую степень двойки
+// приходится по 4 корзины. Относительная погрешность не больше 25%, диапазон - до 2^40 мкс
+struct HistogramBuckets {
+    static constexpr size_t SUB_BUCKETS = 4;
+    static constexpr size_t MAX_EXPONENT = 40;
+    static constexpr size_t COUNT = SUB_BUCKETS + (MAX_EXPONENT - 2) * SUB_BUCKETS;
+
+    static size_t Index(uint64_t value);
+    // Наибольшее значение, попадающее в корзину
+    static uint64_t UpperBound(size_t index);
+};
+
+// Однопоточная гистограмма: используется там, где шардирование не нужно (нагрузочные утилиты)
+class LatencyHistogram {
+public:
+    void Observe(uint64_t micros) {
+        ++buckets_[HistogramBuckets::Index(micros)];
+        ++count_;
+        sum_ += micros;
+    }
+
+    void Merge(const LatencyHistogram& other);
+
+    uint64_t Count() const {
+        return count_;
+    }
+
+    uint64_t Sum() const {
+        return sum_;
+    }
+
+    // Значение квантиля q (0..1) в микросекундах
+    uint64_t Quantile(double q) const;
+
+private:
+    std::array<uint64_t, HistogramBuckets::COUNT> buckets_{};
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+};
+
+class Counter {
+public:
+    Counter() = default;
+    explicit Counter(size_t id) : id_{id} {}
+
+    void Inc(uint64_t value = 1) const;
+
+private:
+    size_t id_ = 0;
+};
+
+class Histogram {
+public:
+    Histogram() = default;
+    explicit Histogram(size_t id) : id_{id} {}
+
+    void Observe(uint64_t micros) const;
+
+    template <typename Duration>
+    void Observe(Duration duration) const {
+        Observe(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count()));
+    }
+
+private:
+    size_t id_ = 0;
+};
+
+// Гауги не шардируются: их меняют редко, а читают целиком
+class Gauge {
+public:
+    Gauge() = default;
+    explicit Gauge(std::atomic<int64_t>* value) : value_{value} {}
+
+    void Add(int64_t delta) const {
+        if (value_ != nullptr) {
+            value_->fetch_add(delta, std::memory_order_relaxed);
+        }
+    }
+
+    void Set(int64_t value) const {
+        if (value_ != nullptr) {
+            value_->store(value, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    std::atomic<int64_t>* value_ = nullptr;
+};
+
+// Реестр метрик. Счётчики и гистограммы пишутся в шард текущего потока без синхронизации
+// между потоками и суммируются только при выдаче /metrics
+class Registry {
+public:
+    static constexpr size_t MAX_COUNTERS = 256;
+    static constexpr size_t MAX_HISTOGRAMS = 64;
+
+    static Registry& Instance() {
+        static Registry registry;
+        return registry;
+    }
+
+    Registry(const Registry&) = delete;
+    Registry& operator=(const Registry&) = delete;
+
+    // labels - готовая строка вида route="/api/v1/maps" (может быть пустой)
+    Counter AddCounter(std::string_view name, std::string_view help, std::string_view labels = {});
+    Histogram AddHistogram(std::string_view name, std::string_view help, std::string_view labels = {});
+    Gauge AddGauge(std::string_view name, std::string_view help, std::string_view labels = {});
+
+    // Текстовый формат Prometheus
+    std::string Scrape() const;
+
+private:
+    friend class Counter;
+    friend class Histogram;
+
+    enum class Type {
+        COUNTER,
+        GAUGE,
+        HISTOGRAM
+    };
+
+    struct HistogramShard {
+        std::array<std::atomic<uint64_t>, HistogramBuckets::COUNT> buckets{};
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> sum{0};
+    };
+
+    struct Shard {
+        std::array<std::atomic<uint64_t>, MAX_COUNTERS> counters{};
+        std::array<HistogramShard, MAX_HISTOGRAMS> histograms{};
+    };
+
+    struct Series {
+        std::string labels;
+        size_t id;
+    };
+
+    struct Family {
+        std::string name;
+        std::string help;
+        Type type;
+        std::vector<Series> series;
+    };
+
+    Registry() = default;
+
+    Shard& GetThreadShard();
+    size_t AddSeries(std::string_view name, std::string_view help, Type type, std::string_view labels, size_t id);
+
+    void ScrapeCounter(const Family& family, std::string& out) const;
+    void ScrapeGauge(const Family& family, std::string& out) const;
+    void ScrapeHistogram(const Family& family, std::string& out) const;
+
+    mutable std::mutex mutex_;
+    std::vector<Family> families_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::vector<std::unique_ptr<std::atomic<int64_t>>> gauges_;
+    // нулевые счётчик и гистограмма зарезервированы для объектов, созданных по умолчанию
+    size_t counters_count_ = 1;
+    size_t histograms_count_ = 1;
+};
+
+namespace detail {
+
+// В шард пишет только его поток, поэтому атомарный инкремент не нужен:
+// атомики лишь делают чтение при выдаче /metrics корректным
+inline void ShardAdd(std::atomic<uint64_t>& value, uint64_t delta) {
+    value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+} // namespace detail
+
+inline void Counter::Inc(uint64_t value) const {
+    detail::ShardAdd(Registry::Instance().GetThreadShard().counters[id_], value);
+}
+
+inline void Histogram::Observe(uint64_t micros) const {
+    auto& histogram = Registry::Instance().GetThreadShard().histograms[id_];
+    detail::ShardAdd(histogram.buckets[HistogramBuckets::Index(micros)], 1);
+    detail::ShardAdd(histogram.count, 1);
+    detail::ShardAdd(histogram.sum, micros);
+}
+
+// Строка меток для одного значения, например Label("route", "/api/v1/maps")
+std::string Label(std::string_view name, std::string_view value);
+
+} // namespace metrics
+
+#endif
@@ -1,5 +1,10 @@
 #include "model.h"
+#include "metrics.h"
+#include "tracing.h"
 
+#include <algorithm>
+#include <chrono>
+#include <limits>
 #include <stdexcept>
 
 namespace model {
@@ -11,7 +16,7 @@ void Game::AddMap(Map map) {
         throw std::invalid_argument("Map with id "s + *map.GetId() + " already exists"s);
     } else {
         try {
-            maps_.emplace_back(std::move(map));
+            maps_.emplace_back(std::make_shared<const Map>(std::move(map)));
         } catch (...) {
             map_id_to_index_.erase(it);
             throw;
@@ -19,4 +24,403 @@ void Game::AddMap(Map map) {
     }
 }
 
+void Game::ReplaceMaps(Maps maps) {
+    MapIdToIndex index;
+    for (size_t i = 0; i < maps.size(); ++i) {
+        if (!index.emplace(maps[i]->GetId(), i).second) {
+            throw std::invalid_argument("Map with id "s + *maps[i]->GetId() + " already exists"s);
+        }
+    }
+    for (const auto& map : maps_) {
+        if (!index.contains(map->GetId()) && map_id_to_sessions_.contains(map->GetId())) {
+            index.emplace(map->GetId(), maps.size());
+            maps.push_back(map);
+        }
+    }
+
+    for (auto &[id, instances]: map_id_to_sessions_) {
+        if (auto it = index.find(id); it != index.end()) {
+            for (auto& game_session : instances) {
+                game_session.SetPendingMap(maps[it->second]);
+            }
+        }
+    }
+    maps_ = std::move(maps);
+    map_id_to_index_ = std::move(index);
+}
+
+void GameSession::ApplyPendingMap() {
+    map_ = std::move(pending_map_);
+    pending_map_.reset();
+
+    // Псы, оказавшиеся вне дорог новой карты, переносятся в начало первой дороги,
+    // бегущие - продолжают бег с новой скоростью
+    for (auto &[token, player]: token_to_player_) {
+        const DogState dog = player.GetDogState();
+        if (!map_->IsPointOnRoad(dog.position, dog.position)) {
+            const uint32_t idle_timer = player.GetIdleTimer();
+            player = Player(player.GetId(), player.GetName(), map_->GetDefaultPoint());
+            player.SetIdleTimer(idle_timer);
+        } else if (dog.speed.x != 0.0 || dog.speed.y != 0.0) {
+            player.MoveDog(DirToString.at(dog.direction), map_->GetDogSpeed());
+        }
+    }
+    RebuildInterestGrid();
+}
+
+void GameSession::UpdateState(int tick_rate) {
+    if (pending_map_) {
+        ApplyPendingMap();
+    }
+    RetireIdlePlayers(tick_rate);
+
+    movers_.clear();
+    mover_players_.clear();
+    const bool has_interest_grid = HasInterestGrid();
+    for (auto &[token, player]: token_to_player_) {
+        const DogPoint before = player.GetPosition();
+        player.UpdateState(tick_rate, map_.get());
+        const DogPoint after = player.GetPosition();
+
+        // Сетка видимости обновляется по ходу тика: пёс перекладывается, только если сменил ячейку
+        if (has_interest_grid) {
+            interest_grid_.Move(&player, before, after);
+        }
+        movers_.push_back({before, after});
+        mover_players_.push_back(&player);
+    }
+
+    offices_.clear();
+    for (const auto& office : map_->GetOffices()) {
+        offices_.push_back({{static_cast<double>(office.GetPosition().x), static_cast<double>(office.GetPosition().y)}});
+    }
+
+    contacts_.clear();
+    for (const auto& contact : broadphase_.FindContacts(movers_, offices_)) {
+        ContactEvent& event = contacts_.emplace_back();
+        event.type = contact.type;
+        event.player_id = mover_players_[contact.first]->GetId();
+        event.time = contact.time;
+        if (contact.type == collision::ContactType::DOG_DOG) {
+            event.other_player_id = mover_players_[contact.second]->GetId();
+        } else {
+            event.office_index = contact.second;
+        }
+    }
+}
+
+bool PlayerListJsonWriter::Write(std::string& buffer, size_t limit) {
+    if (done_) {
+        return false;
+    }
+    if (!started_) {
+        buffer += '{';
+        started_ = true;
+    }
+    // Как и MapJsonWriter, дописывает хотя бы одного игрока за вызов
+    for (const size_t first = index_; index_ < players_.size() && (index_ == first || buffer.size() < limit); ++index_) {
+        if (index_ != 0) {
+            buffer += ',';
+        }
+        buffer += "\"" + std::to_string(players_[index_].id) + "\":{\"name\":";
+        AppendJsonString(buffer, players_[index_].name);
+        buffer += '}';
+    }
+    if (index_ < players_.size()) {
+        return true;
+    }
+
+    buffer += '}';
+    done_ = true;
+    players_ = {};
+    return false;
+}
+
+PlayerListJsonWriter GameSession::MakePlayerListWriter() const {
+    std::vector<PlayerListJsonWriter::Entry> players;
+    players.reserve(token_to_player_.size());
+    for (const auto &[token, player]: token_to_player_) {
+        players.push_back({player.GetId(), player.GetName()});
+    }
+    return PlayerListJsonWriter{std::move(players)};
+}
+
+std::string GameSession::GetPlayerList() const {
+    std::string result;
+    PlayerListJsonWriter writer = MakePlayerListWriter();
+    while (writer.Write(result, std::numeric_limits<size_t>::max())) {
+    }
+    return result;
+}
+
+void GameSession::RebuildInterestGrid() {
+    interest_grid_ = SpatialHash<Player>{map_->GetInterestRadius()};
+    if (!HasInterestGrid()) {
+        return;
+    }
+    for (const auto &[token, player]: token_to_player_) {
+        interest_grid_.Insert(&player, player.GetPosition());
+    }
+}
+
+void GameSession::SetRetirementTime(uint64_t retirement_time) {
+    if (retirement_time == retirement_time_) {
+        return;
+    }
+    retirement_time_ = retirement_time;
+    idle_timers_.Clear();
+    for (auto &[token, player]: token_to_player_) {
+        player.SetIdleTimer(util::TimingWheel<const Token*>::NO_TIMER);
+        StartIdleTimer(token, player, 0);
+    }
+}
+
+void GameSession::StartIdleTimer(const Token& token, Player& player, uint64_t idle_time) {
+    if (retirement_time_ == 0) {
+        return;
+    }
+    const uint64_t expires = idle_timers_.GetTime() + retirement_time_ - std::min(idle_time, retirement_time_);
+    player.SetIdleTimer(idle_timers_.Schedule(&token, expires));
+}
+
+void GameSession::ResetIdleTimer(Player& player) {
+    if (player.GetIdleTimer() != util::TimingWheel<const Token*>::NO_TIMER) {
+        idle_timers_.Reschedule(player.GetIdleTimer(), idle_timers_.GetTime() + retirement_time_);
+    }
+}
+
+uint64_t GameSession::GetIdleTime(const Player& player) const {
+    if (player.GetIdleTimer() == util::TimingWheel<const Token*>::NO_TIMER) {
+        return 0;
+    }
+    return idle_timers_.GetTime() + retirement_time_ - idle_timers_.GetExpiry(player.GetIdleTimer());
+}
+
+void GameSession::RetireIdlePlayers(int tick_rate) {
+    retired_.clear();
+    expired_.clear();
+    idle_timers_.Advance(idle_timers_.GetTime() + static_cast<uint64_t>(std::max(tick_rate, 0)), expired_);
+
+    for (const Token* token : expired_) {
+        auto it = token_to_player_.find(*token);
+        if (HasInterestGrid()) {
+            interest_grid_.Erase(&it->second, it->second.GetPosition());
+        }
+        retired_.emplace_back(it->first);
+        token_to_player_.erase(it);
+    }
+    // После массового ухода игроков таблица не держит лишние корзины
+    if (!retired_.empty() && token_to_player_.size() * 4 < token_to_player_.bucket_count()) {
+        token_to_player_.rehash(0);
+    }
+}
+
+GameSession &Game::AddGameSession(const Map::Id& id) {
+    Instances& instances = map_id_to_sessions_[id];
+    GameSession& game_session = instances.emplace_back(FindMapPtr(id), static_cast<uint32_t>(instances.size()));
+    game_session.SetRetirementTime(retirement_time_);
+    sessions_.push_back(&game_session);
+    return game_session;
+}
+
+GameSession &Game::GetGameSession(const Map::Id& id) {
+    auto it = map_id_to_sessions_.find(id);
+    if (it == map_id_to_sessions_.end()) {
+        return AddGameSession(id);
+    }
+
+    const auto map = FindMapPtr(id);
+    const size_t max_players = map != nullptr ? map->GetMaxPlayers() : 0;
+    if (max_players == 0) {
+        return it->second.front();
+    }
+
+    GameSession* least_loaded = nullptr;
+    for (auto& game_session : it->second) {
+        if (game_session.GetPlayerCount() < max_players
+            && (least_loaded == nullptr || game_session.GetPlayerCount() < least_loaded->GetPlayerCount())) {
+            least_loaded = &game_session;
+        }
+    }
+    return least_loaded != nullptr ? *least_loaded : AddGameSession(id);
+}
+
+GameSession &Game::GetGameSessionInstance(const Map::Id& id, uint32_t instance) {
+    auto it = map_id_to_sessions_.find(id);
+    while (it == map_id_to_sessions_.end() || it->second.size() <= instance) {
+        AddGameSession(id);
+        it = map_id_to_sessions_.find(id);
+    }
+    return it->second[instance];
+}
+
+void Game::RestorePlayers(GameSession &game_session, std::vector<PlayerSnapshot>&& players) {
+    for (const auto& player : players) {
+        token_to_session_.emplace(player.token, &game_session);
+        player_id_ = std::max(player_id_, player.id + 1);
+    }
+    game_session.RestorePlayers(std::move(players));
+}
+
+std::pair<int, std::string> Game::AddPlayerToSession(GameSession &game_session, std::string &username) {
+    // Токен уникален среди всех экземпляров, а id игроков сквозные для всей игры
+    std::string token;
+    do {
+        token = token_generator_.GenerateToken();
+        token.replace(0, token_prefix_.size(), token_prefix_);
+    } while (token_to_session_.contains(token));
+
+    auto result = game_session.AddPlayer(player_id_++, username, std::move(token), randomize_player_spawn);
+    token_to_session_.emplace(result.second, &game_session);
+
+    ++last_event_;
+    if (listener_ != nullptr) {
+        const Player* player = game_session.FindPlayer(result.second);
+        listener_->OnPlayerJoined(last_event_, *game_session.GetMap()->GetId(), game_session.GetInstance(),
+                                  {result.second, player->GetId(), player->GetName(), player->GetDogState()});
+    }
+    return result;
+}
+
+void Game::MovePlayer(std::string_view token, std::string direction) {
+    GetGameSessionByToken(token).MovePlayerWithToken(token, direction);
+
+    ++last_event_;
+    if (listener_ != nullptr) {
+        listener_->OnPlayerMoved(last_event_, token, direction);
+    }
+}
+
+void Game::ReplayJoin(uint64_t seq, const std::string& map_id, uint32_t instance, PlayerSnapshot player) {
+    Map::Id id{map_id};
+    if (FindMap(id) == nullptr) {
+        throw std::invalid_argument("Log refers to unknown map "s + map_id);
+    }
+
+    std::vector<PlayerSnapshot> players;
+    players.push_back(std::move(player));
+    RestorePlayers(GetGameSessionInstance(id, instance), std::move(players));
+    last_event_ = seq;
+}
+
+void Game::ReplayMove(uint64_t seq, std::string_view token, std::string direction) {
+    // Игрок мог уйти раньше, чем при записи, если dogRetirementTime уменьшили между запусками
+    if (HaveGameSessionWithToken(token)) {
+        GetGameSessionByToken(token).MovePlayerWithToken(token, std::move(direction));
+    }
+    last_event_ = seq;
+}
+
+void Game::ReplayTick(uint64_t seq, int time_delta) {
+    UpdateSessions(time_delta, 0);
+    last_event_ = seq;
+}
+
+GameSnapshot Game::MakeSnapshot() const {
+    GameSnapshot snapshot;
+    snapshot.next_player_id = player_id_;
+    snapshot.last_event = last_event_;
+    snapshot.sessions.reserve(sessions_.size());
+
+    for (const GameSession* game_session : sessions_) {
+        auto& session = snapshot.sessions.emplace_back();
+        session.map_id = *game_session->GetMap()->GetId();
+        session.instance = game_session->GetInstance();
+        game_session->SnapshotPlayers(session.players);
+    }
+    return snapshot;
+}
+
+void Game::RestoreSnapshot(GameSnapshot&& snapshot) {
+    for (auto& session : snapshot.sessions) {
+        Map::Id id{session.map_id};
+        if (FindMap(id) == nullptr) {
+            throw std::invalid_argument("Snapshot refers to unknown map "s + session.map_id);
+        }
+        RestorePlayers(GetGameSessionInstance(id, session.instance), std::move(session.players));
+    }
+    player_id_ = std::max(player_id_, snapshot.next_player_id);
+    last_event_ = snapshot.last_event;
+}
+
+void Game::UpdateStates() {
+    static const metrics::Histogram tick_duration = metrics::Registry::Instance().AddHistogram(
+        "game_tick_duration_seconds"sv, "Time spent updating all game sessions in one tick"sv);
+
+    const auto start = std::chrono::steady_clock::now();
+    const uint64_t tick_id = tracing::Tracer::Instance().IsEnabled() ? tracing::Tracer::Instance().NextId() : 0;
+    tracing::Span tick_span{"game.tick", tick_id};
+    UpdateSessions(tickrate_, tick_id);
+
+    ++last_event_;
+    if (listener_ != nullptr) {
+        listener_->OnTick(last_event_, tickrate_);
+    }
+    tick_duration.Observe(std::chrono::steady_clock::now() - start);
+}
+
+void Game::UpdateSessions(int time_delta, uint64_t tick_id) {
+    // Экземпляры не зависят друг от друга, поэтому обновляются параллельно
+    static const metrics::Counter office_contacts = metrics::Registry::Instance().AddCounter(
+        "game_contacts_total"sv, "Dog proximity events found by the tick"sv, metrics::Label("type"sv, "office"sv));
+    static const metrics::Counter dog_contacts = metrics::Registry::Instance().AddCounter(
+        "game_contacts_total"sv, "Dog proximity events found by the tick"sv, metrics::Label("type"sv, "dog"sv));
+    static const metrics::Counter retired_players = metrics::Registry::Instance().AddCounter(
+        "game_players_retired_total"sv, "Players removed after dogRetirementTime without actions"sv);
+
+    auto update = [this, time_delta, tick_id](size_t i) {
+        GameSession& game_session = *sessions_[i];
+        // Копия id: на тике сессия может перейти на новую карту, а старая - освободиться
+        const std::string map_id = *game_session.GetMap()->GetId();
+        tracing::Span session_span{"game.session_update", tick_id, map_id};
+        game_session.UpdateState(time_delta);
+
+        const auto& contacts = game_session.GetContacts();
+        const auto dogs = std::count_if(contacts.begin(), contacts.end(), [](const ContactEvent& event) {
+            return event.type == collision::ContactType::DOG_DOG;
+        });
+        dog_contacts.Inc(static_cast<uint64_t>(dogs));
+        office_contacts.Inc(contacts.size() - static_cast<uint64_t>(dogs));
+    };
+
+    if (simulation_pool_) {
+        simulation_pool_->ParallelFor(sessions_.size(), update);
+    } else {
+        for (size_t i = 0; i < sessions_.size(); ++i) {
+            update(i);
+        }
+    }
+
+    // Индекс токенов общий для всех экземпляров, поэтому ушедшие игроки удаляются из него после обновления
+    size_t retired = 0;
+    for (const GameSession* game_session : sessions_) {
+        for (const auto& token : game_session->GetRetiredTokens()) {
+            if (auto it = token_to_session_.find(token); it != token_to_session_.end()) {
+                token_to_session_.erase(it);
+            }
+        }
+        retired += game_session->GetRetiredTokens().size();
+    }
+    if (retired != 0) {
+        retired_players.Inc(retired);
+        if (token_to_session_.size() * 4 < token_to_session_.bucket_count()) {
+            token_to_session_.rehash(0);
+        }
+    }
+}
+
+void Game::SetRetirementTime(std::chrono::milliseconds retirement_time) {
+    retirement_time_ = static_cast<uint64_t>(std::max<int64_t>(retirement_time.count(), 0));
+    for (GameSession* game_session : sessions_) {
+        game_session->SetRetirementTime(retirement_time_);
+    }
+}
+
+void Game::SetSimulationThreads(unsigned threads, util::WorkerPool::ThreadInit init) {
+    simulation_pool_.reset();
+    if (threads > 1) {
+        simulation_pool_ = std::make_unique<util::WorkerPool>(threads, std::move(init));
+    }
+}
+
 }  // namespace model
@@ -5,6 +5,8 @@
 
 #pragma once
 #include <string>
+#include <string_view>
+#include <stdexcept>
 #include <unordered_map>
 #include <vector>
 #include <sstream>
@@ -14,148 +16,374 @@
 #include <boost/property_tree/json_parser.hpp>
 #include <format>
 #include <memory>
+#include <memory_resource>
 #include <random>
 #include <optional>
+#include <cctype>
+#include <deque>
+#include <chrono>
 
 #include "http_server.h"
 #include "tagged.h"
 #include "map.h"
+#include "memory_stats.h"
 #include "player.h"
+#include "parallel.h"
+#include "spatial_hash.h"
+#include "collision.h"
+#include "timing_wheel.h"
 
 namespace model {
 
+// Хешер для поиска игрока по токену без создания std::string из string_view
+struct TokenHasher {
+    using is_transparent = void;
+
+    size_t operator()(std::string_view token) const {
+        return std::hash<std::string_view>{}(token);
+    }
+};
+
+// Токены хранятся в std::pmr::string, а ищутся по std::string и string_view
+struct TokenEqual {
+    using is_transparent = void;
+
+    bool operator()(std::string_view lhs, std::string_view rhs) const {
+        return lhs == rhs;
+    }
+};
+
+// Метка шарда в начале токена: два hex-символа с номером процесса. По ней маршрутизатор
+// (game_router) находит процесс, в котором живёт игрок
+constexpr size_t SHARD_TAG_SIZE = 2;
+constexpr unsigned MAX_SHARDS = 256;
+
+inline std::string MakeShardTag(unsigned shard_index) {
+    constexpr std::string_view digits = "0123456789abcdef";
+    return {digits[(shard_index >> 4) & 0xf], digits[shard_index & 0xf]};
+}
+
+inline std::optional<unsigned> ParseShardTag(std::string_view token) {
+    unsigned shard_index = 0;
+    if (token.size() < SHARD_TAG_SIZE) {
+        return std::nullopt;
+    }
+    for (char ch : token.substr(0, SHARD_TAG_SIZE)) {
+        const int digit = std::isdigit(static_cast<unsigned char>(ch)) ? ch - '0'
+            : (ch >= 'a' && ch <= 'f') ? ch - 'a' + 10 : -1;
+        if (digit < 0) {
+            return std::nullopt;
+        }
+        shard_index = shard_index * 16 + static_cast<unsigned>(digit);
+    }
+    return shard_index;
+}
+
+// Снимок игры: копия состояния всех сессий, которую можно сохранить на диск вне strand
+struct PlayerSnapshot {
+    std::string token;
+    int id = 0;
+    std::string name;
+    DogState dog;
+    uint64_t idle_time = 0;  // мс без действий
+};
+
+struct SessionSnapshot {
+    std::string map_id;
+    uint32_t instance = 0;
+    std::vector<PlayerSnapshot> players;
+};
+
+struct GameSnapshot {
+    int next_player_id = 0;
+    uint64_t last_event = 0;  // номер последнего изменения, вошедшего в снимок
+    std::vector<SessionSnapshot> sessions;
+};
+
+// Сближение за тик: пёс с офисом или два пса. time - доля тика, на которой они ближе всего
+struct ContactEvent {
+    collision::ContactType type;
+    int player_id = 0;
+    int other_player_id = -1;  // второй пёс для DOG_DOG
+    size_t office_index = 0;   // индекс в Map::GetOffices() для DOG_OFFICE
+    double time = 0.0;
+};
+
+// Список игроков для /api/v1/game/players, записываемый по частям, как MapJsonWriter.
+// Хранит копию id и имён: сессия меняется в strand игры, а ответ дописывается на потоке соединения
+class PlayerListJsonWriter {
+public:
+    struct Entry {
+        int id = 0;
+        std::string name;
+    };
+
+    explicit PlayerListJsonWriter(std::vector<Entry> players)
+        : players_{std::move(players)} {
+    }
+
+    // false - документ дописан до конца
+    bool Write(std::string& buffer, size_t limit);
+
+private:
+    std::vector<Entry> players_;
+    size_t index_ = 0;
+    bool started_ = false;
+    bool done_ = false;
+};
+
+// Получает все изменения состояния игры (для журнала упреждающей записи).
+// Вызывается внутри strand, seq - сквозной номер изменения
+class GameEventListener {
+public:
+    virtual ~GameEventListener() = default;
+
+    virtual void OnPlayerJoined(uint64_t seq, const std::string& map_id, uint32_t instance, const PlayerSnapshot& player) = 0;
+    virtual void OnPlayerMoved(uint64_t seq, std::string_view token, std::string_view direction) = 0;
+    virtual void OnTick(uint64_t seq, int time_delta) = 0;
+};
+
+// Экземпляр карты со своими игроками. Если на карте больше игроков, чем Map::GetMaxPlayers(),
+// у неё несколько экземпляров, обновляемых независимо
 class GameSession {
 public:
-    GameSession (const Map *map):
-        map_{map} {}
+    // Токены и игроки берут память у ресурса сессии, он - у memory::Subsystem::PLAYERS
+    using Token = std::pmr::string;
+    using Players = std::pmr::unordered_map<Token, Player, TokenHasher, TokenEqual>;
 
-    std::pair<int, std::string> AddPlayer(int id, std::string username, bool is_random) {
-        std::string token = token_generator_.GenerateToken();
+    GameSession (std::shared_ptr<const Map> map, uint32_t instance = 0):
+        map_{std::move(map)}, instance_{instance}, interest_grid_{map_->GetInterestRadius()} {}
 
+    // Сетка видимости хранит указатели на игроков этой сессии, контейнеры - на её ресурс памяти
+    GameSession(const GameSession&) = delete;
+    GameSession& operator=(const GameSession&) = delete;
+
+    // Токен выдаёт Game: он уникален среди всех экземпляров всех карт
+    std::pair<int, std::string> AddPlayer(int id, std::string username, std::string token, bool is_random) {
         std::pair<double, double> spawn_point = map_->GetDefaultPoint();
         if (is_random) {
             spawn_point = map_->GetRandomRoadPoint();
         }
         Player new_player(id, username, spawn_point);
-        token_to_player_.insert( {token, new_player} );
+        auto it = token_to_player_.emplace(token, new_player).first;
+        if (HasInterestGrid()) {
+            interest_grid_.Insert(&it->second, it->second.GetPosition());
+        }
+        StartIdleTimer(it->first, it->second, 0);
         return { new_player.GetId(), token };
     }
 
-    void MovePlayerWithToken(std::string token, std::string direction) {
-        Player &player = token_to_player_.at(token);
+    void MovePlayerWithToken(std::string_view token, std::string direction) {
+        auto it = token_to_player_.find(token);
+        if (it == token_to_player_.end()) {
+            throw std::out_of_range("Unknown player token");
+        }
 
-        player.MoveDog(direction, map_->GetDogSpeed());
+        it->second.MoveDog(direction, map_->GetDogSpeed());
+        ResetIdleTimer(it->second);
     }
 
-    bool IsTokenInSession(std::string token) const {
-        return (token_to_player_.count(token) != 0);
+    size_t GetPlayerCount() const {
+        return token_to_player_.size();
     }
 
-    std::string GetPlayerList() const {
-        pt::ptree data;
-
-        for (auto &[token, player]: token_to_player_) {
-            pt::ptree player_ptree;
+    void SnapshotPlayers(std::vector<PlayerSnapshot>& players) const {
+        players.reserve(token_to_player_.size());
+        for (const auto& [token, player] : token_to_player_) {
+            players.push_back({std::string(token), player.GetId(), player.GetName(), player.GetDogState(), GetIdleTime(player)});
+        }
+    }
 
-            player_ptree.put("name", player.GetName());
-            data.push_back(std::make_pair(std::to_string(player.GetId()), player_ptree));
+    void RestorePlayers(std::vector<PlayerSnapshot>&& players) {
+        token_to_player_.reserve(token_to_player_.size() + players.size());
+        for (auto& player : players) {
+            auto it = token_to_player_.emplace(std::move(player.token), Player(player.id, std::move(player.name), player.dog)).first;
+            if (HasInterestGrid()) {
+                interest_grid_.Insert(&it->second, it->second.GetPosition());
+            }
+            StartIdleTimer(it->first, it->second, player.idle_time);
         }
+    }
 
-        std::ostringstream oss;
-        bpt::write_json(oss, data);
-        return oss.str();
+    bool IsTokenInSession(std::string_view token) const {
+        return token_to_player_.contains(token);
     }
 
-    std::string GetPlayerData() {
-        std::string data = "{\"players\": {\n";
+    const Player* FindPlayer(std::string_view token) const {
+        auto it = token_to_player_.find(token);
+        return it != token_to_player_.end() ? &it->second : nullptr;
+    }
+
+    const Map* GetMap() const {
+        return map_.get();
+    }
+
+    uint32_t GetInstance() const {
+        return instance_;
+    }
+
+    // Память игроков этой сессии
+    const memory::CountingResource& GetMemory() const {
+        return memory_;
+    }
 
-        int i = 0;
-        for (const auto &[token, player]: token_to_player_) {
+    // Карта после перезагрузки конфига. Сессия переходит на неё на границе тика
+    void SetPendingMap(std::shared_ptr<const Map> map) {
+        if (map == map_) {
+            pending_map_.reset();
+        } else {
+            pending_map_ = std::move(map);
+        }
+    }
+
+    std::string GetPlayerList() const;
+
+    // Писатель списка игроков для потоковой выдачи ответа
+    PlayerListJsonWriter MakePlayerListWriter() const;
+
+    // Псы сессии для /state. Если у карты задан радиус видимости, а token - игрок сессии,
+    // только псы в этом радиусе от его пса и он сам
+    std::string GetPlayerData(std::string_view token = {}) const {
+        std::string data = "{\"players\": {\n";
+        bool first = true;
+        auto append = [&data, &first](const Player& player) {
+            if (!first) {
+                data += ",\n";
+            }
+            first = false;
             data += "\t\"" + std::to_string(player.GetId()) + "\": {" + player.GetDogCoords() + "}";
-            ++i;
-            (i == token_to_player_.size()) ? data += "\n" : data += ",\n";
+        };
+
+        const Player* self = HasInterestGrid() ? FindPlayer(token) : nullptr;
+        if (self != nullptr) {
+            const double radius = interest_grid_.GetCellSize();
+            const DogPoint center = self->GetPosition();
+            append(*self);
+            interest_grid_.ForEachNear(center, radius, [&](const Player* player) {
+                if (player != self && FindDistance(center, player->GetPosition()) <= radius) {
+                    append(*player);
+                }
+            });
+        } else {
+            for (const auto &[player_token, player]: token_to_player_) {
+                append(player);
+            }
         }
-        data += "}\n}";
+
+        data += first ? "}\n}" : "\n}\n}";
         return data;
     }
 
-    void UpdateState(int tick_rate) {
-        for (auto &[token, player]: token_to_player_) {
-            player.UpdateState(tick_rate, map_);
-        }
+    // Игрок без действий дольше retirement_time мс уходит из сессии на тике. 0 - никогда.
+    // При смене срока отсчёт простоя начинается заново
+    void SetRetirementTime(uint64_t retirement_time);
+
+    // Убирает простаивающих игроков (GetRetiredTokens), двигает псов и находит их сближения за тик (GetContacts)
+    void UpdateState(int tick_rate);
+
+    // Токены игроков, ушедших на последнем тике
+    const std::vector<std::string>& GetRetiredTokens() const {
+        return retired_;
+    }
+
+    // Контакты последнего тика, упорядоченные по времени
+    const std::vector<ContactEvent>& GetContacts() const {
+        return contacts_;
     }
 
 private:
-    class TokenGenerator {
-    public:
-        std::string GenerateToken() {
-            std::stringstream stream;
-    
-            std::uniform_int_distribution<std::mt19937_64::result_type> dist;
-            stream << std::hex << dist(generator1_) << dist(generator2_);
-            std::string token = stream.str();
-            
-            while (token.length() != 32) {
-                token += "0";
-            }
-            return token;
-        }
+    void ApplyPendingMap();
 
-    private:
-        // Чтобы сгенерировать токен, получите из generator1_ и generator2_
-        // два 64-разрядных числа и, переведя их в hex-строки, склейте в одну.
-        std::mt19937 generator1_{std::random_device{}()};
-        std::mt19937 generator2_{std::random_device{}()};
-    };
+    bool HasInterestGrid() const {
+        return map_->GetInterestRadius() > 0.0;
+    }
 
-    std::unordered_map<std::string, Player> token_to_player_;
-    const Map* map_;
-    TokenGenerator token_generator_;
+    // Ячейка сетки равна радиусу видимости: соседи пса ищутся в квадрате 3x3 ячейки
+    void RebuildInterestGrid();
+
+    // Таймер простоя хранит указатель на ключ token_to_player_: узлы unordered_map не перемещаются
+    void StartIdleTimer(const Token& token, Player& player, uint64_t idle_time);
+    void ResetIdleTimer(Player& player);
+    uint64_t GetIdleTime(const Player& player) const;
+    void RetireIdlePlayers(int tick_rate);
+
+    memory::CountingResource memory_{memory::GetResource(memory::Subsystem::PLAYERS)};
+    Players token_to_player_{&memory_};
+    std::shared_ptr<const Map> map_;
+    std::shared_ptr<const Map> pending_map_;
+    uint32_t instance_ = 0;
+    SpatialHash<Player> interest_grid_;
+
+    // Буферы поиска контактов, переиспользуются между тиками
+    collision::Broadphase broadphase_;
+    std::vector<collision::Mover> movers_;
+    std::vector<const Player*> mover_players_;
+    std::vector<collision::Item> offices_;
+    std::vector<ContactEvent> contacts_;
+
+    // Время сессии в колесе - сумма тиков в мс, поэтому повтор журнала убирает тех же игроков
+    util::TimingWheel<const Token*> idle_timers_;
+    uint64_t retirement_time_ = 0;
+    std::vector<const Token*> expired_;
+    std::vector<std::string> retired_;
 };
 
 class Game {
 public:
-    using Maps = std::vector<Map>;
+    // Карты неизменяемы: перезагрузка конфига подменяет указатели, а сессии и запросы,
+    // взявшие старую карту, дорабатывают с ней
+    using Maps = std::vector<std::shared_ptr<const Map>>;
+    // Экземпляры одной карты. deque не перемещает элементы при добавлении,
+    // поэтому ссылки на сессии остаются действительными
+    using Instances = std::pmr::deque<GameSession>;
+    using Sessions = std::pmr::vector<GameSession*>;
+
+    Game() = default;
+    // Индексы хранят указатели на сессии: при перемещении они остаются верными, при копировании - нет
+    Game(const Game&) = delete;
+    Game& operator=(const Game&) = delete;
+    Game(Game&&) = default;
+    Game& operator=(Game&&) = default;
 
     void AddMap(Map map);
+    // Новый набор карт после перезагрузки конфига. Вызывается внутри strand.
+    // Карты, которых нет в новом наборе, остаются, пока на них есть сессия
+    void ReplaceMaps(Maps maps);
 
-    GameSession &GetGameSession(const Map::Id& id) {
-        if (map_id_to_session_.count(id) == 0) {
-            AddGameSession(id);
-        }
+    // Экземпляр карты для нового игрока: наименее заполненный из тех, где есть место.
+    // Если заполнены все, создаётся новый
+    GameSession &GetGameSession(const Map::Id& id);
 
-        return map_id_to_session_.at(id);
-    }
+    // Экземпляр с номером instance, недостающие экземпляры создаются (восстановление состояния)
+    GameSession &GetGameSessionInstance(const Map::Id& id, uint32_t instance);
 
-    bool HaveGameSessionWithToken(const std::string &token) {
-        for (auto &[id, game_session]: map_id_to_session_) {
-            if (game_session.IsTokenInSession(token)) {
-                return true;
-            }
-        }
-        return false;
+    bool HaveGameSessionWithToken(std::string_view token) const {
+        return token_to_session_.contains(token);
     }
 
-    GameSession &GetGameSessionByToken(const std::string &token) {
-        for (auto &[id, game_session]: map_id_to_session_) {
-            if (game_session.IsTokenInSession(token)) {
-                return GetGameSession(id);
-            }
+    GameSession &GetGameSessionByToken(std::string_view token) {
+        auto it = token_to_session_.find(token);
+        if (it == token_to_session_.end()) {
+            throw std::out_of_range("Unknown player token");
         }
-        return GetGameSession(Map::Id("1"));
+        return *it->second;
     }
 
-    std::pair<int, std::string> AddPlayerToSession(GameSession &game_session, std::string &username) {
-        return game_session.AddPlayer(player_id_++, username, randomize_player_spawn);
-    }
+    std::pair<int, std::string> AddPlayerToSession(GameSession &game_session, std::string &username);
+    void MovePlayer(std::string_view token, std::string direction);
 
     const Maps& GetMaps() const noexcept {
         return maps_;
     }
 
     const Map* FindMap(const Map::Id& id) const noexcept {
+        return FindMapPtr(id).get();
+    }
+
+    // Владеющий указатель: карта переживёт перезагрузку конфига, пока он жив
+    std::shared_ptr<const Map> FindMapPtr(const Map::Id& id) const noexcept {
         if (auto it = map_id_to_index_.find(id); it != map_id_to_index_.end()) {
-            return &maps_.at(it->second);
+            return maps_[it->second];
         }
         return nullptr;
     }
@@ -168,31 +396,104 @@ public:
         tickrate_ = rate;
     }
 
-    void UpdateStates() {
-        for (auto &[id, game_session]: map_id_to_session_) {
-            game_session.UpdateState(tickrate_);
+    // Все экземпляры всех карт в порядке создания
+    const Sessions& GetSessions() const noexcept {
+        return sessions_;
+    }
+
+    const Instances* FindGameSessions(const Map::Id& id) const {
+        if (auto it = map_id_to_sessions_.find(id); it != map_id_to_sessions_.end()) {
+            return &it->second;
         }
+        return nullptr;
+    }
+
+    void UpdateStates();
+
+    // Срок простоя, после которого игрок уходит из игры (dogRetirementTime). 0 - никогда
+    void SetRetirementTime(std::chrono::milliseconds retirement_time);
+    std::chrono::milliseconds GetRetirementTime() const {
+        return std::chrono::milliseconds{retirement_time_};
     }
 
+    // Экземпляры карт обновляются на тике параллельно на threads потоках (вместе с потоком тика).
+    // init вызывается в начале каждого потока симуляции, кроме потока тика
+    void SetSimulationThreads(unsigned threads, util::WorkerPool::ThreadInit init = {});
+
+    // Вызываются внутри strand игры
+    GameSnapshot MakeSnapshot() const;
+    void RestoreSnapshot(GameSnapshot&& snapshot);
+
+    void SetEventListener(GameEventListener* listener) {
+        listener_ = listener;
+    }
+
+    uint64_t GetLastEvent() const {
+        return last_event_;
+    }
+
+    // Повтор изменений из журнала при восстановлении. Слушатель при этом не вызывается
+    void ReplayJoin(uint64_t seq, const std::string& map_id, uint32_t instance, PlayerSnapshot player);
+    void ReplayMove(uint64_t seq, std::string_view token, std::string direction);
+    void ReplayTick(uint64_t seq, int time_delta);
+
     void SetPlayerSpawn(bool type) {
         randomize_player_spawn = type;
     }
 
+    // Начало всех новых токенов (метка шарда). Задаётся до первого входа игрока
+    void SetTokenPrefix(std::string prefix) {
+        token_prefix_ = std::move(prefix);
+    }
+
 private:
     using MapIdHasher = util::TaggedHasher<Map::Id>;
     using MapIdToIndex = std::unordered_map<Map::Id, size_t, MapIdHasher>;
 
-    void AddGameSession(const Map::Id& id) {
-        GameSession session(FindMap(id));
-        map_id_to_session_.insert(std::make_pair(id, session));
-    }
+    class TokenGenerator {
+    public:
+        std::string GenerateToken() {
+            std::stringstream stream;
+    
+            std::uniform_int_distribution<std::mt19937_64::result_type> dist;
+            stream << std::hex << dist(generator1_) << dist(generator2_);
+            std::string token = stream.str();
+            
+            while (token.length() != 32) {
+                token += "0";
+            }
+            return token;
+        }
+
+    private:
+        // Чтобы сгенерировать токен, получите из generator1_ и generator2_
+        // два 64-разрядных числа и, переведя их в hex-строки, склейте в одну.
+        std::mt19937 generator1_{std::random_device{}()};
+        std::mt19937 generator2_{std::random_device{}()};
+    };
 
-    std::vector<Map> maps_;
+    GameSession &AddGameSession(const Map::Id& id);
+    void RestorePlayers(GameSession &game_session, std::vector<PlayerSnapshot>&& players);
+    void UpdateSessions(int time_delta, uint64_t tick_id);
+
+    Maps maps_;
     MapIdToIndex map_id_to_index_;
-    std::unordered_map<Map::Id, GameSession, MapIdHasher> map_id_to_session_;
+    // Сессии и их индексы учитываются в memory::Subsystem::SESSIONS, индекс токенов - в TOKENS
+    std::pmr::unordered_map<Map::Id, Instances, MapIdHasher> map_id_to_sessions_{
+        memory::GetResource(memory::Subsystem::SESSIONS)};
+    // Все экземпляры всех карт подряд - для параллельного обновления на тике
+    Sessions sessions_{memory::GetResource(memory::Subsystem::SESSIONS)};
+    std::pmr::unordered_map<GameSession::Token, GameSession*, TokenHasher, TokenEqual> token_to_session_{
+        memory::GetResource(memory::Subsystem::TOKENS)};
+    TokenGenerator token_generator_;
+    std::unique_ptr<util::WorkerPool> simulation_pool_;
     bool randomize_player_spawn = false;
+    std::string token_prefix_;
     int tickrate_ = 0;
+    uint64_t retirement_time_ = 0;
     int player_id_ = 0;
+    uint64_t last_event_ = 0;
+    GameEventListener* listener_ = nullptr;
 };
 
 }  // namespace model
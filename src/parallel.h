@@ -0,0 +1,190 @@
+#ifndef __PARALLEL__
+#define __PARALLEL__
+
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace util {
+
+namespace detail {
+
+// Раздаёт индексы [0, count) вызвавшим его потокам и запоминает первое исключение
+template <typename Fn>
+class IndexedJob {
+public:
+    IndexedJob(size_t count, Fn& fn)
+        : count_{count}, fn_{fn} {
+    }
+
+    void operator()() {
+        for (size_t i = next_.fetch_add(1); i < count_; i = next_.fetch_add(1)) {
+            try {
+                fn_(i);
+            } catch (...) {
+                std::lock_guard lock{error_mutex_};
+                if (!error_) {
+                    error_ = std::current_exception();
+                }
+                next_.store(count_);
+            }
+        }
+    }
+
+    void RethrowIfFailed() {
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+    }
+
+private:
+    size_t count_;
+    Fn& fn_;
+    std::atomic<size_t> next_{0};
+    std::mutex error_mutex_;
+    std::exception_ptr error_;
+};
+
+} // namespace detail
+
+// Вызывает fn(i) для всех i из [0, count) на нескольких потоках (включая вызывающий).
+// Первое брошенное исключение пробрасывается после завершения всех потоков
+template <typename Fn>
+void ParallelFor(size_t count, Fn&& fn, unsigned threads = std::thread::hardware_concurrency()) {
+    threads = static_cast<unsigned>(std::min<size_t>(std::max(threads, 1u), count));
+    if (threads <= 1) {
+        for (size_t i = 0; i < count; ++i) {
+            fn(i);
+        }
+        return;
+    }
+
+    detail::IndexedJob job{count, fn};
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (unsigned i = 1; i < threads; ++i) {
+        workers.emplace_back(std::ref(job));
+    }
+    job();
+    for (auto& thread : workers) {
+        thread.join();
+    }
+    job.RethrowIfFailed();
+}
+
+// Постоянные потоки для ParallelFor, который вызывается часто (например, каждый тик):
+// потоки не создаются заново, а ждут следующего задания. ParallelFor нельзя вызывать
+// из нескольких потоков одновременно
+class WorkerPool {
+public:
+    // Вызывается в начале каждого потока пула с его номером (1..threads-1), например для привязки к ядру
+    using ThreadInit = std::function<void(unsigned index)>;
+
+    // threads - число потоков вместе с вызывающим ParallelFor
+    explicit WorkerPool(unsigned threads, ThreadInit init = {}) {
+        for (unsigned i = 1; i < threads; ++i) {
+            workers_.emplace_back([this, i, init] {
+                if (init) {
+                    init(i);
+                }
+                Work();
+            });
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard lock{mutex_};
+            stopping_ = true;
+        }
+        start_cv_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    unsigned GetThreadCount() const {
+        return static_cast<unsigned>(workers_.size()) + 1;
+    }
+
+    template <typename Fn>
+    void ParallelFor(size_t count, Fn&& fn) {
+        if (workers_.empty() || count <= 1) {
+            for (size_t i = 0; i < count; ++i) {
+                fn(i);
+            }
+            return;
+        }
+
+        detail::IndexedJob job{count, fn};
+        std::function<void()> task = std::ref(job);
+        {
+            std::lock_guard lock{mutex_};
+            task_ = &task;
+            busy_ = workers_.size();
+            ++generation_;
+        }
+        start_cv_.notify_all();
+        job();
+
+        std::unique_lock lock{mutex_};
+        done_cv_.wait(lock, [this] {
+            return busy_ == 0;
+        });
+        task_ = nullptr;
+        lock.unlock();
+        job.RethrowIfFailed();
+    }
+
+private:
+    void Work() {
+        uint64_t seen = 0;
+        while (true) {
+            std::function<void()>* task = nullptr;
+            {
+                std::unique_lock lock{mutex_};
+                start_cv_.wait(lock, [this, seen] {
+                    return stopping_ || generation_ != seen;
+                });
+                if (stopping_) {
+                    return;
+                }
+                seen = generation_;
+                task = task_;
+            }
+
+            (*task)();
+
+            std::lock_guard lock{mutex_};
+            if (--busy_ == 0) {
+                done_cv_.notify_one();
+            }
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable start_cv_;
+    std::condition_variable done_cv_;
+    std::function<void()>* task_ = nullptr;
+    size_t busy_ = 0;
+    uint64_t generation_ = 0;
+    bool stopping_ = false;
+    std::vector<std::thread> workers_;
+};
+
+} // namespace util
+
+#endif
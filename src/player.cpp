@@ -38,6 +38,10 @@ DogSpeed Dog::GetCurrentSpeed() const {
     return speed_;
 }
 
+DogState Dog::GetState() const {
+    return {coords_.GetCoords(), speed_, coords_.GetDirectionValue()};
+}
+
 void Dog::MoveDog(Direction new_direction, double speed) {
     if (new_direction != Direction::NONE) {
         coords_.SetDirection(new_direction);
@@ -79,6 +83,22 @@ std::string Player::GetDogCoords() const {
     return dog_.GetDogData();
 }
 
+DogState Player::GetDogState() const {
+    return dog_.GetState();
+}
+
+DogPoint Player::GetPosition() const {
+    return dog_.GetCurrentPoint();
+}
+
+uint32_t Player::GetIdleTimer() const {
+    return idle_timer_;
+}
+
+void Player::SetIdleTimer(uint32_t timer) {
+    idle_timer_ = timer;
+}
+
 void Player::MoveDog(std::string new_direction, double speed) {
     dog_.MoveDog(new_direction, speed);
 }
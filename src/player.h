@@ -16,6 +16,8 @@
 #include <memory>
 #include <random>
 #include <optional>
+#include <cstdint>
+#include <limits>
 
 #include "map.h"
 
@@ -50,11 +52,21 @@ struct DogSpeed {
     double y = 0.0f;
 };
 
+// Полное состояние пса: используется для снимков игры
+struct DogState {
+    DogPoint position;
+    DogSpeed speed;
+    Direction direction = Direction::NORTH;
+};
+
 class DogCoord {
 public:
     DogCoord(double x, double y):
         point_({x, y}) {}
 
+    DogCoord(DogPoint point, Direction direction):
+        point_(point), curent_direction_(direction) {}
+
     void SetCoords(double x, double y) {
         point_ = { x, y };
     }
@@ -71,6 +83,10 @@ public:
         return DirToString.at(curent_direction_);
     }
 
+    Direction GetDirectionValue() const {
+        return curent_direction_;
+    }
+
 private:
     DogPoint point_;
     Direction curent_direction_ = Direction::NORTH;
@@ -81,6 +97,9 @@ public:
     Dog(double x, double y):
         coords_(model::DogCoord(x, y)) {}
 
+    explicit Dog(const DogState& state):
+        coords_(state.position, state.direction), speed_(state.speed) {}
+
     std::string GetDogData() const;
     void MoveDog(std::string new_direction, double speed);
     bool IsOnMove();
@@ -88,6 +107,7 @@ public:
     void SetSpeed(double x, double y);
     DogPoint GetCurrentPoint() const;
     DogSpeed GetCurrentSpeed() const;
+    DogState GetState() const;
 
 private:
     DogCoord coords_;
@@ -101,16 +121,26 @@ public:
     Player(int id, std::string uname, std::pair<double, double> coords):
         id_(id), username_(uname), dog_(coords.first, coords.second) {}
 
+    Player(int id, std::string uname, const DogState& dog):
+        id_(id), username_(std::move(uname)), dog_(dog) {}
+
     std::string GetName() const;
     int GetId() const;
     std::string GetDogCoords() const;
+    DogState GetDogState() const;
+    DogPoint GetPosition() const;
     void MoveDog(std::string new_direction, double speed);
     void UpdateState(int tick_rate, const Map* map);
 
+    // Таймер простоя в колесе таймеров сессии, UINT32_MAX - таймера нет
+    uint32_t GetIdleTimer() const;
+    void SetIdleTimer(uint32_t timer);
+
 private:
     int id_; 
     std::string username_;
     Dog dog_;
+    uint32_t idle_timer_ = std::numeric_limits<uint32_t>::max();
 };
 
 } // namespace model
@@ -0,0 +1,114 @@
+#include "rate_limiter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace http_handler {
+
+// ------------------------------ TokenBucket ------------------------------
+double TokenBucket::TryTake(const TokenBucketConfig& config, Clock::time_point now) {
+    const double elapsed = std::chrono::duration<double>(now - last_refill_).count();
+    tokens_ = std::min(config.burst, tokens_ + elapsed * config.rate);
+    last_refill_ = now;
+
+    if (tokens_ >= 1.0) {
+        tokens_ -= 1.0;
+        return 0.0;
+    }
+    return (1.0 - tokens_) / config.rate;
+}
+
+bool TokenBucket::IsIdle(const TokenBucketConfig& config, Clock::time_point now) const {
+    const double elapsed = std::chrono::duration<double>(now - last_refill_).count();
+    return tokens_ + elapsed * config.rate >= config.burst;
+}
+
+// ------------------------------ RateLimiter ------------------------------
+RateLimiter::RateLimiter(RateLimitConfig config)
+    : config_{std::move(config)}
+    , token_buckets_{config_.per_token}
+    , address_buckets_{config_.per_address} {
+    const auto now = TokenBucket::Clock::now();
+
+    for (const auto& limit : config_.per_endpoint) {
+        endpoint_buckets_.emplace_back(new EndpointBucket{limit, {}, TokenBucket{limit.bucket, now}});
+    }
+
+    // Самый длинный префикс должен проверяться первым
+    std::sort(endpoint_buckets_.begin(), endpoint_buckets_.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs->limit.prefix.size() > rhs->limit.prefix.size();
+    });
+}
+
+RateLimiter::Verdict RateLimiter::Check(std::string_view auth_token, const net::ip::address& address, std::string_view target) {
+    if (!IsEnabled()) {
+        return {};
+    }
+    const auto now = TokenBucket::Clock::now();
+
+    if (config_.per_address.IsEnabled()) {
+        if (double wait = address_buckets_.TryTake(address, now); wait > 0.0) {
+            return Limit(Scope::ADDRESS, wait);
+        }
+    }
+
+    if (config_.per_token.IsEnabled() && !auth_token.empty()) {
+        if (double wait = token_buckets_.TryTake(auth_token, now); wait > 0.0) {
+            return Limit(Scope::TOKEN, wait);
+        }
+    }
+
+    if (EndpointBucket* endpoint = FindEndpoint(target); endpoint != nullptr) {
+        std::lock_guard lock{endpoint->mutex};
+        if (double wait = endpoint->bucket.TryTake(endpoint->limit.bucket, now); wait > 0.0) {
+            return Limit(Scope::ENDPOINT, wait);
+        }
+    }
+
+    allowed_.fetch_add(1, std::memory_order_relaxed);
+    return {};
+}
+
+RateLimiter::Verdict RateLimiter::Limit(Scope scope, double wait_seconds) {
+    switch (scope) {
+    case Scope::ADDRESS:
+        limited_by_address_.fetch_add(1, std::memory_order_relaxed);
+        break;
+    case Scope::TOKEN:
+        limited_by_token_.fetch_add(1, std::memory_order_relaxed);
+        break;
+    case Scope::ENDPOINT:
+        limited_by_endpoint_.fetch_add(1, std::memory_order_relaxed);
+        break;
+    default:
+        break;
+    }
+
+    // Retry-After передаётся в целых секундах, округляем вверх
+    auto retry_after = std::chrono::seconds(static_cast<int64_t>(std::ceil(wait_seconds)));
+    return {scope, std::max(retry_after, std::chrono::seconds{1})};
+}
+
+RateLimiter::EndpointBucket* RateLimiter::FindEndpoint(std::string_view target) {
+    for (auto& endpoint : endpoint_buckets_) {
+        if (target.starts_with(endpoint->limit.prefix)) {
+            return endpoint.get();
+        }
+    }
+    return nullptr;
+}
+
+std::string RateLimiter::PrintStats() const {
+    std::ostringstream oss;
+
+    oss << "{\"allowed\":" << allowed_.load(std::memory_order_relaxed)
+        << ",\"limitedByAddress\":" << limited_by_address_.load(std::memory_order_relaxed)
+        << ",\"limitedByToken\":" << limited_by_token_.load(std::memory_order_relaxed)
+        << ",\"limitedByEndpoint\":" << limited_by_endpoint_.load(std::memory_order_relaxed)
+        << ",\"trackedAddresses\":" << address_buckets_.Size()
+        << ",\"trackedTokens\":" << token_buckets_.Size() << "}";
+    return oss.str();
+}
+
+} // namespace http_handler
@@ -0,0 +1,196 @@
+#ifndef __RATE_LIMITER__
+#define __RATE_LIMITER__
+
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#pragma once
+#include <boost/asio/ip/address.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace http_handler {
+
+namespace net = boost::asio;
+
+// Параметры token bucket: rate - сколько запросов в секунду пополняется, burst - ёмкость корзины.
+// rate == 0 означает, что ограничение выключено
+struct TokenBucketConfig {
+    double rate = 0.0;
+    double burst = 0.0;
+
+    bool IsEnabled() const {
+        return rate > 0.0;
+    }
+};
+
+struct EndpointLimit {
+    std::string prefix;
+    TokenBucketConfig bucket;
+};
+
+struct RateLimitConfig {
+    TokenBucketConfig per_token;
+    TokenBucketConfig per_address;
+    std::vector<EndpointLimit> per_endpoint;
+
+    bool IsEnabled() const {
+        return per_token.IsEnabled() || per_address.IsEnabled() || !per_endpoint.empty();
+    }
+};
+
+class TokenBucket {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TokenBucket(const TokenBucketConfig& config, Clock::time_point now)
+        : tokens_{config.burst}, last_refill_{now} {}
+
+    // Забирает один токен. Возвращает 0, если запрос разрешён,
+    // иначе - сколько секунд нужно подождать до появления токена
+    double TryTake(const TokenBucketConfig& config, Clock::time_point now);
+
+    // Корзина полностью восстановилась - клиент давно не появлялся
+    bool IsIdle(const TokenBucketConfig& config, Clock::time_point now) const;
+
+private:
+    double tokens_;
+    Clock::time_point last_refill_;
+};
+
+// Набор корзин по ключу (токен или адрес клиента).
+// Ключи разнесены по шардам, чтобы потоки ввода-вывода не конкурировали за один мьютекс
+template <typename Key, typename Hasher = std::hash<Key>, typename Equal = std::equal_to<>>
+class KeyedBuckets {
+public:
+    explicit KeyedBuckets(TokenBucketConfig config)
+        : config_{config} {}
+
+    template <typename LookupKey>
+    double TryTake(const LookupKey& key, TokenBucket::Clock::time_point now) {
+        const size_t hash = Hasher{}(key);
+        Shard& shard = shards_[hash % SHARD_COUNT];
+
+        std::lock_guard lock{shard.mutex};
+        auto it = shard.buckets.find(key);
+        if (it == shard.buckets.end()) {
+            if (shard.buckets.size() >= MAX_KEYS_PER_SHARD) {
+                PruneIdle(shard, now);
+            }
+            it = shard.buckets.emplace(Key(key), TokenBucket{config_, now}).first;
+        }
+        return it->second.TryTake(config_, now);
+    }
+
+    size_t Size() const {
+        size_t size = 0;
+        for (const auto& shard : shards_) {
+            std::lock_guard lock{shard.mutex};
+            size += shard.buckets.size();
+        }
+        return size;
+    }
+
+private:
+    static constexpr size_t SHARD_COUNT = 16;
+    static constexpr size_t MAX_KEYS_PER_SHARD = 4096;
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<Key, TokenBucket, Hasher, Equal> buckets;
+    };
+
+    // Полные корзины ничего не ограничивают, их можно забыть без потери состояния
+    void PruneIdle(Shard& shard, TokenBucket::Clock::time_point now) {
+        std::erase_if(shard.buckets, [this, now](const auto& item) {
+            return item.second.IsIdle(config_, now);
+        });
+    }
+
+    TokenBucketConfig config_;
+    std::array<Shard, SHARD_COUNT> shards_;
+};
+
+// Ограничитель частоты API-запросов. Вызывается на потоке ввода-вывода до того,
+// как запрос попадёт в strand игры
+class RateLimiter {
+public:
+    enum class Scope {
+        NONE,
+        ADDRESS,
+        TOKEN,
+        ENDPOINT
+    };
+
+    struct Verdict {
+        Scope limited_by = Scope::NONE;
+        std::chrono::seconds retry_after{0};
+
+        bool IsAllowed() const {
+            return limited_by == Scope::NONE;
+        }
+    };
+
+    explicit RateLimiter(RateLimitConfig config);
+
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter& operator=(const RateLimiter&) = delete;
+
+    bool IsEnabled() const {
+        return config_.IsEnabled();
+    }
+
+    Verdict Check(std::string_view auth_token, const net::ip::address& address, std::string_view target);
+
+    // Счётчики в виде JSON для /admin/rate_limits
+    std::string PrintStats() const;
+
+private:
+    struct StringHasher {
+        using is_transparent = void;
+
+        size_t operator()(std::string_view str) const {
+            return std::hash<std::string_view>{}(str);
+        }
+    };
+
+    struct AddressHasher {
+        size_t operator()(const net::ip::address& address) const {
+            if (address.is_v4()) {
+                return std::hash<uint32_t>{}(address.to_v4().to_uint());
+            }
+            const auto bytes = address.to_v6().to_bytes();
+            return std::hash<std::string_view>{}({reinterpret_cast<const char*>(bytes.data()), bytes.size()});
+        }
+    };
+
+    struct EndpointBucket {
+        EndpointLimit limit;
+        std::mutex mutex;
+        TokenBucket bucket;
+    };
+
+    Verdict Limit(Scope scope, double wait_seconds);
+    EndpointBucket* FindEndpoint(std::string_view target);
+
+    RateLimitConfig config_;
+    KeyedBuckets<std::string, StringHasher> token_buckets_;
+    KeyedBuckets<net::ip::address, AddressHasher> address_buckets_;
+    std::vector<std::unique_ptr<EndpointBucket>> endpoint_buckets_;
+
+    std::atomic<uint64_t> allowed_{0};
+    std::atomic<uint64_t> limited_by_address_{0};
+    std::atomic<uint64_t> limited_by_token_{0};
+    std::atomic<uint64_t> limited_by_endpoint_{0};
+};
+
+} // namespace http_handler
+
+#endif
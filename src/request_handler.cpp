@@ -34,10 +34,112 @@ std::string PrintErrorResponce(std::string code, std::string messege) {
     return model::PtreeToString(data);
 }
 
+// Из заголовка "Authorization: Bearer <token>" достаёт сам токен. Если токена нет - пустая строка
+std::string_view ExtractAuthToken(std::string_view authorization) {
+    std::string_view token = authorization.substr(authorization.find_last_of(' ') + 1);
+    if (token == "Bearer"sv) {
+        return {};
+    }
+    return token;
+}
+
 fs::path StringToPath(std::string str) {
     return fs::path(str);
 }
 
+const metrics::Gauge& StrandQueueDepth() {
+    static const metrics::Gauge gauge = metrics::Registry::Instance().AddGauge(
+        "game_strand_queue_depth"sv, "API requests waiting for the game strand"sv);
+    return gauge;
+}
+
+std::string ServerTiming(steady_clock::duration queue, steady_clock::duration handler) {
+    using Millis = std::chrono::duration<double, std::milli>;
+
+    std::ostringstream oss;
+    oss.precision(3);
+    oss << std::fixed << "queue;dur=" << Millis(queue).count() << ", app;dur=" << Millis(handler).count();
+    return oss.str();
+}
+
+RequestHandler::RequestHandler(net::strand<net::io_context::executor_type> &strand, model::Game& game, std::string static_folder,
+                               RateLimitConfig rate_limits)
+    : strand_{strand}, game_{game}, static_path_{StringToPath(static_folder)}, static_folder_str_(static_folder),
+      rate_limiter_{std::move(rate_limits)} {
+    auto& registry = metrics::Registry::Instance();
+
+    static_requests_ = registry.AddCounter("http_static_requests_total"sv, "Requests for static files"sv);
+    AddMapGauges();
+}
+
+void RequestHandler::AddMapGauges() {
+    auto& registry = metrics::Registry::Instance();
+
+    for (const auto& map : game_.GetMaps()) {
+        if (map_gauges_.contains(map->GetId())) {
+            continue;
+        }
+        const std::string label = metrics::Label("map"sv, *map->GetId());
+        map_gauges_.emplace(map->GetId(), MapGauges{
+            registry.AddGauge("game_sessions"sv, "Game session instances by map"sv, label),
+            registry.AddGauge("game_players"sv, "Players by map"sv, label)});
+    }
+}
+
+std::string RequestHandler::ScrapeMetrics() {
+    // После перезагрузки конфига могли появиться новые карты
+    AddMapGauges();
+    for (const auto& [id, map] : map_gauges_) {
+        const model::Game::Instances* instances = game_.FindGameSessions(id);
+        size_t players = 0;
+        if (instances != nullptr) {
+            for (const auto& session : *instances) {
+                players += session.GetPlayerCount();
+            }
+        }
+        map.sessions.Set(instances != nullptr ? static_cast<int64_t>(instances->size()) : 0);
+        map.players.Set(static_cast<int64_t>(players));
+    }
+    return metrics::Registry::Instance().Scrape();
+}
+
+std::optional<std::string> RequestHandler::AdminReport(std::string_view target) const {
+    if (target == "/admin/arena"sv) {
+        return http_server::ArenaStats::Instance().PrintStats();
+    }
+    if (target == "/admin/logging"sv) {
+        return logger::AsyncLogBackend::Instance().PrintStats();
+    }
+    if (target == "/admin/rate_limits"sv) {
+        return rate_limiter_.PrintStats();
+    }
+    if (target == "/admin/trace"sv) {
+        return tracing::Tracer::Instance().DumpChromeTrace();
+    }
+    if (target == "/admin/maps"sv && map_reloader_) {
+        return map_reloader_->PrintStats();
+    }
+    return std::nullopt;
+}
+
+std::string RequestHandler::PrintMemoryStats() const {
+    std::string report = "{\"subsystems\":" + memory::Accounting::Instance().PrintStats() + ",\"sessions\":[";
+    bool first = true;
+    for (const model::GameSession* game_session : game_.GetSessions()) {
+        if (!first) {
+            report += ',';
+        }
+        first = false;
+        report += "{\"map\":";
+        model::AppendJsonString(report, *game_session->GetMap()->GetId());
+        report += ",\"instance\":" + std::to_string(game_session->GetInstance())
+            + ",\"players\":" + std::to_string(game_session->GetPlayerCount())
+            + ",\"memory\":" + game_session->GetMemory().PrintStats() + "}";
+    }
+    report += "]}";
+    return report;
+}
+
 bool IsSubPath(fs::path path, fs::path base) {
     // Приводим оба пути к каноничному виду (без . и ..)
     path = fs::weakly_canonical(path);
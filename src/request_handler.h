@@ -10,17 +10,29 @@
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/asio/io_context.hpp>
+// Файлы в Asio есть только с io_uring (сборка с -DGAME_SERVER_IO_URING=ON)
+#ifdef BOOST_ASIO_HAS_FILE
+#include <boost/asio/random_access_file.hpp>
+#include <boost/asio/read_at.hpp>
+#endif
 #include <filesystem>
 #include <unordered_map>
 #include <chrono>
 #include <functional>
 #include <sstream>
+#include <optional>
 
 #include "http_server.h"
 #include "model.h"
 #include "logger.h"
 #include "api_handler.h"
 #include "response_maker.h"
+#include "rate_limiter.h"
+#include "admin_access.h"
+#include "metrics.h"
+#include "tracing.h"
+#include "traffic_recorder.h"
+#include "map_reloader.h"
 
 namespace http_handler {
 
@@ -45,21 +57,31 @@ struct ResponseData {
     std::string_view content_type;
 };
 
+// Число API-запросов, ожидающих выполнения в strand игры
+const metrics::Gauge& StrandQueueDepth();
+
+// Значение заголовка Server-Timing: ожидание в strand и работа обработчика
+std::string ServerTiming(steady_clock::duration queue, steady_clock::duration handler);
+
 template <typename Body, typename Allocator, typename Send>
 class StrandAPIRequest: public std::enable_shared_from_this<StrandAPIRequest<Body, Allocator, Send>> {
 public:
+    using Request = http::request<Body, http::basic_fields<Allocator>>;
+
     StrandAPIRequest(net::strand<net::io_context::executor_type> &strand,
-        http::request<Body, http::basic_fields<Allocator>>&& req,
-        Send&& send, std::string &target, ResponseData &data, API_Handler &api_handler, model::Game &game):
+        Request&& req,
+        Send&& send, ResponseData &data, API_Handler &api_handler, model::Game &game):
             strand_{strand},
             req_{std::move(req)},
             send_{std::move(send)},
-            target_{target},
             data_{data}, 
             api_handler_{api_handler},
             game_{game} {}
 
     void Execute() {
+        StrandQueueDepth().Add(1);
+        trace_id_ = tracing::CurrentId();
+        queued_at_ = steady_clock::now();
         net::dispatch(strand_, [self=this->shared_from_this()](){
             self->ExecuteApi();
         });
@@ -67,24 +89,48 @@ public:
 
 private:
     net::strand<net::io_context::executor_type> &strand_;
-    http::request<Body, http::basic_fields<Allocator>> req_;
+    std::optional<Request> req_;
     Send send_;
-    std::string &target_;
     ResponseData &data_;
     API_Handler &api_handler_;
     model::Game &game_;
+    uint64_t trace_id_ = 0;
+    steady_clock::time_point queued_at_;
 
     void ExecuteApi() {
-        URI_Request request;
-        request.ParceURI(std::forward<decltype(req_)>(req_));
+        StrandQueueDepth().Add(-1);
+        const auto started_at = steady_clock::now();
+        tracing::Complete("strand.wait", trace_id_, queued_at_);
+        tracing::ScopedId scoped_id{trace_id_};
+
+        std::optional<API_Handler::ApiResponse> api_responce;
+        {
+            // URI_Request ссылается на req_ и продлевает жизнь этого объекта, пока используется
+            URI_Request request;
+            {
+                tracing::Span span{"api.parse"};
+                request.ParceURI(std::shared_ptr<const Request>(this->shared_from_this(), &*req_));
+            }
 
-        // выполняем запрос сохраняя responce status_code в request
-        auto string_responce = api_handler_.ExecuteTarget(request, game_);
+            // выполняем запрос сохраняя responce status_code в request
+            {
+                tracing::Span span{"api.handler"};
+                api_responce.emplace(api_handler_.ExecuteTarget(request, game_));
+            }
 
-        // заполняем данные для логирования
-        data_.status = request.GetResponseStatusCode();
-        data_.content_type = Response::ContentType::APP_JSON;
-        send_(string_responce);
+            // заполняем данные для логирования
+            data_.status = request.GetResponseStatusCode();
+            data_.content_type = Response::ContentType::APP_JSON;
+        }
+        const std::string server_timing = ServerTiming(started_at - queued_at_, steady_clock::now() - started_at);
+
+        // Запрос лежит в арене соединения, которая освобождается сразу после записи ответа,
+        // поэтому разрушаем его до отправки
+        req_.reset();
+        std::visit([this, &server_timing](auto& response) {
+            response.set("Server-Timing"sv, server_timing);
+            send_(std::move(response));
+        }, *api_responce);
     }
 };
 
@@ -93,27 +139,82 @@ public:
     // Запрос, тело которого представлено в виде строки
     using StringRequest = http::request<http::string_body>;
     // Ответ, тело которого представлено в виде строки
-    using StringResponse = http::response<http::string_body>;
+    using StringResponse = Response::StringResponse;
 
-    explicit RequestHandler(net::strand<net::io_context::executor_type> &strand, model::Game& game, std::string static_folder)
-        : strand_{strand}, game_{game}, static_path_{StringToPath(static_folder)}, static_folder_str_(static_folder) {
-    }
+    explicit RequestHandler(net::strand<net::io_context::executor_type> &strand, model::Game& game, std::string static_folder,
+                            RateLimitConfig rate_limits = {});
 
     RequestHandler(const RequestHandler&) = delete;
     RequestHandler& operator=(const RequestHandler&) = delete;
 
-    template <typename Body, typename Allocator, typename Send>
-    void operator()(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send, ResponseData &data) {
-        auto target = std::string(req.target());
-        http::basic_fields<Allocator> tmp;
+    // Включает перезагрузку карт через POST /admin/maps/reload
+    void SetMapReloader(std::shared_ptr<map_reload::MapReloader> reloader) {
+        map_reloader_ = std::move(reloader);
+    }
+
+    // С токеном /admin/* требуют "Authorization: Bearer <токен>", без него доступны только с loopback
+    void SetAdminToken(std::string token) {
+        admin_access_ = AdminAccess{std::move(token)};
+    }
+
+    // Статические файлы ищутся и открываются на потоках executor, не занимая потоки сети.
+    // Без него - на потоке соединения
+    void SetFileExecutor(net::any_io_executor executor) {
+        file_executor_ = std::move(executor);
+    }
+
+#ifdef BOOST_ASIO_HAS_FILE
+    // Статические файлы до MAX_ASYNC_FILE_SIZE читаются асинхронно через io_uring
+    // io_context'а executor, файлы больше - как обычно
+    void SetAsyncFileExecutor(net::io_context::executor_type executor) {
+        async_file_executor_ = std::move(executor);
+    }
+#endif
 
+    static constexpr uintmax_t MAX_ASYNC_FILE_SIZE = 1024 * 1024;
+
+    template <typename Body, typename Allocator, typename Send>
+    void operator()(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send, ResponseData &data,
+                    const net::ip::address& remote_address) {
         if (req.target().starts_with("/api/")) {
+            // Ограничение частоты проверяем до strand, чтобы лишний трафик не занимал игровой поток
+            if (auto verdict = CheckRateLimit(req, remote_address); !verdict.IsAllowed()) {
+                return SendTooManyRequests(req, std::forward<decltype(send)>(send), data, verdict);
+            }
+
             std::make_shared<StrandAPIRequest<Body, Allocator, Send>>(
                 strand_, std::forward<decltype(req)>(req), std::forward<decltype(send)>(send),
-                target, data, api_handler_, game_)->Execute();
+                data, api_handler_, game_)->Execute();
+        }
+        else if (req.target().starts_with("/admin/")) {
+            // Служебные эндпоинты ограничиваются по частоте так же, как API, и проверяются до разбора
+            if (auto verdict = CheckRateLimit(req, remote_address); !verdict.IsAllowed()) {
+                return SendTooManyRequests(req, std::forward<decltype(send)>(send), data, verdict);
+            }
+            if (auto verdict = CheckAdminAccess(req, remote_address); verdict != AdminAccess::Verdict::ALLOWED) {
+                return SendAdminAccessDenied(req, std::forward<decltype(send)>(send), data, verdict);
+            }
+            HandleAdminRequest(std::move(req), std::move(send), data);
+        }
+        else if (req.target() == "/metrics"sv) {
+            HandleMetricsRequest(std::move(req), std::move(send), data);
         }
         else {
-            HandleStaticContentRequest(std::move(req), std::move(send), target, data);
+            static_requests_.Inc();
+            // Запрос лежит в арене соединения, которая освобождается сразу после записи ответа,
+            // поэтому в пул файлов уходят только нужные для ответа поля, а не сам запрос
+            auto target = std::string(req.target());
+            const unsigned version = req.version();
+            const bool keep_alive = req.keep_alive();
+            if (file_executor_.has_value()) {
+                // data принадлежит send в LoggingRequestHandler и живёт, пока жив send.
+                // Вызывающий RequestHandler напрямую должен держать data до отправки ответа
+                return net::post(*file_executor_, [this, version, keep_alive, send = std::forward<Send>(send),
+                                                   target = std::move(target), &data]() mutable {
+                    HandleStaticContentRequest(version, keep_alive, std::move(send), std::move(target), data);
+                });
+            }
+            HandleStaticContentRequest(version, keep_alive, std::forward<Send>(send), std::move(target), data);
         }
     }
 
@@ -123,9 +224,154 @@ private:
     fs::path static_path_;
     std::string static_folder_str_;
     API_Handler api_handler_;
+    RateLimiter rate_limiter_;
+    AdminAccess admin_access_;
+    metrics::Counter static_requests_;
+
+    std::shared_ptr<map_reload::MapReloader> map_reloader_;
+    std::optional<net::any_io_executor> file_executor_;
+#ifdef BOOST_ASIO_HAS_FILE
+    std::optional<net::io_context::executor_type> async_file_executor_;
+#endif
+
+    // Показатели игры по картам, обновляются перед каждой выдачей /metrics
+    struct MapGauges {
+        metrics::Gauge sessions;
+        metrics::Gauge players;
+    };
+    std::unordered_map<model::Map::Id, MapGauges, util::TaggedHasher<model::Map::Id>> map_gauges_;
+
+    // Вызывается в конструкторе и внутри strand
+    void AddMapGauges();
 
+    template <typename Body, typename Allocator>
+    RateLimiter::Verdict CheckRateLimit(const http::request<Body, http::basic_fields<Allocator>>& req,
+                                        const net::ip::address& remote_address) {
+        if (!rate_limiter_.IsEnabled()) {
+            return {};
+        }
+
+        std::string_view auth_token;
+        if (auto it = req.find(http::field::authorization); it != req.end()) {
+            auth_token = ExtractAuthToken(it->value());
+        }
+        return rate_limiter_.Check(auth_token, remote_address, req.target());
+    }
+
+    template <typename Body, typename Allocator, typename Send>
+    void SendTooManyRequests(const http::request<Body, http::basic_fields<Allocator>>& req, Send&& send,
+                             ResponseData &resp_data, const RateLimiter::Verdict& verdict) {
+        Response response_maker_;
+
+        resp_data.status = http::status::too_many_requests;
+        resp_data.content_type = Response::ContentType::APP_JSON;
+
+        auto response = response_maker_.MakeStringResponse(http::status::too_many_requests,
+            PrintErrorResponce("tooManyRequests", "Request rate limit exceeded"), req.version(), req.keep_alive(),
+            Response::AllowData::EMPTY, Response::ContentType::APP_JSON);
+        response.set(http::field::retry_after, std::to_string(verdict.retry_after.count()));
+        send(response);
+    }
+
+    template <typename Body, typename Allocator>
+    AdminAccess::Verdict CheckAdminAccess(const http::request<Body, http::basic_fields<Allocator>>& req,
+                                          const net::ip::address& remote_address) const {
+        std::optional<std::string_view> authorization;
+        if (auto it = req.find(http::field::authorization); it != req.end()) {
+            authorization = it->value();
+        }
+        return admin_access_.Check(authorization, remote_address);
+    }
+
+    template <typename Body, typename Allocator, typename Send>
+    void SendAdminAccessDenied(const http::request<Body, http::basic_fields<Allocator>>& req, Send&& send,
+                               ResponseData &resp_data, AdminAccess::Verdict verdict) {
+        Response response_maker_;
+
+        const bool unauthorized = verdict == AdminAccess::Verdict::UNAUTHORIZED;
+        resp_data.status = unauthorized ? http::status::unauthorized : http::status::forbidden;
+        resp_data.content_type = Response::ContentType::APP_JSON;
+        send(response_maker_.MakeStringResponse(resp_data.status,
+            unauthorized ? PrintErrorResponce("invalidToken", "Admin token is missing or invalid")
+                         : PrintErrorResponce("forbidden", "Admin endpoints are available only from loopback"),
+            req.version(), req.keep_alive(), Response::AllowData::EMPTY, Response::ContentType::APP_JSON));
+    }
+
+    // Служебные эндпоинты обрабатываются на потоке ввода-вывода, не затрагивая strand игры.
+    // Исключение - /admin/memory: память по сессиям читается внутри strand
     template <typename Body, typename Allocator, typename Send>
-    void HandleStaticContentRequest(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send, std::string target, ResponseData &resp_data) {
+    void HandleAdminRequest(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send, ResponseData &resp_data) {
+        Response response_maker_;
+
+        if (req.target() == "/admin/maps/reload"sv && map_reloader_) {
+            if (req.method() != http::verb::post) {
+                resp_data.status = http::status::method_not_allowed;
+                resp_data.content_type = Response::ContentType::APP_JSON;
+                return send(response_maker_.MakeStringResponse(http::status::method_not_allowed,
+                    PrintErrorResponce("invalidMethod", "Only POST method is expected"), req.version(), req.keep_alive(),
+                    Response::AllowData::POST, Response::ContentType::APP_JSON));
+            }
+
+            // Конфиг разбирается в фоновом потоке, ответ не ждёт окончания перезагрузки
+            const bool started = map_reloader_->Reload();
+            resp_data.status = started ? http::status::accepted : http::status::conflict;
+            resp_data.content_type = Response::ContentType::APP_JSON;
+            return send(response_maker_.MakeStringResponse(resp_data.status,
+                started ? "{\"status\":\"started\"}"s : "{\"status\":\"inProgress\"}"s, req.version(), req.keep_alive(),
+                Response::AllowData::EMPTY, Response::ContentType::APP_JSON));
+        }
+
+        if (req.target() == "/admin/memory"sv) {
+            resp_data.status = http::status::ok;
+            resp_data.content_type = Response::ContentType::APP_JSON;
+            return net::dispatch(strand_, [this, version = req.version(), keep_alive = req.keep_alive(), send = std::move(send)]() mutable {
+                Response response_maker_;
+                send(response_maker_.MakeStringResponse(http::status::ok,
+                    PrintMemoryStats(), version, keep_alive,
+                    Response::AllowData::EMPTY, Response::ContentType::APP_JSON));
+            });
+        }
+
+        if (auto report = AdminReport(req.target()); report.has_value()) {
+            resp_data.status = http::status::ok;
+            resp_data.content_type = Response::ContentType::APP_JSON;
+            return send(response_maker_.MakeStringResponse(http::status::ok,
+                *report, req.version(), req.keep_alive(),
+                Response::AllowData::EMPTY, Response::ContentType::APP_JSON));
+        }
+
+        resp_data.status = http::status::not_found;
+        resp_data.content_type = Response::ContentType::TEXT_PLAIN;
+        send(response_maker_.MakeStringResponse(http::status::not_found,
+            "Unknown admin endpoint: "s + std::string(req.target()), req.version(), req.keep_alive(),
+            Response::AllowData::EMPTY, Response::ContentType::TEXT_PLAIN));
+    }
+
+    // JSON-отчёт служебного эндпоинта или nullopt, если такого нет
+    std::optional<std::string> AdminReport(std::string_view target) const;
+
+    // Память по подсистемам и по экземплярам карт. Вызывается только внутри strand
+    std::string PrintMemoryStats() const;
+
+    // Метрики в формате Prometheus. Состояние игры читается в strand, остальное - из реестра метрик
+    template <typename Body, typename Allocator, typename Send>
+    void HandleMetricsRequest(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send, ResponseData &resp_data) {
+        resp_data.status = http::status::ok;
+        resp_data.content_type = Response::ContentType::TEXT_PLAIN;
+
+        net::dispatch(strand_, [this, version = req.version(), keep_alive = req.keep_alive(), send = std::move(send)]() mutable {
+            Response response_maker_;
+            send(response_maker_.MakeStringResponse(http::status::ok,
+                ScrapeMetrics(), version, keep_alive,
+                Response::AllowData::EMPTY, Response::ContentType::TEXT_PLAIN));
+        });
+    }
+
+    // Вызывается только внутри strand
+    std::string ScrapeMetrics();
+
+    template <typename Send>
+    void HandleStaticContentRequest(unsigned version, bool keep_alive, Send&& send, std::string target, ResponseData &resp_data) {
         Response response_maker_;
         // 1. Transform URL from target to normal string.
         target = DecodeURL(target);
@@ -141,8 +387,19 @@ private:
             if (fs::exists(target_path)) {
                 std::string file_extension {target_path.extension().c_str()};
 
+#ifdef BOOST_ASIO_HAS_FILE
+                if (sys::error_code ec; async_file_executor_.has_value()) {
+                    const uintmax_t size = fs::file_size(target_path, ec);
+                    if (!ec && size <= MAX_ASYNC_FILE_SIZE) {
+                        return SendFileAsync(target_path, static_cast<size_t>(size),
+                                             response_maker_.GetTypeByFileExtention(file_extension),
+                                             version, keep_alive, std::forward<Send>(send), resp_data);
+                    }
+                }
+#endif
+
                 http::response<http::file_body> response;
-                response.version(req.version());
+                response.version(version);
                 response.result(http::status::ok);
                 response.insert(http::field::content_type, response_maker_.GetTypeByFileExtention(file_extension));
 
@@ -167,7 +424,7 @@ private:
                 resp_data.status = http::status::not_found;
                 resp_data.content_type = Response::ContentType::TEXT_PLAIN;
                 send(response_maker_.MakeStringResponse(http::status::not_found,
-                    body, req.version(), req.keep_alive(), Response::AllowData::EMPTY, Response::ContentType::TEXT_PLAIN));
+                    body, version, keep_alive, Response::AllowData::EMPTY, Response::ContentType::TEXT_PLAIN));
             }
         } else {
             // return 400 Bad Request
@@ -176,9 +433,56 @@ private:
             resp_data.status = http::status::bad_request;
             resp_data.content_type = Response::ContentType::TEXT_PLAIN;
             send(response_maker_.MakeStringResponse(http::status::bad_request,
-                body, req.version(), req.keep_alive(), Response::AllowData::EMPTY, Response::ContentType::TEXT_PLAIN));
+                body, version, keep_alive, Response::AllowData::EMPTY, Response::ContentType::TEXT_PLAIN));
         }
     }
+
+#ifdef BOOST_ASIO_HAS_FILE
+    // Читает файл целиком одной операцией io_uring, поток соединения в это время свободен.
+    // Статус и тип для лога заполняются по фактически отправленному ответу
+    template <typename Send>
+    void SendFileAsync(const fs::path& path, size_t size, std::string_view content_type, unsigned version, bool keep_alive,
+                       Send&& send, ResponseData &resp_data) {
+        struct FileRead {
+            net::random_access_file file;
+            std::string data;
+        };
+        auto read = std::make_shared<FileRead>(FileRead{net::random_access_file{*async_file_executor_}, std::string(size, '\0')});
+
+        auto reply = [content_type, version, keep_alive,
+                      send = std::forward<Send>(send), &resp_data](http::status status, std::string body) mutable {
+            resp_data.status = status;
+            resp_data.content_type = status == http::status::ok ? content_type : Response::ContentType::TEXT_PLAIN;
+
+            http::response<http::string_body> response{status, version};
+            response.set(http::field::content_type, resp_data.content_type);
+            response.body() = std::move(body);
+            response.keep_alive(keep_alive);
+            response.prepare_payload();
+            send(std::move(response));
+        };
+
+        sys::error_code ec;
+        read->file.open(path.string(), net::random_access_file::read_only, ec);
+        if (ec) {
+            boost::json::value custom_data{{"filename"s, path.c_str()}, {"address"s, "0.0.0.0"s}};
+            logger::LogJSON(custom_data, "Error opening file"sv);
+            return reply(http::status::internal_server_error, "Error opening file"s);
+        }
+
+        net::async_read_at(read->file, 0, net::buffer(read->data),
+            [read, path, reply = std::move(reply)](sys::error_code ec, size_t bytes_read) mutable {
+                // eof - файл стал короче, чем был при проверке размера
+                if (ec && ec != net::error::eof) {
+                    boost::json::value custom_data{{"filename"s, path.c_str()}, {"error"s, ec.message()}};
+                    logger::LogJSON(custom_data, "Error reading file"sv);
+                    return reply(http::status::internal_server_error, "Error reading file"s);
+                }
+                read->data.resize(bytes_read);
+                reply(http::status::ok, std::move(read->data));
+            });
+    }
+#endif
 };
 
 class LoggingRequestHandler: public RequestHandler {
@@ -195,8 +499,7 @@ class LoggingRequestHandler: public RequestHandler {
         logger::LogJSON(custom_data, "request received"sv);
     }
 
-    template <typename Send>
-    static void LogResponse(const Send& res, const tcp::endpoint& end_point, ResponseData& data, int responce_time) {
+    static void LogResponse(const tcp::endpoint& end_point, const ResponseData& data, int responce_time) {
         json::value custom_data{
             {"ip"s, end_point.address().to_string()},
             {"response_time"s, responce_time},
@@ -207,21 +510,73 @@ class LoggingRequestHandler: public RequestHandler {
         logger::LogJSON(custom_data, "response sent"sv);
     }
 
+    // API-запрос, ожидающий ответа для записи
+    struct PendingRecord {
+        recording::RecordedRequest request;
+        std::string auth_token;
+    };
+
+    // Данные запроса копируются до того, как он уйдёт в обработку (и будет освобождён)
+    template <typename Body, typename Allocator>
+    std::optional<PendingRecord> MakeRecord(const http::request<Body, http::basic_fields<Allocator>>& req) const {
+        if (!recorder_ || !req.target().starts_with("/api/"sv)) {
+            return std::nullopt;
+        }
+
+        PendingRecord record;
+        record.request.arrival_us = recorder_->Now();
+        record.request.method = static_cast<uint8_t>(req.method());
+        record.request.target = std::string(req.target());
+        record.request.body = std::string(req.body());
+        if (auto it = req.find(http::field::content_type); it != req.end()) {
+            record.request.content_type = std::string(it->value());
+        }
+        if (auto it = req.find(http::field::authorization); it != req.end()) {
+            record.auth_token = std::string(ExtractAuthToken(it->value()));
+        }
+        return record;
+    }
+
+    template <typename Response>
+    static void WriteRecord(recording::TrafficRecorder& recorder, PendingRecord&& record, const Response& response) {
+        record.request.status = static_cast<uint16_t>(response.result_int());
+        if constexpr (requires { std::string_view{response.body()}; }) {
+            recorder.Record(std::move(record.request), record.auth_token, response.body());
+        } else {
+            recorder.Record(std::move(record.request), record.auth_token, std::nullopt);
+        }
+    }
+
+    std::shared_ptr<recording::TrafficRecorder> recorder_;
+
 public:
-    LoggingRequestHandler(net::strand<net::io_context::executor_type> &strand, model::Game& game, std::string static_folder)
-        :RequestHandler{strand, game, static_folder} {
+    LoggingRequestHandler(net::strand<net::io_context::executor_type> &strand, model::Game& game, std::string static_folder,
+                          RateLimitConfig rate_limits = {})
+        :RequestHandler{strand, game, static_folder, std::move(rate_limits)} {
+    }
+
+    // Включает запись API-запросов в файл для последующего воспроизведения
+    void SetRecorder(std::shared_ptr<recording::TrafficRecorder> recorder) {
+        recorder_ = std::move(recorder);
     }
 
     template <typename Body, typename Allocator, typename Send>
     void operator()(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send, const tcp::endpoint& end_point) {
-        ResponseData data;
-
         LogRequest(req, end_point);
 
-        steady_clock::time_point start_time{steady_clock::now()};
-        RequestHandler::operator()(std::forward<decltype(req)>(req), std::forward<decltype(send)>(send), data);
+        // API-запросы выполняются в strand уже после возврата из operator(), поэтому время ответа
+        // измеряем в момент отправки, а данные для лога живут вместе с функцией отправки
+        auto data = std::make_shared<ResponseData>();
+        auto logging_send = [send = std::forward<Send>(send), data, end_point, start_time = steady_clock::now(),
+                             recorder = recorder_.get(), record = MakeRecord(req)](auto&& response) mutable {
+            LogResponse(end_point, *data, duration_cast<milliseconds>(steady_clock::now() - start_time).count());
+            if (record.has_value()) {
+                WriteRecord(*recorder, std::move(*record), response);
+            }
+            send(std::forward<decltype(response)>(response));
+        };
 
-        LogResponse(send, end_point, data, std::chrono::duration_cast<std::chrono::milliseconds>(steady_clock::now() - start_time).count());
+        RequestHandler::operator()(std::forward<decltype(req)>(req), std::move(logging_send), *data, end_point.address());
     }
 };
 
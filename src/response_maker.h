@@ -7,6 +7,11 @@
 #include <unordered_map>
 #include <string_view>
 #include <boost/algorithm/string.hpp>
+#include <boost/beast/http.hpp>
+
+#include "arena.h"
+#include "stream_body.h"
+#include "tracing.h"
 
 namespace http_handler {
 using namespace std::literals;
@@ -14,9 +19,18 @@ using namespace std::literals;
 namespace beast = boost::beast;
 namespace http = beast::http;
 
+using http_server::ArenaAllocator;
+
 class Response{
 public:
-    using StringResponse = http::response<http::string_body>;
+    // Заголовки и тело ответа размещаются через allocator_ (для API-запросов - в арене соединения)
+    using StringResponse = http::response<http_server::ArenaStringBody, http_server::ArenaFields>;
+    // Ответ, тело которого дописывается частями во время записи в сокет
+    using StreamResponse = http::response<http_server::StreamBody, http_server::ArenaFields>;
+
+    Response() = default;
+    explicit Response(ArenaAllocator allocator)
+        : allocator_{allocator} {}
 
     struct AllowData {
         constexpr static std::string_view GET = "GET, HEAD"sv;
@@ -83,7 +97,9 @@ public:
         std::string_view allow = AllowData::EMPTY,
         std::string_view content_tp = ContentType::TEXT_HTML) 
     {
-        StringResponse response(status, http_version);
+        tracing::Span span{"response.build"};
+
+        StringResponse response(status, http_version, allocator_, allocator_);
         response.set(http::field::content_type, content_tp);
         response.set(http::field::cache_control, "no-cache"sv);
         if (!allow.empty()) {
@@ -94,8 +110,35 @@ public:
         response.keep_alive(keep_alive);
         return response;
     }
+
+    // Создаёт StreamResponse: тело передаётся чанками (Transfer-Encoding: chunked).
+    // HTTP/1.0 не знает чанков, поэтому там конец тела обозначается закрытием соединения
+    StreamResponse MakeStreamResponse(
+        http::status status,
+        http_server::StreamBody::Generator generator,
+        unsigned http_version,
+        bool keep_alive,
+        std::string_view content_tp = ContentType::APP_JSON)
+    {
+        tracing::Span span{"response.build"};
+
+        StreamResponse response(std::piecewise_construct, std::make_tuple(), std::make_tuple(allocator_));
+        response.result(status);
+        response.version(http_version);
+        response.set(http::field::content_type, content_tp);
+        response.set(http::field::cache_control, "no-cache"sv);
+        response.body().generator = std::move(generator);
+        if (http_version >= 11) {
+            response.chunked(true);
+            response.keep_alive(keep_alive);
+        } else {
+            response.keep_alive(false);
+        }
+        return response;
+    }
 private:
     ContentType content_type_;
+    ArenaAllocator allocator_;
 };
 } // namespace http_handler
 #endif
\ No newline at end of file
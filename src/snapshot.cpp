@@ -0,0 +1,213 @@
+#include "snapshot.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+
+#include "binary_io.h"
+#include "logger.h"
+
+namespace snapshot {
+
+using namespace std::literals;
+
+namespace {
+
+constexpr std::string_view MAGIC = "GSNP"sv;
+constexpr uint32_t VERSION = 4;
+
+} // namespace
+
+void WritePlayer(binary_io::Writer& writer, const model::PlayerSnapshot& player) {
+    writer.WriteString<uint8_t>(player.token);
+    writer.Write<int32_t>(player.id);
+    writer.WriteString<uint16_t>(player.name);
+    writer.Write(player.dog.position.x);
+    writer.Write(player.dog.position.y);
+    writer.Write(player.dog.speed.x);
+    writer.Write(player.dog.speed.y);
+    writer.Write<uint8_t>(player.dog.direction);
+}
+
+model::PlayerSnapshot ReadPlayer(binary_io::Reader& reader) {
+    model::PlayerSnapshot player;
+    player.token = reader.ReadString<uint8_t>();
+    player.id = reader.Read<int32_t>();
+    player.name = reader.ReadString<uint16_t>();
+    player.dog.position.x = reader.Read<double>();
+    player.dog.position.y = reader.Read<double>();
+    player.dog.speed.x = reader.Read<double>();
+    player.dog.speed.y = reader.Read<double>();
+
+    const auto direction = reader.Read<uint8_t>();
+    if (direction > model::Direction::NONE) {
+        throw std::runtime_error("Invalid dog direction in snapshot"s);
+    }
+    player.dog.direction = static_cast<model::Direction>(direction);
+    return player;
+}
+
+std::string Serialize(const model::GameSnapshot& snapshot) {
+    std::string buffer;
+    binary_io::Writer writer{buffer};
+
+    writer.WriteBytes(MAGIC);
+    writer.Write(VERSION);
+    writer.Write<int32_t>(snapshot.next_player_id);
+    writer.Write<uint64_t>(snapshot.last_event);
+    writer.Write<uint32_t>(static_cast<uint32_t>(snapshot.sessions.size()));
+
+    for (const auto& session : snapshot.sessions) {
+        writer.WriteString<uint16_t>(session.map_id);
+        writer.Write<uint32_t>(session.instance);
+        writer.Write<uint32_t>(static_cast<uint32_t>(session.players.size()));
+        for (const auto& player : session.players) {
+            WritePlayer(writer, player);
+            writer.Write<uint64_t>(player.idle_time);
+        }
+    }
+    return buffer;
+}
+
+model::GameSnapshot Deserialize(std::string_view data) {
+    binary_io::Reader reader{data};
+
+    if (reader.Take(MAGIC.size()) != MAGIC) {
+        throw std::runtime_error("Not a game snapshot"s);
+    }
+    // Снимки первой версии не содержат номера последнего изменения, второй - номеров экземпляров карт,
+    // третьей - времени простоя игроков
+    const auto version = reader.Read<uint32_t>();
+    if (version == 0 || version > VERSION) {
+        throw std::runtime_error("Unsupported game snapshot version "s + std::to_string(version));
+    }
+
+    model::GameSnapshot snapshot;
+    snapshot.next_player_id = reader.Read<int32_t>();
+    if (version >= 2) {
+        snapshot.last_event = reader.Read<uint64_t>();
+    }
+    snapshot.sessions.resize(reader.Read<uint32_t>());
+
+    for (auto& session : snapshot.sessions) {
+        session.map_id = reader.ReadString<uint16_t>();
+        if (version >= 3) {
+            session.instance = reader.Read<uint32_t>();
+        }
+        const auto count = reader.Read<uint32_t>();
+        session.players.reserve(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            auto& player = session.players.emplace_back(ReadPlayer(reader));
+            if (version >= 4) {
+                player.idle_time = reader.Read<uint64_t>();
+            }
+        }
+    }
+
+    if (!reader.AtEnd()) {
+        throw std::runtime_error("Trailing data in game snapshot"s);
+    }
+    return snapshot;
+}
+
+void SaveToFile(const model::GameSnapshot& snapshot, const std::filesystem::path& path) {
+    const std::string data = Serialize(snapshot);
+    const std::filesystem::path temp_path = path.string() + ".tmp"s;
+
+    const int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "open "s + temp_path.string());
+    }
+    try {
+        binary_io::WriteAll(fd, data);
+        if (::fdatasync(fd) != 0) {
+            throw std::system_error(errno, std::generic_category(), "fdatasync snapshot");
+        }
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+
+    std::filesystem::rename(temp_path, path);
+}
+
+std::optional<model::GameSnapshot> LoadFromFile(const std::filesystem::path& path) {
+    std::ifstream file{path, std::ios::binary | std::ios::ate};
+    if (!file.is_open()) {
+        return std::nullopt;
+    }
+
+    // Весь файл читается одним вызовом и разбирается из памяти
+    std::string data(static_cast<size_t>(file.tellg()), '\0');
+    file.seekg(0);
+    if (!file.read(data.data(), static_cast<std::streamsize>(data.size()))) {
+        throw std::runtime_error("Can't read snapshot "s + path.string());
+    }
+    return Deserialize(data);
+}
+
+// ------------------------------ SnapshotWriter ------------------------------
+SnapshotWriter::SnapshotWriter(std::filesystem::path path, SavedHandler on_saved)
+    : path_{std::move(path)}
+    , on_saved_{std::move(on_saved)}
+    , thread_{[this] { Run(); }} {
+}
+
+SnapshotWriter::~SnapshotWriter() {
+    Stop();
+}
+
+void SnapshotWriter::Submit(model::GameSnapshot snapshot) {
+    {
+        std::lock_guard lock{mutex_};
+        pending_ = std::move(snapshot);
+    }
+    cv_.notify_one();
+}
+
+void SnapshotWriter::Stop() {
+    {
+        std::lock_guard lock{mutex_};
+        if (stopping_) {
+            return;
+        }
+        stopping_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+}
+
+void SnapshotWriter::Run() {
+    while (true) {
+        std::optional<model::GameSnapshot> snapshot;
+        {
+            std::unique_lock lock{mutex_};
+            cv_.wait(lock, [this] {
+                return stopping_ || pending_.has_value();
+            });
+            if (!pending_.has_value()) {
+                return;
+            }
+            snapshot = std::move(pending_);
+            pending_.reset();
+        }
+
+        try {
+            SaveToFile(*snapshot, path_);
+            if (on_saved_) {
+                on_saved_(*snapshot);
+            }
+        } catch (const std::exception& ex) {
+            boost::json::value custom_data{{"filename"s, path_.string()}, {"exception"s, ex.what()}};
+            logger::LogJSON(custom_data, "snapshot save failed"sv);
+        }
+    }
+}
+
+} // namespace snapshot
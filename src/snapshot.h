@@ -0,0 +1,70 @@
+#ifndef __SNAPSHOT__
+#define __SNAPSHOT__
+
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "binary_io.h"
+#include "model.h"
+
+namespace snapshot {
+
+// Двоичный формат снимка: сигнатура, версия, счётчик id игроков, номер последнего изменения
+// (с него продолжается повтор журнала), затем сессии (id карты, номер экземпляра) с игроками
+std::string Serialize(const model::GameSnapshot& snapshot);
+// Бросает std::runtime_error / std::out_of_range, если данные повреждены
+model::GameSnapshot Deserialize(std::string_view data);
+
+// Игрок в двоичном виде - общий для снимка и журнала изменений
+void WritePlayer(binary_io::Writer& writer, const model::PlayerSnapshot& player);
+model::PlayerSnapshot ReadPlayer(binary_io::Reader& reader);
+
+// Пишет во временный файл и атомарно переименовывает, поэтому на диске всегда целый снимок
+void SaveToFile(const model::GameSnapshot& snapshot, const std::filesystem::path& path);
+// nullopt, если файла нет
+std::optional<model::GameSnapshot> LoadFromFile(const std::filesystem::path& path);
+
+// Сохранение снимков в фоновом потоке. Снимок снимается в strand (это только копирование),
+// сериализация и запись на диск тик не задерживают. Если поток не успевает, промежуточные
+// снимки пропускаются - сохраняется самый свежий
+class SnapshotWriter {
+public:
+    // Вызывается в фоновом потоке после того, как снимок надёжно записан на диск
+    using SavedHandler = std::function<void(const model::GameSnapshot&)>;
+
+    explicit SnapshotWriter(std::filesystem::path path, SavedHandler on_saved = {});
+    ~SnapshotWriter();
+
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    void Submit(model::GameSnapshot snapshot);
+    // Дожидается записи последнего переданного снимка и останавливает поток
+    void Stop();
+
+private:
+    void Run();
+
+    std::filesystem::path path_;
+    SavedHandler on_saved_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::optional<model::GameSnapshot> pending_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+} // namespace snapshot
+
+#endif
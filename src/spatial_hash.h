@@ -0,0 +1,107 @@
+#ifndef __SPATIAL_HASH__
+#define __SPATIAL_HASH__
+
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "map.h"
+
+namespace model {
+
+// Пространственный хеш: плоскость разбита на квадратные ячейки со стороной cell_size, в каждой
+// ячейке - указатели на лежащие в ней объекты. Объекты рядом с точкой ищутся только в ячейках,
+// которые пересекает квадрат поиска, а перемещение объекта внутри ячейки ничего не стоит
+template <typename T>
+class SpatialHash {
+public:
+    explicit SpatialHash(double cell_size = 1.0)
+        : cell_size_{cell_size > 0.0 ? cell_size : 1.0} {
+    }
+
+    double GetCellSize() const {
+        return cell_size_;
+    }
+
+    size_t GetCellCount() const {
+        return cells_.size();
+    }
+
+    void Clear() {
+        cells_.clear();
+    }
+
+    void Insert(const T* item, DogPoint position) {
+        cells_[KeyOf(position)].push_back(item);
+    }
+
+    void Erase(const T* item, DogPoint position) {
+        auto it = cells_.find(KeyOf(position));
+        if (it == cells_.end()) {
+            return;
+        }
+        auto& items = it->second;
+        if (auto pos = std::find(items.begin(), items.end(), item); pos != items.end()) {
+            *pos = items.back();
+            items.pop_back();
+        }
+        if (items.empty()) {
+            cells_.erase(it);
+        }
+    }
+
+    // Перекладывает объект, только если он сменил ячейку
+    void Move(const T* item, DogPoint from, DogPoint to) {
+        if (KeyOf(from) != KeyOf(to)) {
+            Erase(item, from);
+            Insert(item, to);
+        }
+    }
+
+    // Вызывает fn(const T*) для объектов из ячеек, пересекающих квадрат со стороной 2 * radius
+    // вокруг center. Точное расстояние проверяет fn
+    template <typename Fn>
+    void ForEachNear(DogPoint center, double radius, Fn&& fn) const {
+        const int64_t x0 = CellOf(center.x - radius);
+        const int64_t x1 = CellOf(center.x + radius);
+        const int64_t y0 = CellOf(center.y - radius);
+        const int64_t y1 = CellOf(center.y + radius);
+
+        for (int64_t x = x0; x <= x1; ++x) {
+            for (int64_t y = y0; y <= y1; ++y) {
+                if (auto it = cells_.find(Key(x, y)); it != cells_.end()) {
+                    for (const T* item : it->second) {
+                        fn(item);
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    using CellKey = uint64_t;
+
+    int64_t CellOf(double coord) const {
+        return static_cast<int64_t>(std::floor(coord / cell_size_));
+    }
+
+    static CellKey Key(int64_t x, int64_t y) {
+        return (static_cast<CellKey>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+    }
+
+    CellKey KeyOf(DogPoint position) const {
+        return Key(CellOf(position.x), CellOf(position.y));
+    }
+
+    double cell_size_;
+    std::unordered_map<CellKey, std::vector<const T*>> cells_;
+};
+
+} // namespace model
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef __STREAM_BODY__
+#define __STREAM_BODY__
+
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#pragma once
+#include <boost/asio/buffer.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/optional.hpp>
+#include <functional>
+#include <string>
+#include <utility>
+
+namespace http_server {
+
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+
+// Тело ответа, которое генерируется по частям по мере записи в сокет. Сериализатор Beast
+// запрашивает следующую часть, только когда предыдущая записана, поэтому память ответа
+// ограничена размером части, а не документа. С chunked(true) каждая часть уходит отдельным чанком
+struct StreamBody {
+    // Дописывает в buffer следующую часть документа, останавливаясь, когда buffer дорос до limit.
+    // false - документ закончен
+    using Generator = std::function<bool(std::string& buffer, size_t limit)>;
+
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 16 * 1024;
+
+    struct value_type {
+        Generator generator;
+        size_t chunk_size = DEFAULT_CHUNK_SIZE;
+    };
+
+    class writer {
+    public:
+        using const_buffers_type = net::const_buffer;
+
+        template <bool isRequest, class Fields>
+        writer(const http::header<isRequest, Fields>&, const value_type& body)
+            : body_{body} {
+        }
+
+        void init(beast::error_code& ec) {
+            ec = {};
+            done_ = !body_.generator;
+        }
+
+        boost::optional<std::pair<const_buffers_type, bool>> get(beast::error_code& ec) {
+            ec = {};
+            // Предыдущая часть уже записана: буфер переиспользуется
+            buffer_.clear();
+            while (!done_ && buffer_.size() < body_.chunk_size) {
+                done_ = !body_.generator(buffer_, body_.chunk_size);
+            }
+            if (buffer_.empty()) {
+                return boost::none;
+            }
+            return std::make_pair(const_buffers_type{buffer_.data(), buffer_.size()}, !done_);
+        }
+
+    private:
+        const value_type& body_;
+        std::string buffer_;
+        bool done_ = false;
+    };
+};
+
+} // namespace http_server
+
+#endif
@@ -0,0 +1,196 @@
+#ifndef __TIMING_WHEEL__
+#define __TIMING_WHEEL__
+
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace util {
+
+// Иерархическое колесо таймеров. Время - целые единицы (у игры - миллисекунды). Уровень level
+// из SLOTS ячеек покрывает SLOTS^(level + 1) единиц: таймер кладётся в уровень по тому, насколько
+// далеко до срабатывания, и при проходе границы уровня перекладывается ниже. Постановка,
+// перенос и отмена - O(1), а продвижение времени перескакивает интервалы, где нет таймеров
+template <typename T>
+class TimingWheel {
+public:
+    using TimerId = uint32_t;
+    static constexpr TimerId NO_TIMER = std::numeric_limits<TimerId>::max();
+
+    TimingWheel() {
+        heads_.fill(NO_TIMER);
+    }
+
+    uint64_t GetTime() const {
+        return now_;
+    }
+
+    size_t GetSize() const {
+        return size_;
+    }
+
+    // Таймер срабатывает на первом Advance, дошедшем до expires. Прошедшее время - на ближайшем
+    TimerId Schedule(T value, uint64_t expires) {
+        TimerId id = free_;
+        if (id != NO_TIMER) {
+            free_ = nodes_[id].next;
+        } else {
+            id = static_cast<TimerId>(nodes_.size());
+            nodes_.emplace_back();
+        }
+        nodes_[id].value = std::move(value);
+        nodes_[id].expires = std::max(expires, now_ + 1);
+        Link(id);
+        ++size_;
+        return id;
+    }
+
+    void Reschedule(TimerId id, uint64_t expires) {
+        Unlink(id);
+        nodes_[id].expires = std::max(expires, now_ + 1);
+        Link(id);
+    }
+
+    void Cancel(TimerId id) {
+        Unlink(id);
+        Release(id);
+    }
+
+    uint64_t GetExpiry(TimerId id) const {
+        return nodes_[id].expires;
+    }
+
+    // Удаляет все таймеры, время не меняется
+    void Clear() {
+        nodes_.clear();
+        nodes_.shrink_to_fit();
+        heads_.fill(NO_TIMER);
+        counts_.fill(0);
+        free_ = NO_TIMER;
+        size_ = 0;
+    }
+
+    // Доводит время до time и дописывает значения сработавших таймеров в expired
+    void Advance(uint64_t time, std::vector<T>& expired) {
+        while (now_ < time) {
+            // Пока нижние уровни пусты, сработать нечему до ближайшей границы первого непустого
+            unsigned level = 0;
+            while (level < LEVELS && counts_[level] == 0) {
+                ++level;
+            }
+            if (level == LEVELS) {
+                now_ = time;
+                break;
+            }
+            if (level > 0) {
+                const uint64_t boundary = ((now_ >> (BITS * level)) + 1) << (BITS * level);
+                if (boundary > time) {
+                    now_ = time;
+                    break;
+                }
+                now_ = boundary - 1;
+            }
+
+            ++now_;
+            for (unsigned upper = 1; upper < LEVELS && (now_ & ((uint64_t{1} << (BITS * upper)) - 1)) == 0; ++upper) {
+                Cascade(upper);
+            }
+            ExpireSlot(expired);
+        }
+    }
+
+private:
+    static constexpr unsigned BITS = 6;
+    static constexpr unsigned SLOTS = 1u << BITS;
+    static constexpr unsigned LEVELS = 4;
+
+    struct Node {
+        T value{};
+        uint64_t expires = 0;
+        TimerId prev = NO_TIMER;
+        TimerId next = NO_TIMER;
+        uint32_t slot = 0;  // level * SLOTS + индекс ячейки
+    };
+
+    void Link(TimerId id) {
+        Node& node = nodes_[id];
+        const uint64_t delta = node.expires - now_;
+        unsigned level = 0;
+        while (level + 1 < LEVELS && delta >= (uint64_t{1} << (BITS * (level + 1)))) {
+            ++level;
+        }
+        // Таймеры дальше верхнего уровня проходят через него по кругу, пока не приблизятся
+        node.slot = level * SLOTS + static_cast<uint32_t>((node.expires >> (BITS * level)) & (SLOTS - 1));
+        node.prev = NO_TIMER;
+        node.next = heads_[node.slot];
+        if (node.next != NO_TIMER) {
+            nodes_[node.next].prev = id;
+        }
+        heads_[node.slot] = id;
+        ++counts_[level];
+    }
+
+    void Unlink(TimerId id) {
+        Node& node = nodes_[id];
+        if (node.prev != NO_TIMER) {
+            nodes_[node.prev].next = node.next;
+        } else {
+            heads_[node.slot] = node.next;
+        }
+        if (node.next != NO_TIMER) {
+            nodes_[node.next].prev = node.prev;
+        }
+        --counts_[node.slot / SLOTS];
+    }
+
+    void Release(TimerId id) {
+        nodes_[id].value = T{};
+        nodes_[id].next = free_;
+        free_ = id;
+        --size_;
+    }
+
+    // Снимает всю ячейку: перекладываемые таймеры могут вернуться в неё же
+    TimerId Detach(uint32_t slot) {
+        const TimerId head = heads_[slot];
+        heads_[slot] = NO_TIMER;
+        for (TimerId id = head; id != NO_TIMER; id = nodes_[id].next) {
+            --counts_[slot / SLOTS];
+        }
+        return head;
+    }
+
+    void Cascade(unsigned level) {
+        const uint32_t slot = level * SLOTS + static_cast<uint32_t>((now_ >> (BITS * level)) & (SLOTS - 1));
+        for (TimerId id = Detach(slot); id != NO_TIMER;) {
+            const TimerId next = nodes_[id].next;
+            Link(id);
+            id = next;
+        }
+    }
+
+    void ExpireSlot(std::vector<T>& expired) {
+        for (TimerId id = Detach(static_cast<uint32_t>(now_ & (SLOTS - 1))); id != NO_TIMER;) {
+            const TimerId next = nodes_[id].next;
+            expired.push_back(std::move(nodes_[id].value));
+            Release(id);
+            id = next;
+        }
+    }
+
+    std::vector<Node> nodes_;
+    std::array<TimerId, LEVELS * SLOTS> heads_;
+    std::array<size_t, LEVELS> counts_{};
+    TimerId free_ = NO_TIMER;
+    size_t size_ = 0;
+    uint64_t now_ = 0;
+};
+
+} // namespace util
+
+#endif
@@ -0,0 +1,125 @@
+#include "tracing.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace tracing {
+
+namespace {
+
+thread_local uint64_t current_id = 0;
+
+void WriteEscaped(std::ostream& out, std::string_view text) {
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\';
+        }
+        if (static_cast<unsigned char>(c) >= 0x20) {
+            out << c;
+        }
+    }
+}
+
+} // namespace
+
+void Tracer::Enable(size_t buffer_size) {
+    buffer_size_ = buffer_size;
+    epoch_ = Clock::now();
+    enabled_.store(buffer_size > 0, std::memory_order_relaxed);
+}
+
+Tracer::ThreadRing& Tracer::GetThreadRing() {
+    thread_local ThreadRing* ring = nullptr;
+
+    if (ring == nullptr) {
+        auto new_ring = std::make_unique<ThreadRing>();
+        new_ring->spans.resize(buffer_size_);
+        ring = new_ring.get();
+
+        // Буферы живут до конца программы, чтобы отрезки завершившихся потоков попали в выгрузку
+        std::lock_guard lock{rings_mutex_};
+        new_ring->tid = rings_.size() + 1;
+        rings_.push_back(std::move(new_ring));
+    }
+    return *ring;
+}
+
+void Tracer::Record(const char* name, uint64_t id, Clock::time_point start, Clock::time_point end,
+                    std::string_view detail) {
+    if (!IsEnabled() || start == Clock::time_point{}) {
+        return;
+    }
+
+    ThreadRing& ring = GetThreadRing();
+    std::lock_guard lock{ring.mutex};
+
+    SpanRecord& span = ring.spans[ring.next];
+    span.name = name;
+    span.id = id;
+    span.start = start;
+    span.duration = end - start;
+
+    const size_t length = std::min(detail.size(), span.detail.size() - 1);
+    std::copy_n(detail.data(), length, span.detail.data());
+    span.detail[length] = '\0';
+
+    if (++ring.next == ring.spans.size()) {
+        ring.next = 0;
+        ring.wrapped = true;
+    }
+}
+
+std::string Tracer::DumpChromeTrace() const {
+    using std::chrono::duration;
+    using Micros = duration<double, std::micro>;
+
+    std::ostringstream out;
+    out.precision(3);
+    out << std::fixed << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    bool first = true;
+    auto write_span = [&](const SpanRecord& span, size_t tid) {
+        out << (first ? "" : ",") << "{\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+            << ",\"name\":\"" << span.name << "\""
+            << ",\"ts\":" << Micros(span.start - epoch_).count()
+            << ",\"dur\":" << Micros(span.duration).count()
+            << ",\"args\":{\"id\":" << span.id;
+        if (span.detail[0] != '\0') {
+            out << ",\"detail\":\"";
+            WriteEscaped(out, span.detail.data());
+            out << "\"";
+        }
+        out << "}}";
+        first = false;
+    };
+
+    std::lock_guard rings_lock{rings_mutex_};
+    for (const auto& ring : rings_) {
+        std::lock_guard lock{ring->mutex};
+
+        // Сначала самые старые отрезки: после переполнения они начинаются с позиции next
+        const size_t begin = ring->wrapped ? ring->next : 0;
+        const size_t count = ring->wrapped ? ring->spans.size() : ring->next;
+        for (size_t i = 0; i < count; ++i) {
+            write_span(ring->spans[(begin + i) % ring->spans.size()], ring->tid);
+        }
+    }
+
+    out << "]}";
+    return out.str();
+}
+
+uint64_t CurrentId() {
+    return current_id;
+}
+
+ScopedId::ScopedId(uint64_t id)
+    : previous_{current_id} {
+    current_id = id;
+}
+
+ScopedId::~ScopedId() {
+    current_id = previous_;
+}
+
+} // namespace tracing
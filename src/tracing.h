@@ -0,0 +1,140 @@
+#ifndef __TRACING__
+#define __TRACING__
+
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tracing {
+
+using Clock = std::chrono::steady_clock;
+
+struct SpanRecord {
+    const char* name = nullptr;         // только строковые литералы
+    std::array<char, 24> detail{};      // короткая подпись, например id карты
+    uint64_t id = 0;                    // номер запроса или тика, к которому относится отрезок
+    Clock::time_point start;
+    Clock::duration duration{};
+};
+
+// Трассировка запросов и тиков. Каждый поток пишет отрезки в свой кольцевой буфер,
+// /admin/trace выгружает их в формате Chrome trace-event (открывается в Perfetto или chrome://tracing)
+class Tracer {
+public:
+    static Tracer& Instance() {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    // Вызывается до запуска рабочих потоков. buffer_size - отрезков на поток, 0 - трассировка выключена
+    void Enable(size_t buffer_size);
+
+    bool IsEnabled() const {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t NextId() {
+        return next_id_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Отрезок, начало и конец которого измерены в разных местах (например, ожидание в strand)
+    void Record(const char* name, uint64_t id, Clock::time_point start, Clock::time_point end,
+                std::string_view detail = {});
+
+    std::string DumpChromeTrace() const;
+
+private:
+    Tracer() = default;
+
+    // Пишет только поток-владелец, мьютекс почти всегда свободен и нужен для выгрузки
+    struct ThreadRing {
+        mutable std::mutex mutex;
+        std::vector<SpanRecord> spans;
+        size_t next = 0;
+        bool wrapped = false;
+        size_t tid = 0;
+    };
+
+    ThreadRing& GetThreadRing();
+
+    std::atomic<bool> enabled_{false};
+    std::atomic<uint64_t> next_id_{1};
+    size_t buffer_size_ = 0;
+    Clock::time_point epoch_;
+
+    mutable std::mutex rings_mutex_;
+    std::vector<std::unique_ptr<ThreadRing>> rings_;
+};
+
+// Номер запроса, который сейчас обрабатывает поток (0 - вне запроса)
+uint64_t CurrentId();
+
+// Устанавливает номер текущего запроса на время жизни объекта
+class ScopedId {
+public:
+    explicit ScopedId(uint64_t id);
+    ~ScopedId();
+
+    ScopedId(const ScopedId&) = delete;
+    ScopedId& operator=(const ScopedId&) = delete;
+
+private:
+    uint64_t previous_;
+};
+
+// Отрезок от создания до разрушения объекта. При выключенной трассировке ничего не измеряет
+class Span {
+public:
+    explicit Span(const char* name, std::string_view detail = {})
+        : Span(name, CurrentId(), detail) {}
+
+    Span(const char* name, uint64_t id, std::string_view detail = {})
+        : name_{name}, id_{id}, detail_{detail} {
+        if (Tracer::Instance().IsEnabled()) {
+            start_ = Clock::now();
+        }
+    }
+
+    ~Span() {
+        if (start_ != Clock::time_point{}) {
+            Tracer::Instance().Record(name_, id_, start_, Clock::now(), detail_);
+        }
+    }
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+private:
+    const char* name_;
+    uint64_t id_;
+    std::string_view detail_;
+    Clock::time_point start_;
+};
+
+// Время начала отрезка или пустое значение, если трассировка выключена
+inline Clock::time_point Now() {
+    return Tracer::Instance().IsEnabled() ? Clock::now() : Clock::time_point{};
+}
+
+// Завершает отрезок, начатый с помощью Now()
+inline void Complete(const char* name, uint64_t id, Clock::time_point start, std::string_view detail = {}) {
+    if (start != Clock::time_point{}) {
+        Tracer::Instance().Record(name, id, start, Clock::now(), detail);
+    }
+}
+
+} // namespace tracing
+
+#endif
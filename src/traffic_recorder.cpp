@@ -0,0 +1,185 @@
+#include "traffic_recorder.h"
+
+#include <boost/json.hpp>
+#include <charconv>
+#include <map>
+#include <stdexcept>
+
+namespace recording {
+
+using namespace std::literals;
+
+namespace {
+
+constexpr std::string_view MAGIC = "GTRC"sv;
+// 2: хеш ответа /state считается по игрокам, упорядоченным по id (HashResponse)
+constexpr uint32_t VERSION = 2;
+
+// Ограничения на размеры полей защищают replay от повреждённого файла
+constexpr uint32_t MAX_BODY_SIZE = 16 * 1024 * 1024;
+
+template <typename T>
+void WriteInt(std::ostream& out, T value) {
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        out.put(static_cast<char>((static_cast<uint64_t>(value) >> (i * 8)) & 0xFF));
+    }
+}
+
+template <typename T>
+bool ReadInt(std::istream& in, T& value) {
+    uint64_t result = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        const int byte = in.get();
+        if (byte == std::char_traits<char>::eof()) {
+            return false;
+        }
+        result |= static_cast<uint64_t>(byte) << (i * 8);
+    }
+    value = static_cast<T>(result);
+    return true;
+}
+
+template <typename Size>
+void WriteString(std::ostream& out, std::string_view str) {
+    WriteInt<Size>(out, static_cast<Size>(str.size()));
+    out.write(str.data(), static_cast<std::streamsize>(str.size()));
+}
+
+template <typename Size>
+bool ReadString(std::istream& in, std::string& str) {
+    Size size = 0;
+    if (!ReadInt(in, size) || size > MAX_BODY_SIZE) {
+        return false;
+    }
+    str.resize(size);
+    return static_cast<bool>(in.read(str.data(), size));
+}
+
+} // namespace
+
+void WriteHeader(std::ostream& out) {
+    out.write(MAGIC.data(), MAGIC.size());
+    WriteInt(out, VERSION);
+}
+
+bool ReadHeader(std::istream& in) {
+    std::string magic(MAGIC.size(), '\0');
+    uint32_t version = 0;
+    return in.read(magic.data(), magic.size()) && magic == MAGIC && ReadInt(in, version) && version == VERSION;
+}
+
+void WriteRecord(std::ostream& out, const RecordedRequest& record) {
+    WriteInt(out, record.arrival_us);
+    WriteInt(out, record.method);
+    WriteInt(out, record.status);
+    WriteInt(out, record.token);
+    WriteInt(out, record.issued_token);
+    WriteInt(out, record.response_hash);
+    WriteString<uint16_t>(out, record.target);
+    WriteString<uint16_t>(out, record.content_type);
+    WriteString<uint32_t>(out, record.body);
+}
+
+std::optional<RecordedRequest> ReadRecord(std::istream& in) {
+    RecordedRequest record;
+    if (ReadInt(in, record.arrival_us)
+        && ReadInt(in, record.method)
+        && ReadInt(in, record.status)
+        && ReadInt(in, record.token)
+        && ReadInt(in, record.issued_token)
+        && ReadInt(in, record.response_hash)
+        && ReadString<uint16_t>(in, record.target)
+        && ReadString<uint16_t>(in, record.content_type)
+        && ReadString<uint32_t>(in, record.body)) {
+        return record;
+    }
+    return std::nullopt;
+}
+
+uint64_t HashBody(std::string_view body) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : body) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+uint64_t HashResponse(std::string_view target, std::string_view body) {
+    if (!target.starts_with("/api/v1/game/state"sv)) {
+        return HashBody(body);
+    }
+
+    boost::system::error_code ec;
+    auto json = boost::json::parse(body, ec);
+    const boost::json::object* players = nullptr;
+    if (!ec && json.is_object()) {
+        if (auto* value = json.as_object().if_contains("players"); value != nullptr && value->is_object()) {
+            players = &value->as_object();
+        }
+    }
+    if (players == nullptr) {
+        return HashBody(body);
+    }
+
+    std::map<uint64_t, std::string> sorted;
+    for (const auto& item : *players) {
+        const std::string_view id = item.key();
+        uint64_t key = 0;
+        std::from_chars(id.data(), id.data() + id.size(), key);
+        sorted.emplace(key, std::string(id) + ':' + boost::json::serialize(item.value()));
+    }
+    std::string canonical;
+    for (const auto& [key, player] : sorted) {
+        canonical += player;
+        canonical += '\n';
+    }
+    return HashBody(canonical);
+}
+
+// ------------------------------ TrafficRecorder ------------------------------
+TrafficRecorder::TrafficRecorder(const std::filesystem::path& path)
+    : out_{path, std::ios::binary | std::ios::trunc}
+    , start_{std::chrono::steady_clock::now()} {
+    if (!out_) {
+        throw std::runtime_error("Can't open record file "s + path.string());
+    }
+    WriteHeader(out_);
+}
+
+uint64_t TrafficRecorder::Now() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_).count();
+}
+
+uint32_t TrafficRecorder::Placeholder(std::string_view token) {
+    if (token.empty()) {
+        return RecordedRequest::NO_TOKEN;
+    }
+    auto [it, inserted] = placeholders_.try_emplace(std::string(token), static_cast<uint32_t>(placeholders_.size() + 1));
+    return it->second;
+}
+
+void TrafficRecorder::Record(RecordedRequest request, std::string_view auth_token, std::optional<std::string_view> response_body) {
+    std::lock_guard lock{mutex_};
+
+    request.token = Placeholder(auth_token);
+
+    // Ответ на join содержит новый токен: его значение при воспроизведении будет другим,
+    // поэтому тело не сравниваем, а запоминаем заместитель
+    if (request.target.starts_with("/api/v1/game/join"sv) && response_body.has_value()) {
+        boost::system::error_code ec;
+        auto json = boost::json::parse(*response_body, ec);
+        if (!ec && json.is_object()) {
+            if (auto* token = json.as_object().if_contains("authToken"); token != nullptr && token->is_string()) {
+                request.issued_token = Placeholder(token->as_string());
+            }
+        }
+    }
+    request.response_hash = request.issued_token == RecordedRequest::NO_TOKEN && response_body.has_value()
+        ? HashResponse(request.target, *response_body) : 0;
+
+    // Файл дописывается буферами ofstream и сбрасывается при остановке сервера
+    WriteRecord(out_, request);
+}
+
+} // namespace recording
@@ -0,0 +1,77 @@
+#ifndef __TRAFFIC_RECORDER__
+#define __TRAFFIC_RECORDER__
+
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <istream>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace recording {
+
+// Один API-запрос в записи. Токены заменены на номера-заместители: сервер при воспроизведении
+// выдаст другие токены, и replay подставит их вместо заместителей
+struct RecordedRequest {
+    static constexpr uint32_t NO_TOKEN = 0;
+
+    uint64_t arrival_us = 0;        // от начала записи
+    uint8_t method = 0;             // http::verb
+    uint16_t status = 0;            // код ответа при записи
+    uint32_t token = NO_TOKEN;      // заместитель токена из Authorization
+    uint32_t issued_token = NO_TOKEN;  // заместитель токена, выданного в ответе на join
+    uint64_t response_hash = 0;     // хеш тела ответа (0 - не сравнивается)
+    std::string target;
+    std::string content_type;
+    std::string body;
+};
+
+// Формат файла: сигнатура и версия, затем записи подряд (little-endian, длины перед строками)
+void WriteHeader(std::ostream& out);
+bool ReadHeader(std::istream& in);
+void WriteRecord(std::ostream& out, const RecordedRequest& record);
+std::optional<RecordedRequest> ReadRecord(std::istream& in);
+
+// FNV-1a: достаточно, чтобы заметить расхождение состояния при воспроизведении
+uint64_t HashBody(std::string_view body);
+
+// Хеш ответа на запрос target. Псы в /state идут в порядке unordered_map, который при воспроизведении
+// может быть другим, поэтому их хеш считается по игрокам, упорядоченным по id
+uint64_t HashResponse(std::string_view target, std::string_view body);
+
+// Пишет API-запросы в порядке их выполнения в strand игры, поэтому повторное последовательное
+// воспроизведение приводит модель к тому же состоянию
+class TrafficRecorder {
+public:
+    explicit TrafficRecorder(const std::filesystem::path& path);
+
+    TrafficRecorder(const TrafficRecorder&) = delete;
+    TrafficRecorder& operator=(const TrafficRecorder&) = delete;
+
+    // Время прихода запроса относительно начала записи
+    uint64_t Now() const;
+
+    // request.token и request.issued_token заполняются здесь по исходным токенам.
+    // Без response_body (потоковый ответ) тело при воспроизведении не сравнивается
+    void Record(RecordedRequest request, std::string_view auth_token, std::optional<std::string_view> response_body);
+
+private:
+    uint32_t Placeholder(std::string_view token);
+
+    std::mutex mutex_;
+    std::ofstream out_;
+    std::chrono::steady_clock::time_point start_;
+    std::unordered_map<std::string, uint32_t> placeholders_;
+};
+
+} // namespace recording
+
+#endif
@@ -7,7 +7,12 @@
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
 #include <boost/json.hpp>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <string_view>
 #include "response_maker.h"
+#include "api_router.h"
 
 namespace http_handler {
 
@@ -15,72 +20,71 @@ namespace beast = boost::beast;
 namespace http = beast::http;
 namespace json = boost::json;
 
+std::string_view ExtractAuthToken(std::string_view authorization);
+
+// Представление API-запроса поверх запроса Beast.
+// Target, заголовки, токен и тело не копируются, а хранятся как string_view на исходный запрос,
+// который удерживается через owner_. Тело JSON разбирается один раз и отдаётся по ссылке
 class URI_Request {
     // using namespace std::literals;
 public:
     template <typename Body, typename Allocator>
-    void ParceURI(http::request<Body, http::basic_fields<Allocator>>&& req) {
+    void ParceURI(std::shared_ptr<const http::request<Body, http::basic_fields<Allocator>>> req) {
         response_status_ = http::status::ok;
-        method_ = req.method();
-        http_version_ = req.version();
-        keep_alive_ = req.keep_alive();
-
-        std::string req_body;
+        method_ = req->method();
+        http_version_ = req->version();
+        keep_alive_ = req->keep_alive();
 
-        // отдельно для конкретной карты в body закидываем искомую map_id, в target оставляем только "/api/v1/maps/"
-        if (req.target().starts_with("/api/v1/maps/")) {
-            target_ = req.target();
+        target_ = req->target();
+        raw_body_ = req->body();
 
-            std::string map_id = target_.substr(target_.find_last_of('/') + 1);
-            target_ = "/api/v1/maps/";
-            body_ = {{"map_id", map_id}};
-            return ;
+        // Если запрос размещён в арене соединения, ответ и разобранный JSON тоже берут память оттуда
+        if constexpr (std::is_same_v<Allocator, ArenaAllocator>) {
+            arena_ = req->get_allocator().resource();
         }
 
-        target_ = req.target();
-
-        req_body = req.body();
-        if (!req_body.empty()) {
-            body_ = json::parse(req_body);
+        // Некорректный JSON не бросает исключение: тело остаётся null, и обработчик вернёт invalidArgument
+        if (!raw_body_.empty()) {
+            boost::system::error_code ec;
+            body_ = json::parse(raw_body_, ec, MakeJsonStorage());
+            if (ec) {
+                body_ = nullptr;
+            }
         }
 
         // пытаемся считать токен авторизации. Если его нет строка пустая
-        try {
-            auth_token_ = req.at("authorization");
-            auth_token_ = auth_token_.substr(auth_token_.find_last_of(' ') + 1);
-            if (auth_token_ == "Bearer") {
-                throw std::invalid_argument("");
-            }
-        }
-        catch(...) {
-            auth_token_ = "";
+        if (auto it = req->find(http::field::authorization); it != req->end()) {
+            auth_token_ = ExtractAuthToken(it->value());
         }
 
         //  пытаемся считать content_type. Если его нет строка пустая
-        try {
-            content_type_ = req.at("content-type");
-        }
-        catch(...) {
-            content_type_ = "";
+        if (auto it = req->find(http::field::content_type); it != req->end()) {
+            content_type_ = it->value();
         }
+
+        owner_ = std::move(req);
     }
 
     http::verb GetMethod() const {
         return method_;
     }
 
-    std::string GetTarget() const {
+    std::string_view GetTarget() const {
         return target_;
     }
 
-    std::string GetAuthToken() const {
+    std::string_view GetAuthToken() const {
         return auth_token_;
     }
 
-    json::value GetBody() const  {
+    const json::value& GetBody() const  {
         return body_;
     }
 
+    std::string_view GetRawBody() const {
+        return raw_body_;
+    }
+
     unsigned GetHttpVersion() const {
         return http_version_;
     }
@@ -93,7 +97,7 @@ public:
         return response_status_;
     }
 
-    std::string GetContentType() const {
+    std::string_view GetContentType() const {
         return content_type_;
     }
 
@@ -101,17 +105,51 @@ public:
         response_status_ = status;
     }
 
+    // Аллокатор для ответа: память освободится вместе с запросом после записи ответа
+    ArenaAllocator GetAllocator() const {
+        return arena_ != nullptr ? ArenaAllocator{arena_} : ArenaAllocator{};
+    }
+
+    // Параметры пути, найденные маршрутизатором (например, map_id)
+    const RouteParams& GetRouteParams() const {
+        return route_params_;
+    }
+
+    void SetRouteParams(const RouteParams& params) {
+        route_params_ = params;
+    }
+
 private:
+    // Тело JSON разбирается в monotonic_resource, начальный буфер которого взят из арены.
+    // Размер с запасом: разобранное дерево обычно в несколько раз больше исходного текста
+    json::storage_ptr MakeJsonStorage() {
+        if (arena_ == nullptr) {
+            json_resource_.emplace();
+        } else {
+            const size_t size = raw_body_.size() * 4 + 256;
+            auto* buffer = static_cast<unsigned char*>(arena_->allocate(size, alignof(std::max_align_t)));
+            json_resource_.emplace(buffer, size);
+        }
+        return json::storage_ptr(&*json_resource_);
+    }
+
+    // все string_view ниже указывают внутрь этого запроса
+    std::shared_ptr<const void> owner_;
+    std::pmr::memory_resource* arena_ = nullptr;
+    std::optional<json::monotonic_resource> json_resource_;
+
     http::verb method_;
-    std::string target_;
+    std::string_view target_;
+    std::string_view raw_body_;
     json::value body_;
-    std::string auth_token_;
-    std::string content_type_;
+    std::string_view auth_token_;
+    std::string_view content_type_;
 
     unsigned http_version_;
     bool keep_alive_;
     http::status response_status_;
+    RouteParams route_params_;
 };
 } // namespace http_handler
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,392 @@
+#include "wal.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "logger.h"
+#include "snapshot.h"
+
+namespace wal {
+
+using namespace std::literals;
+namespace fs = std::filesystem;
+
+enum class RecordType : uint8_t {
+    JOIN = 1,          // вход в единственный экземпляр карты (журналы до появления экземпляров)
+    MOVE = 2,
+    TICK = 3,
+    JOIN_INSTANCE = 4  // вход в экземпляр карты с указанным номером
+};
+
+namespace {
+
+constexpr size_t HEADER_SIZE = 2 * sizeof(uint32_t);
+
+uint32_t Checksum(std::string_view data) {
+    uint32_t hash = 2166136261u;
+    for (unsigned char ch : data) {
+        hash = (hash ^ ch) * 16777619u;
+    }
+    return hash;
+}
+
+std::string SegmentName(uint64_t first_seq) {
+    std::string number = std::to_string(first_seq);
+    // Номер дополняется нулями, чтобы сегменты сортировались по имени
+    return "wal-"s + std::string(20 - number.size(), '0') + number + ".log"s;
+}
+
+struct Segment {
+    uint64_t first_seq;
+    fs::path path;
+};
+
+std::vector<Segment> ListSegments(const fs::path& dir) {
+    std::vector<Segment> segments;
+    if (!fs::exists(dir)) {
+        return segments;
+    }
+
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        const std::string name = entry.path().filename().string();
+        if (!entry.is_regular_file() || !name.starts_with("wal-"sv) || !name.ends_with(".log"sv)) {
+            continue;
+        }
+        segments.push_back({std::stoull(name.substr(4, name.size() - 8)), entry.path()});
+    }
+    std::sort(segments.begin(), segments.end(), [](const Segment& lhs, const Segment& rhs) {
+        return lhs.first_seq < rhs.first_seq;
+    });
+    return segments;
+}
+
+void SyncDirectory(const fs::path& dir) {
+    const int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+}
+
+} // namespace
+
+Durability ParseDurability(std::string_view name) {
+    if (name == "group"sv) {
+        return Durability::GROUP;
+    }
+    if (name == "async"sv) {
+        return Durability::ASYNC;
+    }
+    throw std::invalid_argument("Unknown WAL durability: "s + std::string(name));
+}
+
+// ------------------------------ WalWriter ------------------------------
+WalWriter::WalWriter(WalOptions options, uint64_t next_seq)
+    : options_{std::move(options)} {
+    auto& registry = metrics::Registry::Instance();
+    records_ = registry.AddCounter("wal_records_total"sv, "Game changes appended to the write-ahead log"sv);
+    batches_ = registry.AddCounter("wal_batches_total"sv, "Write-ahead log batches written with one write call"sv);
+    sync_duration_ = registry.AddHistogram("wal_sync_duration_seconds"sv, "Time spent in fdatasync of the write-ahead log"sv);
+    write_errors_ = registry.AddCounter("wal_write_errors_total"sv, "Failed write-ahead log batches, retried with later changes"sv);
+
+    fs::create_directories(options_.dir);
+    OpenSegment(next_seq);
+    thread_ = std::thread([this] {
+        Run();
+    });
+}
+
+WalWriter::~WalWriter() {
+    Stop();
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+binary_io::Writer WalWriter::BeginRecord(uint64_t seq, RecordType type) {
+    record_.assign(HEADER_SIZE, '\0');
+    binary_io::Writer writer{record_};
+    writer.Write(seq);
+    writer.Write(static_cast<uint8_t>(type));
+    return writer;
+}
+
+void WalWriter::Append(uint64_t seq) {
+    const std::string_view payload = std::string_view(record_).substr(HEADER_SIZE);
+    const uint32_t header[] = {static_cast<uint32_t>(payload.size()), Checksum(payload)};
+    std::memcpy(record_.data(), header, HEADER_SIZE);
+
+    {
+        std::lock_guard lock{mutex_};
+        if (pending_.empty()) {
+            pending_first_seq_ = seq;
+        }
+        pending_ += record_;
+    }
+    records_.Inc();
+}
+
+void WalWriter::OnPlayerJoined(uint64_t seq, const std::string& map_id, uint32_t instance, const model::PlayerSnapshot& player) {
+    binary_io::Writer writer = BeginRecord(seq, RecordType::JOIN_INSTANCE);
+    writer.WriteString<uint16_t>(map_id);
+    writer.Write(instance);
+    snapshot::WritePlayer(writer, player);
+    Append(seq);
+}
+
+void WalWriter::OnPlayerMoved(uint64_t seq, std::string_view token, std::string_view direction) {
+    binary_io::Writer writer = BeginRecord(seq, RecordType::MOVE);
+    writer.WriteString<uint8_t>(token);
+    writer.WriteString<uint8_t>(direction);
+    Append(seq);
+}
+
+void WalWriter::OnTick(uint64_t seq, int time_delta) {
+    binary_io::Writer writer = BeginRecord(seq, RecordType::TICK);
+    writer.Write<int32_t>(time_delta);
+    Append(seq);
+
+    // Граница тика: всё, что изменилось за тик, уходит на диск одной пачкой
+    {
+        std::lock_guard lock{mutex_};
+        wake_ = true;
+    }
+    cv_.notify_one();
+}
+
+void WalWriter::Checkpoint(uint64_t last_event) {
+    {
+        std::lock_guard lock{mutex_};
+        checkpoint_ = std::max(checkpoint_, last_event);
+    }
+    cv_.notify_one();
+}
+
+void WalWriter::Stop() {
+    {
+        std::lock_guard lock{mutex_};
+        if (stopping_) {
+            return;
+        }
+        stopping_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+}
+
+void WalWriter::Run() {
+    // Пачка, которую не удалось записать, остаётся здесь и повторяется вместе с новыми изменениями:
+    // журнал не может продолжиться за пропущенными записями
+    std::string batch;
+    uint64_t first_seq = 0;
+    uint64_t checkpoint = 0;
+
+    while (true) {
+        bool stopping = false;
+        {
+            std::unique_lock lock{mutex_};
+            cv_.wait_for(lock, options_.flush_period, [this] {
+                return wake_ || stopping_ || checkpoint_ != 0;
+            });
+            wake_ = false;
+            if (!pending_.empty()) {
+                if (batch.empty()) {
+                    first_seq = pending_first_seq_;
+                }
+                batch += pending_;
+                pending_.clear();
+            }
+            checkpoint = std::max(checkpoint, std::exchange(checkpoint_, 0));
+            stopping = stopping_;
+        }
+
+        if (!batch.empty()) {
+            try {
+                WriteBatch(batch, first_seq);
+                batch.clear();
+            } catch (const std::exception& ex) {
+                write_errors_.Inc();
+                boost::json::value custom_data{{"dir"s, options_.dir.string()}, {"exception"s, ex.what()},
+                                               {"pending_bytes"s, batch.size()}};
+                logger::LogJSON(custom_data, stopping ? "wal write failed, changes lost"sv : "wal write failed, will retry"sv);
+            }
+        }
+
+        // Пока пачка не записана, сегменты не удаляются и новый не начинается
+        if (checkpoint != 0 && batch.empty()) {
+            RemoveSegments(std::exchange(checkpoint, 0));
+            rotate_ = true;
+        }
+
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+void WalWriter::WriteBatch(const std::string& batch, uint64_t first_seq) {
+    // Прошлая запись оборвалась: отрезаем её хвост, иначе посреди сегмента останется битая запись
+    if (dirty_) {
+        if (::ftruncate(fd_, static_cast<off_t>(segment_bytes_)) != 0) {
+            throw std::system_error(errno, std::generic_category(), "truncate wal");
+        }
+        dirty_ = false;
+    }
+    if (rotate_ || segment_bytes_ >= options_.segment_size) {
+        OpenSegment(first_seq);
+    }
+
+    // segment_bytes_ растёт только после успешной записи и сброса - это последняя целая граница сегмента
+    dirty_ = true;
+    binary_io::WriteAll(fd_, batch);
+
+    if (options_.durability == Durability::GROUP) {
+        const auto start = std::chrono::steady_clock::now();
+        if (::fdatasync(fd_) != 0) {
+            throw std::system_error(errno, std::generic_category(), "fdatasync wal");
+        }
+        sync_duration_.Observe(std::chrono::steady_clock::now() - start);
+    }
+    dirty_ = false;
+    segment_bytes_ += batch.size();
+    batches_.Inc();
+}
+
+void WalWriter::OpenSegment(uint64_t first_seq) {
+    const fs::path path = options_.dir / SegmentName(first_seq);
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "open "s + path.string());
+    }
+
+    struct stat st{};
+    ::fstat(fd, &st);
+
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+    fd_ = fd;
+    segment_first_seq_ = first_seq;
+    segment_bytes_ = static_cast<size_t>(st.st_size);
+    rotate_ = false;
+
+    // Новый файл переживёт сбой, только если сброшена и запись о нём в каталоге
+    if (options_.durability == Durability::GROUP) {
+        SyncDirectory(options_.dir);
+    }
+}
+
+void WalWriter::RemoveSegments(uint64_t last_event) {
+    try {
+        const std::vector<Segment> segments = ListSegments(options_.dir);
+        // Сегмент целиком вошёл в снимок, если следующий начинается не позже last_event + 1
+        for (size_t i = 0; i + 1 < segments.size(); ++i) {
+            if (segments[i].first_seq == segment_first_seq_ || segments[i + 1].first_seq > last_event + 1) {
+                break;
+            }
+            fs::remove(segments[i].path);
+        }
+    } catch (const std::exception& ex) {
+        boost::json::value custom_data{{"dir"s, options_.dir.string()}, {"exception"s, ex.what()}};
+        logger::LogJSON(custom_data, "wal cleanup failed"sv);
+    }
+}
+
+// ------------------------------ Replay ------------------------------
+namespace {
+
+// false, если изменение уже есть в игре (вошло в снимок)
+bool ApplyRecord(std::string_view payload, model::Game& game) {
+    binary_io::Reader reader{payload};
+    const auto seq = reader.Read<uint64_t>();
+    const auto type = static_cast<RecordType>(reader.Read<uint8_t>());
+
+    if (seq <= game.GetLastEvent()) {
+        return false;
+    }
+    if (seq != game.GetLastEvent() + 1) {
+        throw std::runtime_error("Write-ahead log has a gap before change "s + std::to_string(seq));
+    }
+
+    switch (type) {
+        case RecordType::JOIN:
+        case RecordType::JOIN_INSTANCE: {
+            std::string map_id{reader.ReadString<uint16_t>()};
+            const uint32_t instance = type == RecordType::JOIN_INSTANCE ? reader.Read<uint32_t>() : 0;
+            game.ReplayJoin(seq, map_id, instance, snapshot::ReadPlayer(reader));
+            break;
+        }
+        case RecordType::MOVE: {
+            std::string_view token = reader.ReadString<uint8_t>();
+            game.ReplayMove(seq, token, std::string(reader.ReadString<uint8_t>()));
+            break;
+        }
+        case RecordType::TICK:
+            game.ReplayTick(seq, reader.Read<int32_t>());
+            break;
+        default:
+            throw std::runtime_error("Unknown write-ahead log record type"s);
+    }
+    return true;
+}
+
+} // namespace
+
+ReplayResult Replay(const fs::path& dir, model::Game& game) {
+    ReplayResult result;
+    const std::vector<Segment> segments = ListSegments(dir);
+
+    for (size_t i = 0; i < segments.size(); ++i) {
+        std::ifstream file{segments[i].path, std::ios::binary | std::ios::ate};
+        std::string data(static_cast<size_t>(file.tellg()), '\0');
+        file.seekg(0);
+        if (!file.read(data.data(), static_cast<std::streamsize>(data.size()))) {
+            throw std::runtime_error("Can't read write-ahead log "s + segments[i].path.string());
+        }
+
+        binary_io::Reader reader{data};
+        while (!reader.AtEnd()) {
+            const size_t record_start = reader.Offset();
+            std::string_view payload;
+            try {
+                const auto size = reader.Read<uint32_t>();
+                const auto checksum = reader.Read<uint32_t>();
+                payload = reader.Take(size);
+                if (Checksum(payload) != checksum) {
+                    payload = {};
+                }
+            } catch (const std::out_of_range&) {
+                payload = {};
+            }
+
+            if (payload.empty()) {
+                if (i + 1 != segments.size()) {
+                    throw std::runtime_error("Corrupted write-ahead log "s + segments[i].path.string());
+                }
+                // Запись оборвалась при сбое - отрезаем её, чтобы новые сегменты шли сразу за целыми данными
+                fs::resize_file(segments[i].path, record_start);
+                result.truncated = true;
+                break;
+            }
+
+            if (ApplyRecord(payload, game)) {
+                ++result.applied;
+            }
+        }
+    }
+
+    result.last_event = game.GetLastEvent();
+    return result;
+}
+
+} // namespace wal
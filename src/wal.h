@@ -0,0 +1,120 @@
+#ifndef __WAL__
+#define __WAL__
+
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "binary_io.h"
+#include "metrics.h"
+#include "model.h"
+
+namespace wal {
+
+// Когда изменения считаются сохранёнными
+enum class Durability {
+    GROUP,  // каждая пачка записывается и сбрасывается на диск (fdatasync) одним вызовом
+    ASYNC   // пачка только записывается в файл, на диск её сбрасывает ОС
+};
+
+Durability ParseDurability(std::string_view name);
+
+// Тип изменения в записи журнала
+enum class RecordType : uint8_t;
+
+struct WalOptions {
+    std::filesystem::path dir;
+    Durability durability = Durability::GROUP;
+    // Как часто сбрасывать накопленное, если тиков нет (тики будят поток записи сразу)
+    std::chrono::milliseconds flush_period{20};
+    // После этого размера следующая пачка начинает новый сегмент
+    size_t segment_size = 64 << 20;
+};
+
+// Журнал упреждающей записи. Изменения сериализуются в strand в общий буфер - это только
+// копирование в память, - а фоновый поток забирает всё накопленное пачкой, записывает одним
+// вызовом write и один раз вызывает fdatasync (групповая фиксация). Обработчики запросов
+// диска не ждут.
+// Если запись или сброс пачки не удались, сегмент обрезается до последней целой пачки, а пачка
+// повторяется вместе со следующими изменениями: за неудачной пачкой журнал не продолжается
+// Журнал лежит в каталоге сегментами wal-<номер первого изменения>.log. Запись в сегменте:
+// длина (u32), контрольная сумма (u32), затем номер изменения (u64), тип и его поля
+class WalWriter : public model::GameEventListener {
+public:
+    // next_seq - номер следующего изменения игры, с него начинается новый сегмент
+    WalWriter(WalOptions options, uint64_t next_seq);
+    ~WalWriter();
+
+    WalWriter(const WalWriter&) = delete;
+    WalWriter& operator=(const WalWriter&) = delete;
+
+    void OnPlayerJoined(uint64_t seq, const std::string& map_id, uint32_t instance, const model::PlayerSnapshot& player) override;
+    void OnPlayerMoved(uint64_t seq, std::string_view token, std::string_view direction) override;
+    void OnTick(uint64_t seq, int time_delta) override;
+
+    // Снимок с изменениями до last_event включительно сохранён: сегменты, целиком в него
+    // вошедшие, удаляются, а следующая пачка начинает новый сегмент. Безопасно из любого потока
+    void Checkpoint(uint64_t last_event);
+
+    // Записывает всё накопленное и останавливает поток
+    void Stop();
+
+private:
+    // Начинает запись в record_, Append дописывает заголовок и переносит её в общий буфер
+    binary_io::Writer BeginRecord(uint64_t seq, RecordType type);
+    void Append(uint64_t seq);
+    void Run();
+    void WriteBatch(const std::string& batch, uint64_t first_seq);
+    void OpenSegment(uint64_t first_seq);
+    void RemoveSegments(uint64_t last_event);
+
+    WalOptions options_;
+    // Собирается в strand
+    std::string record_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::string pending_;
+    uint64_t pending_first_seq_ = 0;
+    uint64_t checkpoint_ = 0;
+    bool wake_ = false;
+    bool stopping_ = false;
+
+    // Принадлежат потоку записи
+    int fd_ = -1;
+    uint64_t segment_first_seq_ = 0;
+    size_t segment_bytes_ = 0;
+    // Последняя пачка записана не целиком: перед следующей сегмент обрезается до segment_bytes_
+    bool dirty_ = false;
+    bool rotate_ = false;
+
+    metrics::Counter records_;
+    metrics::Counter batches_;
+    metrics::Histogram sync_duration_;
+    metrics::Counter write_errors_;
+
+    std::thread thread_;
+};
+
+struct ReplayResult {
+    uint64_t applied = 0;      // применено изменений
+    uint64_t last_event = 0;   // номер последнего изменения в игре после повтора
+    bool truncated = false;    // конец журнала был повреждён и отрезан
+};
+
+// Применяет к игре изменения из журнала с номерами больше game.GetLastEvent().
+// Недописанный хвост последнего сегмента (падение посреди записи) отрезается,
+// повреждение в середине журнала - std::runtime_error
+ReplayResult Replay(const std::filesystem::path& dir, model::Game& game);
+
+} // namespace wal
+
+#endif
@@ -0,0 +1,40 @@
+#include <catch2/catch.hpp>
+
+#include "admin_access.h"
+
+namespace {
+
+using namespace std::literals;
+using http_handler::AdminAccess;
+namespace net = boost::asio;
+
+} // namespace
+
+TEST_CASE("Without a token admin endpoints answer only loopback clients") {
+    const AdminAccess access;
+
+    CHECK(access.Check(std::nullopt, net::ip::make_address("127.0.0.1")) == AdminAccess::Verdict::ALLOWED);
+    CHECK(access.Check(std::nullopt, net::ip::make_address("127.1.2.3")) == AdminAccess::Verdict::ALLOWED);
+    CHECK(access.Check(std::nullopt, net::ip::make_address("::1")) == AdminAccess::Verdict::ALLOWED);
+    CHECK(access.Check(std::nullopt, net::ip::make_address("::ffff:127.0.0.1")) == AdminAccess::Verdict::ALLOWED);
+
+    CHECK(access.Check(std::nullopt, net::ip::make_address("10.0.0.5")) == AdminAccess::Verdict::FORBIDDEN);
+    CHECK(access.Check(std::nullopt, net::ip::make_address("::ffff:10.0.0.5")) == AdminAccess::Verdict::FORBIDDEN);
+    // Чужой токен не открывает доступ, если сервер токен не ждёт
+    CHECK(access.Check("Bearer anything"sv, net::ip::make_address("10.0.0.5")) == AdminAccess::Verdict::FORBIDDEN);
+}
+
+TEST_CASE("With a token admin endpoints require it from every address") {
+    const AdminAccess access{"secret"s};
+    const auto remote = net::ip::make_address("10.0.0.5");
+    const auto local = net::ip::make_address("127.0.0.1");
+
+    CHECK(access.Check("Bearer secret"sv, remote) == AdminAccess::Verdict::ALLOWED);
+    CHECK(access.Check("Bearer secret"sv, local) == AdminAccess::Verdict::ALLOWED);
+
+    CHECK(access.Check(std::nullopt, local) == AdminAccess::Verdict::UNAUTHORIZED);
+    CHECK(access.Check("Bearer secre"sv, remote) == AdminAccess::Verdict::UNAUTHORIZED);
+    CHECK(access.Check("Bearer secret2"sv, remote) == AdminAccess::Verdict::UNAUTHORIZED);
+    CHECK(access.Check("secret"sv, remote) == AdminAccess::Verdict::UNAUTHORIZED);
+    CHECK(access.Check("Basic secret"sv, remote) == AdminAccess::Verdict::UNAUTHORIZED);
+}
@@ -0,0 +1,62 @@
+#include <catch2/catch.hpp>
+
+#include "api_router.h"
+
+namespace {
+
+using namespace std::literals;
+using http_handler::Router;
+using Status = Router<int>::Status;
+namespace http = boost::beast::http;
+
+void AddApiRoutes(Router<int>& router) {
+    router.Add("/api/v1/maps"sv, {http::verb::get, http::verb::head}, 1);
+    router.Add("/api/v1/maps/{map_id}"sv, {http::verb::get, http::verb::head}, 2);
+    router.Add("/api/v1/game/state"sv, {http::verb::get, http::verb::head}, 3);
+}
+
+} // namespace
+
+TEST_CASE("Trailing slash is an empty last segment") {
+    Router<int> router;
+    AddApiRoutes(router);
+
+    auto list = router.Find("/api/v1/maps"sv, http::verb::get);
+    REQUIRE(list.status == Status::FOUND);
+    CHECK(*list.handler == 1);
+
+    auto map = router.Find("/api/v1/maps/map1?x=1"sv, http::verb::get);
+    REQUIRE(map.status == Status::FOUND);
+    CHECK(*map.handler == 2);
+    CHECK(map.params.Get("map_id"sv) == "map1"sv);
+
+    // Как до маршрутизатора: карта с пустым id, а не список карт
+    auto empty_id = router.Find("/api/v1/maps/"sv, http::verb::get);
+    REQUIRE(empty_id.status == Status::FOUND);
+    CHECK(*empty_id.handler == 2);
+    CHECK(empty_id.params.Get("map_id"sv) == ""sv);
+
+    CHECK(router.Find("/api/v1/game/state/"sv, http::verb::get).status == Status::NOT_FOUND);
+}
+
+TEST_CASE("Extra segments after a parameter don't match the route") {
+    Router<int> router;
+    AddApiRoutes(router);
+
+    // До маршрутизатора id карты брался после последнего '/': "/api/v1/maps/a/b" - карта "b"
+    CHECK(router.Find("/api/v1/maps/a/b"sv, http::verb::get).status == Status::NOT_FOUND);
+    CHECK(router.Find("/api/v1/maps/a/b/"sv, http::verb::get).status == Status::NOT_FOUND);
+    CHECK(router.Find("/api/v1/game/state/extra"sv, http::verb::get).status == Status::NOT_FOUND);
+}
+
+TEST_CASE("Method mismatch reports a handler of the route") {
+    Router<int> router;
+    AddApiRoutes(router);
+
+    auto match = router.Find("/api/v1/game/state"sv, http::verb::post);
+    REQUIRE(match.status == Status::METHOD_NOT_ALLOWED);
+    REQUIRE(match.handler != nullptr);
+    CHECK(*match.handler == 3);
+    CHECK(match.allow == "GET, HEAD"sv);
+    CHECK(match.method_error == "Only HEAD or GET method are expected"sv);
+}
@@ -0,0 +1,67 @@
+#include <catch2/catch.hpp>
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "log_backend.h"
+
+namespace {
+
+// Число строк, выведенных в файл
+size_t CountLines(FILE* file) {
+    std::fflush(file);
+    std::rewind(file);
+    size_t lines = 0;
+    for (int c = std::fgetc(file); c != EOF; c = std::fgetc(file)) {
+        lines += c == '\n' ? 1 : 0;
+    }
+    return lines;
+}
+
+} // namespace
+
+TEST_CASE("Records accepted while the backend stops are all written") {
+    using logger::AsyncLogBackend;
+    auto& backend = AsyncLogBackend::Instance();
+
+    for (int round = 0; round < 20; ++round) {
+        FILE* output = std::tmpfile();
+        REQUIRE(output != nullptr);
+
+        logger::AsyncLogOptions options;
+        options.buffer_size = 64;
+        options.fd = ::fileno(output);
+        backend.Start(options);
+
+        // Писатели заходят в Push, пока основной поток останавливает вывод
+        std::atomic<size_t> accepted{0};
+        std::atomic<bool> go{false};
+        std::vector<std::thread> producers;
+        for (int i = 0; i < 4; ++i) {
+            producers.emplace_back([&] {
+                while (!go.load()) {
+                    std::this_thread::yield();
+                }
+                while (backend.Push("{\"record\":true}")) {
+                    accepted.fetch_add(1);
+                }
+            });
+        }
+        go.store(true);
+        std::this_thread::sleep_for(std::chrono::milliseconds{1 + round % 3});
+        backend.Stop();
+        for (auto& producer : producers) {
+            producer.join();
+        }
+
+        CHECK(accepted.load() > 0);
+        CHECK(CountLines(output) == accepted.load());
+        std::fclose(output);
+    }
+}
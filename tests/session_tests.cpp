@@ -0,0 +1,115 @@
+#include <catch2/catch.hpp>
+
+#include <boost/asio/connect.hpp>
+#include <boost/asio/thread_pool.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "http_server.h"
+
+namespace {
+
+using namespace std::literals;
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+using tcp = net::ip::tcp;
+
+// Получил ли клиент ответ на текущий запрос
+struct ClientProgress {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool received = false;
+    int early_writes = 0;
+
+    void SetReceived(bool value) {
+        {
+            std::lock_guard lock{mutex};
+            received = value;
+        }
+        cv.notify_all();
+    }
+};
+
+// Отвечает из потока пула, как обработчик статики из пула файлов или API из strand игры.
+// Поток сервера при этом занят: если ответ дошёл до клиента, пока он занят, запись началась
+// в чужом потоке, а не в executor соединения, и её завершение гоняется с инициирующим вызовом
+struct ForeignThreadHandler {
+    net::thread_pool* pool = nullptr;
+    ClientProgress* progress = nullptr;
+
+    template <typename Request, typename Send>
+    void operator()(Request&& req, Send&& send, const tcp::endpoint&) {
+        net::post(*pool, [target = std::string(req.target()), version = req.version(),
+                          keep_alive = req.keep_alive(), send = std::forward<Send>(send)]() mutable {
+            http::response<http::string_body> response{http::status::ok, version};
+            response.body() = target;
+            response.keep_alive(keep_alive);
+            response.prepare_payload();
+            send(std::move(response));
+        });
+
+        std::unique_lock lock{progress->mutex};
+        if (progress->cv.wait_for(lock, 100ms, [this] { return progress->received; })) {
+            ++progress->early_writes;
+        }
+    }
+};
+
+void ServeFromForeignThread(http_server::SessionModel model) {
+    net::io_context ioc{1};
+    net::thread_pool pool{1};
+    ClientProgress progress;
+
+    http_server::ListenerOptions options;
+    options.session_model = model;
+    auto listener = std::make_shared<http_server::Listener<ForeignThreadHandler>>(
+        ioc, tcp::endpoint{net::ip::make_address("127.0.0.1"), 0}, ForeignThreadHandler{&pool, &progress}, options);
+    listener->Run();
+    const tcp::endpoint endpoint = listener->GetLocalEndpoint();
+    listener.reset();
+
+    std::thread server([&ioc] { ioc.run(); });
+
+    {
+        net::io_context client_ioc;
+        beast::tcp_stream stream{client_ioc};
+        stream.connect(endpoint);
+        beast::flat_buffer buffer;
+
+        for (int i = 0; i < 5; ++i) {
+            const std::string target = "/request/"s + std::to_string(i);
+            http::request<http::empty_body> request{http::verb::get, target, 11};
+            request.keep_alive(true);
+            progress.SetReceived(false);
+            http::write(stream, request);
+
+            http::response<http::string_body> response;
+            http::read(stream, buffer, response);
+            progress.SetReceived(true);
+            CHECK(response.result() == http::status::ok);
+            CHECK(response.body() == target);
+        }
+        beast::error_code ec;
+        stream.socket().shutdown(tcp::socket::shutdown_both, ec);
+    }
+
+    ioc.stop();
+    server.join();
+    pool.join();
+    CHECK(progress.early_writes == 0);
+}
+
+} // namespace
+
+TEST_CASE("Callback session writes a reply sent from a foreign thread on the connection executor") {
+    ServeFromForeignThread(http_server::SessionModel::CALLBACKS);
+}
+
+TEST_CASE("Coroutine session writes a reply sent from a foreign thread on the connection executor") {
+    ServeFromForeignThread(http_server::SessionModel::COROUTINES);
+}
@@ -0,0 +1,181 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "timing_wheel.h"
+
+namespace {
+
+using Wheel = util::TimingWheel<uint32_t>;
+
+// Доводит колесо до time по одной единице и запоминает, когда сработал каждый таймер
+std::map<uint32_t, uint64_t> StepTo(Wheel& wheel, uint64_t time) {
+    std::map<uint32_t, uint64_t> fired;
+    std::vector<uint32_t> expired;
+    while (wheel.GetTime() < time) {
+        wheel.Advance(wheel.GetTime() + 1, expired);
+        for (uint32_t value : expired) {
+            fired.emplace(value, wheel.GetTime());
+        }
+        expired.clear();
+    }
+    return fired;
+}
+
+std::vector<uint32_t> Sorted(std::vector<uint32_t> values) {
+    std::sort(values.begin(), values.end());
+    return values;
+}
+
+} // namespace
+
+TEST_CASE("Timers fire exactly at their time across level boundaries") {
+    // Вокруг границ уровней (64, 64^2, 64^3) таймер перекладывается на нижний уровень
+    const std::vector<uint64_t> times = {1, 2, 63, 64, 65, 127, 128, 4095, 4096, 4097, 4160,
+                                         262'143, 262'144, 262'145, 266'305};
+    Wheel wheel;
+    for (uint32_t i = 0; i < times.size(); ++i) {
+        wheel.Schedule(i + 1, times[i]);
+    }
+
+    const auto fired = StepTo(wheel, 270'000);
+    REQUIRE(fired.size() == times.size());
+    for (uint32_t i = 0; i < times.size(); ++i) {
+        CHECK(fired.at(i + 1) == times[i]);
+    }
+    CHECK(wheel.GetSize() == 0);
+}
+
+TEST_CASE("Timers scheduled mid-way cascade from the current time") {
+    Wheel wheel;
+    std::vector<uint32_t> expired;
+    wheel.Advance(4000, expired);
+    REQUIRE(expired.empty());
+
+    // Срок относительно текущего времени попадает на разные уровни и границы
+    wheel.Schedule(1, 4033);
+    wheel.Schedule(2, 4096);
+    wheel.Schedule(3, 4100);
+    wheel.Schedule(4, 8192);
+    wheel.Schedule(5, 300'000);
+
+    const auto fired = StepTo(wheel, 300'000);
+    CHECK(fired == std::map<uint32_t, uint64_t>{{1, 4033}, {2, 4096}, {3, 4100}, {4, 8192}, {5, 300'000}});
+}
+
+TEST_CASE("Advance jumps over empty intervals without losing timers") {
+    Wheel wheel;
+    std::vector<uint32_t> expired;
+
+    wheel.Schedule(1, 10);
+    wheel.Schedule(2, 5'000);
+    wheel.Schedule(3, 5'001);
+    wheel.Schedule(4, 1'000'000);
+    // Дальше верхнего уровня (64^4): таймер проходит верхний уровень по кругу
+    wheel.Schedule(5, 40'000'000);
+
+    wheel.Advance(5'000, expired);
+    CHECK(Sorted(expired) == std::vector<uint32_t>{1, 2});
+    CHECK(wheel.GetTime() == 5'000);
+    expired.clear();
+
+    wheel.Advance(999'999, expired);
+    CHECK(expired == std::vector<uint32_t>{3});
+    expired.clear();
+
+    wheel.Advance(1'000'000, expired);
+    CHECK(expired == std::vector<uint32_t>{4});
+    expired.clear();
+
+    wheel.Advance(39'999'999, expired);
+    CHECK(expired.empty());
+    wheel.Advance(40'000'000, expired);
+    CHECK(expired == std::vector<uint32_t>{5});
+    CHECK(wheel.GetSize() == 0);
+
+    // Пустое колесо доходит до нужного времени сразу
+    expired.clear();
+    wheel.Advance(100'000'000, expired);
+    CHECK(expired.empty());
+    CHECK(wheel.GetTime() == 100'000'000);
+}
+
+TEST_CASE("Past deadlines fire on the next advance, reschedule and cancel move timers") {
+    Wheel wheel;
+    std::vector<uint32_t> expired;
+    wheel.Advance(100, expired);
+
+    const auto past = wheel.Schedule(1, 50);
+    CHECK(wheel.GetExpiry(past) == 101);
+    const auto moved = wheel.Schedule(2, 200);
+    const auto cancelled = wheel.Schedule(3, 150);
+
+    wheel.Reschedule(moved, 5'000);
+    wheel.Cancel(cancelled);
+
+    wheel.Advance(101, expired);
+    CHECK(expired == std::vector<uint32_t>{1});
+    expired.clear();
+
+    wheel.Advance(4'999, expired);
+    CHECK(expired.empty());
+    wheel.Advance(5'000, expired);
+    CHECK(expired == std::vector<uint32_t>{2});
+    CHECK(wheel.GetSize() == 0);
+}
+
+TEST_CASE("Random schedules, reschedules and jumps match a sorted reference") {
+    std::mt19937_64 random{42};
+    Wheel wheel;
+    std::vector<uint32_t> expired;
+
+    // value -> срок; id таймера по значению
+    std::map<uint32_t, uint64_t> reference;
+    std::map<uint32_t, Wheel::TimerId> ids;
+    uint32_t next_value = 1;
+
+    auto random_delay = [&random]() -> uint64_t {
+        // Задержки всех уровней, включая дальше верхнего
+        static constexpr uint64_t LIMITS[] = {64, 4'096, 262'144, 16'777'216, 100'000'000};
+        return 1 + random() % LIMITS[random() % std::size(LIMITS)];
+    };
+
+    for (int step = 0; step < 5'000; ++step) {
+        const auto action = random() % 10;
+        if (action < 4 || reference.empty()) {
+            const uint64_t expires = wheel.GetTime() + random_delay();
+            ids[next_value] = wheel.Schedule(next_value, expires);
+            reference[next_value] = expires;
+            ++next_value;
+        } else if (action < 6) {
+            auto it = std::next(reference.begin(), static_cast<long>(random() % reference.size()));
+            it->second = wheel.GetTime() + random_delay();
+            wheel.Reschedule(ids.at(it->first), it->second);
+        } else if (action < 7) {
+            auto it = std::next(reference.begin(), static_cast<long>(random() % reference.size()));
+            wheel.Cancel(ids.at(it->first));
+            ids.erase(it->first);
+            reference.erase(it);
+        } else {
+            const uint64_t time = wheel.GetTime() + random_delay();
+            wheel.Advance(time, expired);
+
+            std::vector<uint32_t> due;
+            for (auto it = reference.begin(); it != reference.end();) {
+                if (it->second <= time) {
+                    due.push_back(it->first);
+                    ids.erase(it->first);
+                    it = reference.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            REQUIRE(Sorted(expired) == due);
+            expired.clear();
+        }
+        REQUIRE(wheel.GetSize() == reference.size());
+    }
+}
@@ -0,0 +1,174 @@
+#include <catch2/catch.hpp>
+
+#include <sys/resource.h>
+
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "wal.h"
+
+namespace {
+
+using namespace std::literals;
+namespace fs = std::filesystem;
+
+// Пустой каталог журнала, удаляется в конце теста
+struct TempDir {
+    explicit TempDir(std::string_view name)
+        : path{fs::temp_directory_path() / ("game_server_tests_"s + std::string(name))} {
+        fs::remove_all(path);
+        fs::create_directories(path);
+    }
+
+    ~TempDir() {
+        fs::remove_all(path);
+    }
+
+    fs::path path;
+};
+
+model::Game MakeGame() {
+    model::Game game;
+    model::Map map{model::Map::Id{"map1"s}, "Map 1"s};
+    map.AddRoad(model::Road{model::Road::HORIZONTAL, model::Point{0, 0}, 10});
+    game.AddMap(std::move(map));
+    return game;
+}
+
+// Сегмент с тиками first..last. Пропущенные номера из skip в журнал не попадают
+void WriteTicks(const fs::path& dir, uint64_t first, uint64_t last, uint64_t skip = 0) {
+    wal::WalWriter writer{wal::WalOptions{.dir = dir, .durability = wal::Durability::ASYNC}, first};
+    for (uint64_t seq = first; seq <= last; ++seq) {
+        if (seq != skip) {
+            writer.OnTick(seq, 100);
+        }
+    }
+    writer.Stop();
+}
+
+std::vector<fs::path> ListSegments(const fs::path& dir) {
+    std::vector<fs::path> segments;
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        segments.push_back(entry.path());
+    }
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+// Ждёт, пока поток записи доведёт файл до size байт
+bool WaitForSize(const fs::path& path, uintmax_t size) {
+    for (int i = 0; i < 200; ++i) {
+        if (fs::exists(path) && fs::file_size(path) >= size) {
+            return true;
+        }
+        std::this_thread::sleep_for(10ms);
+    }
+    return false;
+}
+
+void AppendBytes(const fs::path& path, std::string_view bytes) {
+    std::ofstream{path, std::ios::binary | std::ios::app}.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+} // namespace
+
+TEST_CASE("WAL replay applies every change after the snapshot") {
+    TempDir dir{"wal_replay"sv};
+    WriteTicks(dir.path, 1, 5);
+
+    model::Game game = MakeGame();
+    const wal::ReplayResult result = wal::Replay(dir.path, game);
+    CHECK(result.applied == 5);
+    CHECK(result.last_event == 5);
+    CHECK_FALSE(result.truncated);
+
+    // Повтор поверх уже применённого журнала ничего не меняет
+    CHECK(wal::Replay(dir.path, game).applied == 0);
+}
+
+TEST_CASE("WAL replay cuts a torn tail of the last segment") {
+    TempDir dir{"wal_torn"sv};
+    WriteTicks(dir.path, 1, 3);
+    const fs::path segment = ListSegments(dir.path).back();
+    const auto intact_size = fs::file_size(segment);
+
+    SECTION("half-written header") {
+        AppendBytes(segment, "\x10\x00"sv);
+    }
+    SECTION("record with a wrong checksum") {
+        AppendBytes(segment, "\x09\x00\x00\x00\xde\xad\xbe\xef\x04\x00\x00\x00\x00\x00\x00\x00\x03"sv);
+    }
+
+    model::Game game = MakeGame();
+    const wal::ReplayResult result = wal::Replay(dir.path, game);
+    CHECK(result.truncated);
+    CHECK(result.applied == 3);
+    CHECK(result.last_event == 3);
+    // Хвост отрезан: новые записи пойдут сразу за целыми данными
+    CHECK(fs::file_size(segment) == intact_size);
+
+    // Журнал продолжается после отрезанного хвоста и снова читается целиком
+    WriteTicks(dir.path, 4, 5);
+    model::Game restarted = MakeGame();
+    const wal::ReplayResult again = wal::Replay(dir.path, restarted);
+    CHECK_FALSE(again.truncated);
+    CHECK(again.last_event == 5);
+}
+
+TEST_CASE("WAL replay rejects a gap in change numbers") {
+    TempDir dir{"wal_gap"sv};
+    WriteTicks(dir.path, 1, 5, 3);
+
+    model::Game game = MakeGame();
+    CHECK_THROWS_WITH(wal::Replay(dir.path, game), Catch::Contains("gap"));
+}
+
+TEST_CASE("WAL replay rejects corruption in the middle of the log") {
+    TempDir dir{"wal_corrupt"sv};
+    WriteTicks(dir.path, 1, 3);
+    WriteTicks(dir.path, 4, 5);
+    const std::vector<fs::path> segments = ListSegments(dir.path);
+    REQUIRE(segments.size() == 2);
+    AppendBytes(segments.front(), "\x10\x00"sv);
+
+    model::Game game = MakeGame();
+    CHECK_THROWS_WITH(wal::Replay(dir.path, game), Catch::Contains("Corrupted"));
+}
+
+TEST_CASE("WAL writer retries a failed batch without leaving a torn record") {
+    TempDir dir{"wal_retry"sv};
+    // Лимит размера файла обрывает запись второй пачки посередине (write вернёт EFBIG)
+    std::signal(SIGXFSZ, SIG_IGN);
+    rlimit saved{};
+    getrlimit(RLIMIT_FSIZE, &saved);
+
+    {
+        wal::WalWriter writer{wal::WalOptions{.dir = dir.path, .durability = wal::Durability::ASYNC}, 1};
+        writer.OnTick(1, 100);
+        const fs::path segment = ListSegments(dir.path).front();
+        REQUIRE(WaitForSize(segment, 1));
+        const auto record_size = fs::file_size(segment);
+
+        rlimit limited = saved;
+        limited.rlim_cur = record_size + record_size / 2;
+        REQUIRE(setrlimit(RLIMIT_FSIZE, &limited) == 0);
+        writer.OnTick(2, 100);
+        std::this_thread::sleep_for(100ms);
+        REQUIRE(setrlimit(RLIMIT_FSIZE, &saved) == 0);
+
+        // Следующая пачка повторяет неудачную: сначала 2, затем 3
+        writer.OnTick(3, 100);
+        writer.Stop();
+        CHECK(fs::file_size(segment) == 3 * record_size);
+    }
+    std::signal(SIGXFSZ, SIG_DFL);
+
+    model::Game game = MakeGame();
+    const wal::ReplayResult result = wal::Replay(dir.path, game);
+    CHECK_FALSE(result.truncated);
+    CHECK(result.applied == 3);
+    CHECK(result.last_event == 3);
+}
@@ -0,0 +1,434 @@
+// Нагрузочный генератор: подключает N игроков к серверу по keep-alive соединениям и с заданной
+// частотой шлёт действия, опросы состояния и (по желанию) запросы статики.
+// В конце печатает пропускную способность и p50/p99/p999 задержки по каждому эндпоинту.
+// С --baseline-port та же нагрузка сначала идёт на второй сервер, и результаты печатаются рядом
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#include "sdk.h"
+#include <boost/asio/connect.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/json.hpp>
+#include <boost/program_options.hpp>
+
+#include <array>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "metrics.h"
+
+using namespace std::literals;
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace json = boost::json;
+namespace sys = boost::system;
+using tcp = net::ip::tcp;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Args {
+    std::string host = "127.0.0.1";
+    std::string port = "8080";
+    size_t players = 100;
+    double duration = 10.0;       // секунд
+    double action_rate = 10.0;    // запросов в секунду на игрока
+    double state_rate = 10.0;
+    double static_rate = 0.0;
+    std::string static_target = "/index.html";
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string label = "server";
+    std::string baseline_port;
+    std::string baseline_label = "baseline";
+};
+
+[[nodiscard]] std::optional<Args> ParseCommandLine(int argc, const char* const argv[]) {
+    namespace po = boost::program_options;
+
+    po::options_description desc{"All options"s};
+
+    Args args;
+    desc.add_options()
+        ("help,h", "Show help")
+        ("host", po::value(&args.host)->value_name("address"s), "server address (127.0.0.1)")
+        ("port", po::value(&args.port)->value_name("port"s), "server port (8080)")
+        ("players,n", po::value(&args.players)->value_name("N"s), "players joined across all maps, one connection each")
+        ("duration,d", po::value(&args.duration)->value_name("seconds"s), "test duration")
+        ("action-rate", po::value(&args.action_rate)->value_name("rps"s), "player/action requests per second per player")
+        ("state-rate", po::value(&args.state_rate)->value_name("rps"s), "game/state requests per second per player")
+        ("static-rate", po::value(&args.static_rate)->value_name("rps"s), "static file requests per second per player (0 - off)")
+        ("static-target", po::value(&args.static_target)->value_name("path"s), "static file to fetch")
+        ("threads", po::value(&args.threads)->value_name("N"s), "client threads")
+        ("label", po::value(&args.label)->value_name("name"s), "name of the tested server in the comparison")
+        ("baseline-port", po::value(&args.baseline_port)->value_name("port"s), "run the same load against this port first and compare")
+        ("baseline-label", po::value(&args.baseline_label)->value_name("name"s), "name of the baseline server, e.g. epoll");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.contains("help"s)) {
+        std::cout << desc;
+        return std::nullopt;
+    }
+    return args;
+}
+
+enum Endpoint {
+    JOIN,
+    ACTION,
+    STATE,
+    STATIC,
+    ENDPOINT_COUNT
+};
+
+constexpr std::array<std::string_view, ENDPOINT_COUNT> ENDPOINT_NAMES = {
+    "game/join"sv, "game/player/action"sv, "game/state"sv, "static"sv
+};
+
+struct EndpointStats {
+    metrics::LatencyHistogram latency;
+    uint64_t errors = 0;
+
+    void Merge(const EndpointStats& other) {
+        latency.Merge(other.latency);
+        errors += other.errors;
+    }
+};
+
+using Stats = std::array<EndpointStats, ENDPOINT_COUNT>;
+
+// Один игрок: своё keep-alive соединение, запросы идут строго по одному.
+// Задержка отсчитывается от запланированного момента отправки, а не от фактического,
+// чтобы медленный сервер не скрывал очередь (coordinated omission)
+class VirtualPlayer : public std::enable_shared_from_this<VirtualPlayer> {
+public:
+    VirtualPlayer(net::io_context& ioc, const tcp::resolver::results_type& endpoints, const Args& args,
+                  size_t index, std::string map_id, Clock::time_point deadline)
+        : stream_{net::make_strand(ioc)}
+        , timer_{stream_.get_executor()}
+        , endpoints_{endpoints}
+        , args_{args}
+        , index_{index}
+        , map_id_{std::move(map_id)}
+        , deadline_{deadline}
+        , random_{static_cast<std::mt19937::result_type>(index)} {
+    }
+
+    void Start() {
+        stream_.async_connect(endpoints_, [self = shared_from_this()](sys::error_code ec, const tcp::endpoint&) {
+            if (ec) {
+                self->stats_[JOIN].errors++;
+                return;
+            }
+            self->Join();
+        });
+    }
+
+    const Stats& GetStats() const {
+        return stats_;
+    }
+
+private:
+    using Response = http::response<http::string_body>;
+
+    void Join() {
+        json::value body{{"userName"s, "loadgen-"s + std::to_string(index_)}, {"mapId"s, map_id_}};
+        Send(JOIN, Clock::now(), http::verb::post, "/api/v1/game/join"sv, json::serialize(body));
+    }
+
+    static Clock::duration Period(double rate) {
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate));
+    }
+
+    // Следующий запрос - тот, чей плановый момент наступает раньше
+    void ScheduleNext() {
+        Endpoint next = ENDPOINT_COUNT;
+        for (Endpoint endpoint : {ACTION, STATE, STATIC}) {
+            if (next_[endpoint].has_value() && (next == ENDPOINT_COUNT || *next_[endpoint] < *next_[next])) {
+                next = endpoint;
+            }
+        }
+        if (next == ENDPOINT_COUNT || *next_[next] >= deadline_) {
+            sys::error_code ec;
+            stream_.socket().shutdown(tcp::socket::shutdown_both, ec);
+            return;
+        }
+
+        timer_.expires_at(*next_[next]);
+        timer_.async_wait([self = shared_from_this(), next](sys::error_code ec) {
+            if (!ec) {
+                self->SendNext(next);
+            }
+        });
+    }
+
+    void SendNext(Endpoint endpoint) {
+        static constexpr std::array<std::string_view, 5> MOVES = {"U"sv, "D"sv, "L"sv, "R"sv, ""sv};
+
+        const Clock::time_point scheduled = *next_[endpoint];
+        *next_[endpoint] += periods_[endpoint];
+
+        switch (endpoint) {
+        case ACTION: {
+            json::value body{{"move"s, MOVES[random_() % MOVES.size()]}};
+            return Send(ACTION, scheduled, http::verb::post, "/api/v1/game/player/action"sv, json::serialize(body));
+        }
+        case STATE:
+            return Send(STATE, scheduled, http::verb::get, "/api/v1/game/state"sv, {});
+        default:
+            return Send(STATIC, scheduled, http::verb::get, args_.static_target, {});
+        }
+    }
+
+    void Send(Endpoint endpoint, Clock::time_point scheduled, http::verb method, std::string_view target, std::string body) {
+        request_ = {method, target, 11};
+        request_.set(http::field::host, args_.host);
+        request_.keep_alive(true);
+        if (!token_.empty()) {
+            request_.set(http::field::authorization, "Bearer "s + token_);
+        }
+        if (!body.empty()) {
+            request_.set(http::field::content_type, "application/json"sv);
+            request_.body() = std::move(body);
+        }
+        request_.prepare_payload();
+
+        stream_.expires_after(30s);
+        http::async_write(stream_, request_, [self = shared_from_this(), endpoint, scheduled](sys::error_code ec, size_t) {
+            if (ec) {
+                return self->OnError(endpoint);
+            }
+            self->response_.emplace();
+            http::async_read(self->stream_, self->buffer_, *self->response_,
+                             [self, endpoint, scheduled](sys::error_code ec, size_t) {
+                                 self->OnResponse(endpoint, scheduled, ec);
+                             });
+        });
+    }
+
+    void OnResponse(Endpoint endpoint, Clock::time_point scheduled, sys::error_code ec) {
+        if (ec) {
+            return OnError(endpoint);
+        }
+
+        const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - scheduled);
+        stats_[endpoint].latency.Observe(static_cast<uint64_t>(latency.count()));
+        if (http::to_status_class(response_->result()) != http::status_class::successful) {
+            stats_[endpoint].errors++;
+        }
+
+        if (endpoint == JOIN) {
+            if (!ReadToken()) {
+                return;
+            }
+            // Игроки начинают со случайным сдвигом, чтобы запросы не шли синхронными волнами
+            const auto now = Clock::now();
+            for (auto [kind, rate] : {std::pair{ACTION, args_.action_rate}, {STATE, args_.state_rate}, {STATIC, args_.static_rate}}) {
+                if (rate > 0) {
+                    periods_[kind] = Period(rate);
+                    const double phase = std::uniform_real_distribution<double>{0.0, 1.0}(random_);
+                    next_[kind] = now + std::chrono::duration_cast<Clock::duration>(periods_[kind] * phase);
+                }
+            }
+        }
+        ScheduleNext();
+    }
+
+    bool ReadToken() {
+        sys::error_code ec;
+        auto value = json::parse(response_->body(), ec);
+        if (ec || !value.is_object() || !value.as_object().contains("authToken")) {
+            return false;
+        }
+        token_ = value.at("authToken").as_string().c_str();
+        return true;
+    }
+
+    void OnError(Endpoint endpoint) {
+        // Соединение потеряно - игрок выбывает, ошибка учитывается в статистике эндпоинта
+        stats_[endpoint].errors++;
+        sys::error_code ec;
+        stream_.socket().close(ec);
+    }
+
+    beast::tcp_stream stream_;
+    net::steady_timer timer_;
+    const tcp::resolver::results_type& endpoints_;
+    const Args& args_;
+    size_t index_;
+    std::string map_id_;
+    Clock::time_point deadline_;
+    std::mt19937 random_;
+
+    beast::flat_buffer buffer_;
+    http::request<http::string_body> request_;
+    std::optional<Response> response_;
+    std::string token_;
+
+    std::array<std::optional<Clock::time_point>, ENDPOINT_COUNT> next_;
+    std::array<Clock::duration, ENDPOINT_COUNT> periods_{};
+    Stats stats_;
+};
+
+// Синхронно запрашивает список карт, чтобы распределить игроков между ними
+std::vector<std::string> FetchMapIds(net::io_context& ioc, const tcp::resolver::results_type& endpoints, const Args& args) {
+    beast::tcp_stream stream{ioc};
+    stream.connect(endpoints);
+
+    http::request<http::string_body> request{http::verb::get, "/api/v1/maps"sv, 11};
+    request.set(http::field::host, args.host);
+    http::write(stream, request);
+
+    beast::flat_buffer buffer;
+    http::response<http::string_body> response;
+    http::read(stream, buffer, response);
+
+    std::vector<std::string> ids;
+    for (const auto& map : json::parse(response.body()).as_array()) {
+        ids.emplace_back(map.at("id").as_string().c_str());
+    }
+    if (ids.empty()) {
+        throw std::runtime_error("Server has no maps"s);
+    }
+    return ids;
+}
+
+// Итог одного прогона
+struct RunResult {
+    Stats stats;
+    double seconds = 0.0;
+};
+
+RunResult RunLoad(const Args& args, const std::string& port) {
+    net::io_context ioc(static_cast<int>(args.threads));
+    tcp::resolver resolver{ioc};
+    const auto endpoints = resolver.resolve(args.host, port);
+    const auto map_ids = FetchMapIds(ioc, endpoints, args);
+
+    const auto start = Clock::now();
+    const auto deadline = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(args.duration));
+
+    std::vector<std::shared_ptr<VirtualPlayer>> players;
+    players.reserve(args.players);
+    for (size_t i = 0; i < args.players; ++i) {
+        players.push_back(std::make_shared<VirtualPlayer>(ioc, endpoints, args, i, map_ids[i % map_ids.size()], deadline));
+        players.back()->Start();
+    }
+
+    std::vector<std::jthread> workers;
+    for (unsigned i = 1; i < args.threads; ++i) {
+        workers.emplace_back([&ioc] {
+            ioc.run();
+        });
+    }
+    ioc.run();
+    workers.clear();
+
+    RunResult result;
+    for (const auto& player : players) {
+        for (size_t i = 0; i < result.stats.size(); ++i) {
+            result.stats[i].Merge(player->GetStats()[i]);
+        }
+    }
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return result;
+}
+
+void PrintReport(const Stats& stats, double seconds) {
+    auto millis = [](uint64_t micros) {
+        return static_cast<double>(micros) / 1000.0;
+    };
+
+    std::cout << std::left << std::setw(22) << "endpoint" << std::right
+              << std::setw(10) << "requests" << std::setw(8) << "errors" << std::setw(11) << "rps"
+              << std::setw(10) << "p50 ms" << std::setw(10) << "p99 ms" << std::setw(10) << "p999 ms" << '\n';
+
+    std::cout << std::fixed << std::setprecision(2);
+    for (size_t i = 0; i < stats.size(); ++i) {
+        const auto& latency = stats[i].latency;
+        if (latency.Count() == 0 && stats[i].errors == 0) {
+            continue;
+        }
+        std::cout << std::left << std::setw(22) << ENDPOINT_NAMES[i] << std::right
+                  << std::setw(10) << latency.Count() << std::setw(8) << stats[i].errors
+                  << std::setw(11) << static_cast<double>(latency.Count()) / seconds
+                  << std::setw(10) << millis(latency.Quantile(0.5))
+                  << std::setw(10) << millis(latency.Quantile(0.99))
+                  << std::setw(10) << millis(latency.Quantile(0.999)) << '\n';
+    }
+}
+
+// Таблица "база | проверяемый сервер" по каждому эндпоинту: rps, изменение rps и задержки
+void PrintComparison(const RunResult& baseline, const RunResult& tested, const Args& args) {
+    auto millis = [](uint64_t micros) {
+        return static_cast<double>(micros) / 1000.0;
+    };
+    auto rps = [](const RunResult& result, size_t endpoint) {
+        return static_cast<double>(result.stats[endpoint].latency.Count()) / result.seconds;
+    };
+
+    std::cout << "baseline: " << args.baseline_label << " (port " << args.baseline_port << "), tested: "
+              << args.label << " (port " << args.port << ")\n";
+    std::cout << std::left << std::setw(22) << "endpoint" << std::right
+              << std::setw(11) << "rps base" << std::setw(11) << "rps test" << std::setw(9) << "rps %"
+              << std::setw(10) << "p50 base" << std::setw(10) << "p50 test"
+              << std::setw(10) << "p99 base" << std::setw(10) << "p99 test"
+              << std::setw(11) << "p999 base" << std::setw(11) << "p999 test"
+              << std::setw(8) << "errors" << '\n';
+
+    std::cout << std::fixed << std::setprecision(2);
+    for (size_t i = 0; i < ENDPOINT_COUNT; ++i) {
+        const auto& base = baseline.stats[i];
+        const auto& test = tested.stats[i];
+        if (base.latency.Count() == 0 && test.latency.Count() == 0 && base.errors == 0 && test.errors == 0) {
+            continue;
+        }
+        const double base_rps = rps(baseline, i);
+        const double change = base_rps > 0 ? (rps(tested, i) / base_rps - 1.0) * 100.0 : 0.0;
+        std::cout << std::left << std::setw(22) << ENDPOINT_NAMES[i] << std::right
+                  << std::setw(11) << base_rps << std::setw(11) << rps(tested, i) << std::setw(9) << change
+                  << std::setw(10) << millis(base.latency.Quantile(0.5)) << std::setw(10) << millis(test.latency.Quantile(0.5))
+                  << std::setw(10) << millis(base.latency.Quantile(0.99)) << std::setw(10) << millis(test.latency.Quantile(0.99))
+                  << std::setw(11) << millis(base.latency.Quantile(0.999)) << std::setw(11) << millis(test.latency.Quantile(0.999))
+                  << std::setw(8) << (std::to_string(base.errors) + "/" + std::to_string(test.errors)) << '\n';
+    }
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+    try {
+        std::optional<Args> args = ParseCommandLine(argc, argv);
+        if (!args.has_value()) {
+            return EXIT_FAILURE;
+        }
+
+        // Прогоны идут по очереди, чтобы серверы не делили ядра машины
+        if (!args->baseline_port.empty()) {
+            const RunResult baseline = RunLoad(*args, args->baseline_port);
+            const RunResult tested = RunLoad(*args, args->port);
+            PrintComparison(baseline, tested, *args);
+            return EXIT_SUCCESS;
+        }
+
+        const RunResult result = RunLoad(*args, args->port);
+        PrintReport(result.stats, result.seconds);
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,98 @@
+// Сборка бинарного бандла карт из config.json для game_server --map-bundle.
+// Бандл хранит карты плотными массивами вместе с готовыми границами дорог, поэтому сервер
+// загружает его через mmap без разбора JSON
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#include "sdk.h"
+#include <boost/program_options.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+
+#include "binary_io.h"
+#include "json_loader.h"
+#include "map_bundle.h"
+
+using namespace std::literals;
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Args {
+    std::string config;
+    std::string output;
+};
+
+[[nodiscard]] std::optional<Args> ParseCommandLine(int argc, const char* const argv[]) {
+    namespace po = boost::program_options;
+
+    po::options_description desc{"All options"s};
+
+    Args args;
+    desc.add_options()
+        ("help,h", "Show help")
+        ("config-file,c", po::value(&args.config)->value_name("file"s), "game config with maps")
+        ("output,o", po::value(&args.output)->value_name("file"s), "where to write the map bundle");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.contains("help"s)) {
+        std::cout << desc;
+        return std::nullopt;
+    }
+    if (!vm.contains("config-file"s)) {
+        throw std::runtime_error("config file path is not specified"s);
+    }
+    if (!vm.contains("output"s)) {
+        throw std::runtime_error("output file path is not specified"s);
+    }
+    return args;
+}
+
+} // namespace
+
+int main(int argc, const char* argv[]) {
+    try {
+        std::optional<Args> args = ParseCommandLine(argc, argv);
+        if (!args.has_value()) {
+            return EXIT_FAILURE;
+        }
+
+        const auto start = Clock::now();
+        const auto source = binary_io::ReadFile(args->config);
+        if (!source.has_value()) {
+            throw std::runtime_error("Can't open "s + args->config);
+        }
+        const json_loader::Config config = json_loader::LoadConfig(args->config);
+        const model::Game& game = config.game;
+        const std::string bundle = map_bundle::Compile(config, *source);
+
+        // Через временный файл, чтобы запущенный сервер не увидел недописанный бандл
+        const fs::path temp_path = args->output + ".tmp"s;
+        {
+            std::ofstream out{temp_path, std::ios::binary | std::ios::trunc};
+            if (!out.write(bundle.data(), static_cast<std::streamsize>(bundle.size()))) {
+                throw std::runtime_error("Can't write "s + temp_path.string());
+            }
+        }
+        fs::rename(temp_path, args->output);
+
+        size_t roads = 0;
+        for (const auto& map : game.GetMaps()) {
+            roads += map->GetRoads().size();
+        }
+        std::cout << "maps: " << game.GetMaps().size() << ", roads: " << roads
+                  << ", bundle: " << bundle.size() << " bytes, "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count() << " ms" << std::endl;
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,255 @@
+// Воспроизведение записанного сервером (--record-file) API-трафика.
+// Запросы отправляются по одному в исходном порядке - в том, в каком их выполнил strand игры, -
+// поэтому свежезапущенный сервер с тем же конфигом (без -t и --randomize-spawn-points) должен прийти
+// к тому же состоянию. Ответы сверяются с записанными, в отчёте - задержки клиента и сервера (Server-Timing)
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#include "sdk.h"
+#include <boost/asio/connect.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/json.hpp>
+#include <boost/program_options.hpp>
+
+#include <charconv>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "metrics.h"
+#include "traffic_recorder.h"
+
+using namespace std::literals;
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace json = boost::json;
+using tcp = net::ip::tcp;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Args {
+    std::string host = "127.0.0.1";
+    std::string port = "8080";
+    std::string file;
+    bool fast = false;
+};
+
+[[nodiscard]] std::optional<Args> ParseCommandLine(int argc, const char* const argv[]) {
+    namespace po = boost::program_options;
+
+    po::options_description desc{"All options"s};
+
+    Args args;
+    desc.add_options()
+        ("help,h", "Show help")
+        ("host", po::value(&args.host)->value_name("address"s), "server address (127.0.0.1)")
+        ("port", po::value(&args.port)->value_name("port"s), "server port (8080)")
+        ("file,f", po::value(&args.file)->value_name("file"s), "recording made with game_server --record-file")
+        ("fast", "send requests as fast as possible instead of the original pace");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.contains("help"s)) {
+        std::cout << desc;
+        return std::nullopt;
+    }
+    if (!vm.contains("file"s)) {
+        throw std::runtime_error("recording file is not specified"s);
+    }
+    args.fast = vm.contains("fast"s);
+    return args;
+}
+
+std::vector<recording::RecordedRequest> LoadRecording(const std::string& path) {
+    std::ifstream in{path, std::ios::binary};
+    if (!in || !recording::ReadHeader(in)) {
+        throw std::runtime_error("Not a traffic recording: "s + path);
+    }
+
+    std::vector<recording::RecordedRequest> records;
+    while (auto record = recording::ReadRecord(in)) {
+        records.push_back(std::move(*record));
+    }
+    return records;
+}
+
+// Значение метрики name из заголовка Server-Timing ("queue;dur=0.012, app;dur=0.300") в микросекундах
+std::optional<uint64_t> ParseServerTiming(std::string_view header, std::string_view name) {
+    const std::string key = std::string(name) + ";dur="s;
+    const size_t pos = header.find(key);
+    if (pos == std::string_view::npos) {
+        return std::nullopt;
+    }
+
+    double millis = 0;
+    const char* begin = header.data() + pos + key.size();
+    if (auto [ptr, ec] = std::from_chars(begin, header.data() + header.size(), millis); ec != std::errc{}) {
+        return std::nullopt;
+    }
+    return static_cast<uint64_t>(millis * 1000.0);
+}
+
+struct TargetStats {
+    metrics::LatencyHistogram client;
+    metrics::LatencyHistogram server_queue;
+    metrics::LatencyHistogram server_app;
+};
+
+class Replayer {
+public:
+    Replayer(net::io_context& ioc, const Args& args)
+        : stream_{ioc}
+        , args_{args} {
+        tcp::resolver resolver{ioc};
+        stream_.connect(resolver.resolve(args.host, args.port));
+    }
+
+    void Run(const std::vector<recording::RecordedRequest>& records) {
+        const auto start = Clock::now();
+
+        for (const auto& record : records) {
+            if (!args_.fast) {
+                std::this_thread::sleep_until(start + std::chrono::microseconds(record.arrival_us));
+            }
+            Replay(record);
+        }
+        elapsed_ = Clock::now() - start;
+    }
+
+    void PrintReport() const {
+        const double seconds = std::chrono::duration<double>(elapsed_).count();
+        std::cout << "requests: " << total_ << ", elapsed: " << std::fixed << std::setprecision(2) << seconds
+                  << " s, " << static_cast<double>(total_) / seconds << " rps\n"
+                  << "status mismatches: " << status_mismatches_ << ", body mismatches: " << body_mismatches_ << '\n'
+                  << "final state: " << (last_state_matched_ ? "same"sv : "DIFFERENT"sv) << "\n\n";
+
+        auto millis = [](const metrics::LatencyHistogram& histogram, double q) {
+            return static_cast<double>(histogram.Quantile(q)) / 1000.0;
+        };
+
+        std::cout << std::left << std::setw(32) << "target" << std::right << std::setw(9) << "requests"
+                  << std::setw(12) << "client p50" << std::setw(12) << "client p99"
+                  << std::setw(11) << "queue p99" << std::setw(10) << "app p50" << std::setw(10) << "app p99" << '\n';
+        for (const auto& [target, stats] : by_target_) {
+            std::cout << std::left << std::setw(32) << target << std::right << std::setw(9) << stats.client.Count()
+                      << std::setw(12) << millis(stats.client, 0.5) << std::setw(12) << millis(stats.client, 0.99)
+                      << std::setw(11) << millis(stats.server_queue, 0.99)
+                      << std::setw(10) << millis(stats.server_app, 0.5) << std::setw(10) << millis(stats.server_app, 0.99) << '\n';
+        }
+    }
+
+private:
+    // Токен, выданный сервером при воспроизведении, либо заведомо неизвестный токен той же длины
+    std::string TokenFor(uint32_t placeholder) const {
+        if (auto it = tokens_.find(placeholder); it != tokens_.end()) {
+            return it->second;
+        }
+        std::ostringstream fake;
+        fake << std::hex << std::setw(32) << std::setfill('0') << placeholder;
+        return fake.str();
+    }
+
+    void Replay(const recording::RecordedRequest& record) {
+        http::request<http::string_body> request{static_cast<http::verb>(record.method), record.target, 11};
+        request.set(http::field::host, args_.host);
+        request.keep_alive(true);
+        if (record.token != recording::RecordedRequest::NO_TOKEN) {
+            request.set(http::field::authorization, "Bearer "s + TokenFor(record.token));
+        }
+        if (!record.content_type.empty()) {
+            request.set(http::field::content_type, record.content_type);
+        }
+        request.body() = record.body;
+        request.prepare_payload();
+
+        const auto sent_at = Clock::now();
+        http::write(stream_, request);
+        http::response<http::string_body> response;
+        http::read(stream_, buffer_, response);
+        const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - sent_at);
+
+        ++total_;
+        auto& stats = by_target_[record.target.substr(0, record.target.find('?'))];
+        stats.client.Observe(static_cast<uint64_t>(latency.count()));
+        if (auto it = response.find("Server-Timing"sv); it != response.end()) {
+            stats.server_queue.Observe(ParseServerTiming(it->value(), "queue"sv).value_or(0));
+            stats.server_app.Observe(ParseServerTiming(it->value(), "app"sv).value_or(0));
+        }
+
+        Check(record, response);
+    }
+
+    void Check(const recording::RecordedRequest& record, const http::response<http::string_body>& response) {
+        if (response.result_int() != record.status) {
+            ++status_mismatches_;
+        }
+
+        if (record.issued_token != recording::RecordedRequest::NO_TOKEN) {
+            boost::system::error_code ec;
+            auto value = json::parse(response.body(), ec);
+            if (!ec && value.is_object() && value.as_object().contains("authToken")) {
+                tokens_[record.issued_token] = value.at("authToken").as_string().c_str();
+            }
+            return;
+        }
+
+        // Тела потоковых ответов не записываются
+        if (record.response_hash == 0) {
+            return;
+        }
+        const bool matched = record.response_hash == recording::HashResponse(record.target, response.body());
+        if (!matched) {
+            ++body_mismatches_;
+        }
+        if (record.target.starts_with("/api/v1/game/state"sv)) {
+            last_state_matched_ = matched;
+        }
+    }
+
+    beast::tcp_stream stream_;
+    beast::flat_buffer buffer_;
+    const Args& args_;
+
+    std::unordered_map<uint32_t, std::string> tokens_;
+    std::map<std::string, TargetStats> by_target_;
+    uint64_t total_ = 0;
+    uint64_t status_mismatches_ = 0;
+    uint64_t body_mismatches_ = 0;
+    bool last_state_matched_ = true;
+    Clock::duration elapsed_{};
+};
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+    try {
+        std::optional<Args> args = ParseCommandLine(argc, argv);
+        if (!args.has_value()) {
+            return EXIT_FAILURE;
+        }
+
+        const auto records = LoadRecording(args->file);
+
+        net::io_context ioc;
+        Replayer replayer{ioc, *args};
+        replayer.Run(records);
+        replayer.PrintReport();
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
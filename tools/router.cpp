@@ -0,0 +1,492 @@
+// Маршрутизатор перед несколькими процессами game_server (шардами), каждый из которых обслуживает
+// часть карт (--maps) и помечает токены своим номером (--shard-index).
+// Вход в игру направляется в шард карты из тела запроса, остальные запросы /api/v1/game/* - в шард
+// из метки токена, /api/v1/maps/{id} - в шард карты. Список карт собирается со всех шардов, тик
+// рассылается всем. Всё остальное (статика, /admin, /metrics) уходит в первый шард, /admin - только
+// после той же проверки доступа, что и в game_server (--admin-token или loopback).
+// Соединения с шардами держатся открытыми и используются повторно
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#include "sdk.h"
+#include <boost/asio/connect.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/signal_set.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/json.hpp>
+#include <boost/program_options.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "admin_access.h"
+#include "cpu_topology.h"
+#include "http_server.h"
+#include "model.h"
+
+using namespace std::literals;
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace json = boost::json;
+using tcp = net::ip::tcp;
+
+namespace {
+
+struct Args {
+    int port = 8080;
+    std::vector<std::string> shards;
+    unsigned threads = 0;
+    std::string admin_token;
+};
+
+[[nodiscard]] std::optional<Args> ParseCommandLine(int argc, const char* const argv[]) {
+    namespace po = boost::program_options;
+
+    po::options_description desc{"All options"s};
+
+    Args args;
+    desc.add_options()
+        ("help,h", "Show help")
+        ("port", po::value(&args.port)->value_name("port"s), "listen on this port (8080)")
+        ("shard", po::value(&args.shards)->value_name("host:port"s),
+            "game_server shard; repeat for each shard in --shard-index order")
+        ("threads", po::value(&args.threads)->value_name("N"s), "worker threads (available cores)")
+        ("admin-token", po::value(&args.admin_token)->value_name("token"s),
+            "require 'Authorization: Bearer <token>' for /admin/* (GAME_SERVER_ADMIN_TOKEN; without it /admin/* is loopback-only)");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.contains("help"s)) {
+        std::cout << desc;
+        return std::nullopt;
+    }
+    if (!vm.contains("admin-token"s)) {
+        if (const char* token = std::getenv("GAME_SERVER_ADMIN_TOKEN")) {
+            args.admin_token = token;
+        }
+    }
+    if (args.shards.empty()) {
+        throw std::runtime_error("no shards specified"s);
+    }
+    if (args.shards.size() > model::MAX_SHARDS) {
+        throw std::runtime_error("too many shards"s);
+    }
+    return args;
+}
+
+using StringRequest = http::request<http::string_body>;
+using StringResponse = http::response<http::string_body>;
+using ResponseHandler = std::function<void(StringResponse)>;
+
+StringResponse MakeError(http::status status, std::string_view code, std::string_view message) {
+    StringResponse response{status, 11};
+    response.set(http::field::content_type, "application/json"sv);
+    response.set(http::field::cache_control, "no-cache"sv);
+    response.body() = json::serialize(json::value{{"code"s, code}, {"message"s, message}});
+    response.prepare_payload();
+    return response;
+}
+
+// Один game_server. Запрос уходит по свободному соединению из пула или по новому; после ответа
+// соединение возвращается в пул. Если сервер успел закрыть простаивавшее соединение, запрос
+// один раз повторяется по новому - когда он не был отправлен целиком или его можно повторить
+// без последствий (GET, HEAD). Отправленный POST мог уже выполниться, поэтому на него 502
+class Shard : public std::enable_shared_from_this<Shard> {
+public:
+    Shard(net::io_context& ioc, std::string address)
+        : ioc_{ioc}
+        , address_{std::move(address)} {
+        const size_t colon = address_.rfind(':');
+        if (colon == std::string::npos) {
+            throw std::invalid_argument("shard address must be host:port: "s + address_);
+        }
+        tcp::resolver resolver{ioc};
+        endpoints_ = resolver.resolve(address_.substr(0, colon), address_.substr(colon + 1));
+    }
+
+    const std::string& GetAddress() const {
+        return address_;
+    }
+
+    void Send(StringRequest request, ResponseHandler handler) {
+        auto exchange = std::make_shared<Exchange>(shared_from_this(), std::move(request), std::move(handler));
+        if (auto stream = TakeIdle()) {
+            exchange->stream.emplace(std::move(*stream));
+            exchange->reused = true;
+            exchange->Write();
+        } else {
+            exchange->Connect();
+        }
+    }
+
+    // Синхронный запрос для начальной настройки маршрутизатора
+    StringResponse Fetch(StringRequest request) {
+        beast::tcp_stream stream{ioc_};
+        stream.expires_after(TIMEOUT);
+        stream.connect(endpoints_);
+        http::write(stream, request);
+
+        beast::flat_buffer buffer;
+        StringResponse response;
+        http::read(stream, buffer, response);
+        return response;
+    }
+
+private:
+    static constexpr auto TIMEOUT = 5s;
+    static constexpr size_t MAX_IDLE = 64;
+
+    struct Exchange : std::enable_shared_from_this<Exchange> {
+        Exchange(std::shared_ptr<Shard> shard, StringRequest request, ResponseHandler handler)
+            : shard{std::move(shard)}
+            , request{std::move(request)}
+            , handler{std::move(handler)} {
+        }
+
+        void Connect() {
+            // Таймер и операции соединения не должны выполняться параллельно на разных потоках
+            stream.emplace(net::make_strand(shard->ioc_));
+            stream->expires_after(TIMEOUT);
+            stream->async_connect(shard->endpoints_, [self = shared_from_this()](beast::error_code ec, const tcp::endpoint&) {
+                if (ec) {
+                    return self->Fail(ec);
+                }
+                self->Write();
+            });
+        }
+
+        void Write() {
+            stream->expires_after(TIMEOUT);
+            http::async_write(*stream, request, [self = shared_from_this()](beast::error_code ec, size_t) {
+                if (ec) {
+                    return self->Fail(ec);
+                }
+                self->written = true;
+                self->Read();
+            });
+        }
+
+        void Read() {
+            response.emplace();
+            http::async_read(*stream, buffer, *response, [self = shared_from_this()](beast::error_code ec, size_t) {
+                if (ec) {
+                    return self->Fail(ec);
+                }
+                if (self->response->keep_alive()) {
+                    self->shard->PutIdle(std::move(*self->stream));
+                }
+                self->handler(std::move(*self->response));
+            });
+        }
+
+        void Fail(beast::error_code ec) {
+            if (reused && (!written || IsIdempotent(request.method()))) {
+                reused = false;
+                written = false;
+                buffer.clear();
+                return Connect();
+            }
+            http_server::ReportError(ec, "shard "s + shard->address_);
+            handler(MakeError(http::status::bad_gateway, "badGateway"sv, "Shard "s + shard->address_ + " is unavailable"s));
+        }
+
+        std::shared_ptr<Shard> shard;
+        StringRequest request;
+        ResponseHandler handler;
+        std::optional<beast::tcp_stream> stream;
+        beast::flat_buffer buffer;
+        std::optional<StringResponse> response;
+        bool reused = false;
+        bool written = false;
+    };
+
+    static bool IsIdempotent(http::verb method) {
+        return method == http::verb::get || method == http::verb::head;
+    }
+
+    std::optional<beast::tcp_stream> TakeIdle() {
+        std::lock_guard lock{mutex_};
+        if (idle_.empty()) {
+            return std::nullopt;
+        }
+        beast::tcp_stream stream = std::move(idle_.back());
+        idle_.pop_back();
+        return stream;
+    }
+
+    void PutIdle(beast::tcp_stream&& stream) {
+        stream.expires_never();
+        std::lock_guard lock{mutex_};
+        if (idle_.size() < MAX_IDLE) {
+            idle_.push_back(std::move(stream));
+        }
+    }
+
+    net::io_context& ioc_;
+    std::string address_;
+    tcp::resolver::results_type endpoints_;
+
+    std::mutex mutex_;
+    std::vector<beast::tcp_stream> idle_;
+};
+
+// Собирает ответы всех шардов и отдаёт результат combine, когда пришёл последний
+class Gather : public std::enable_shared_from_this<Gather> {
+public:
+    using Combine = std::function<StringResponse(std::vector<StringResponse>&)>;
+
+    Gather(size_t count, Combine combine, ResponseHandler handler)
+        : responses_(count)
+        , remaining_{count}
+        , combine_{std::move(combine)}
+        , handler_{std::move(handler)} {
+    }
+
+    ResponseHandler Slot(size_t index) {
+        return [self = shared_from_this(), index](StringResponse response) {
+            self->responses_[index] = std::move(response);
+            if (self->remaining_.fetch_sub(1) == 1) {
+                self->handler_(self->combine_(self->responses_));
+            }
+        };
+    }
+
+private:
+    std::vector<StringResponse> responses_;
+    std::atomic<size_t> remaining_;
+    Combine combine_;
+    ResponseHandler handler_;
+};
+
+class Router {
+public:
+    Router(net::io_context& ioc, const std::vector<std::string>& addresses, std::string admin_token = {})
+        : admin_access_{std::move(admin_token)} {
+        for (const auto& address : addresses) {
+            shards_.push_back(std::make_shared<Shard>(ioc, address));
+        }
+    }
+
+    // Запрашивает у каждого шарда его карты. Таблица карт не меняется до перезапуска маршрутизатора
+    void LoadMapTable() {
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            StringRequest request{http::verb::get, "/api/v1/maps"sv, 11};
+            request.set(http::field::host, shards_[i]->GetAddress());
+            const StringResponse response = shards_[i]->Fetch(std::move(request));
+            if (response.result() != http::status::ok) {
+                throw std::runtime_error("can't get maps from shard "s + shards_[i]->GetAddress());
+            }
+
+            for (const auto& map : json::parse(response.body()).as_array()) {
+                std::string id = map.at("id").as_string().c_str();
+                if (auto [it, inserted] = map_to_shard_.emplace(id, i); !inserted) {
+                    throw std::runtime_error("map "s + id + " is served by shards "s + std::to_string(it->second)
+                        + " and "s + std::to_string(i));
+                }
+            }
+        }
+    }
+
+    size_t GetMapCount() const {
+        return map_to_shard_.size();
+    }
+
+    template <typename Send>
+    void operator()(http_server::HttpRequest&& req, Send&& send, const tcp::endpoint& remote_endpoint) {
+        const unsigned version = req.version();
+        const bool keep_alive = req.keep_alive();
+
+        // Шард видит маршрутизатор как клиента с loopback, поэтому доступ к /admin проверяется здесь,
+        // по адресу настоящего клиента
+        if (req.target().starts_with("/admin/"sv)) {
+            std::optional<std::string_view> authorization;
+            if (auto it = req.find(http::field::authorization); it != req.end()) {
+                authorization = it->value();
+            }
+            if (auto verdict = admin_access_.Check(authorization, remote_endpoint.address());
+                verdict != http_handler::AdminAccess::Verdict::ALLOWED) {
+                StringResponse response = verdict == http_handler::AdminAccess::Verdict::UNAUTHORIZED
+                    ? MakeError(http::status::unauthorized, "invalidToken"sv, "Admin token is missing or invalid"sv)
+                    : MakeError(http::status::forbidden, "forbidden"sv, "Admin endpoints are available only from loopback"sv);
+                response.version(version);
+                response.keep_alive(keep_alive);
+                return send(std::move(response));
+            }
+        }
+        StringRequest request = MakeUpstreamRequest(req);
+
+        ResponseHandler reply = [send = std::forward<Send>(send), version, keep_alive](StringResponse response) {
+            response.version(version);
+            response.keep_alive(keep_alive);
+            send(std::move(response));
+        };
+
+        const std::string_view target = request.target().substr(0, request.target().find('?'));
+        if (target == "/api/v1/maps"sv) {
+            return Broadcast(std::move(request), MergeMaps, std::move(reply));
+        }
+        if (target == "/api/v1/game/tick"sv) {
+            return Broadcast(std::move(request), FirstError, std::move(reply));
+        }
+
+        const std::optional<size_t> shard = FindShard(request, target);
+        if (!shard.has_value()) {
+            return reply(MakeError(http::status::not_found, "mapNotFound"sv, "Map not found"sv));
+        }
+        shards_[*shard]->Send(std::move(request), std::move(reply));
+    }
+
+private:
+    static StringRequest MakeUpstreamRequest(const http_server::HttpRequest& req) {
+        StringRequest request{req.method(), req.target(), 11};
+        for (const auto& field : req) {
+            request.set(field.name_string(), field.value());
+        }
+        request.body().assign(req.body().data(), req.body().size());
+        // С шардами всегда держим соединение открытым, независимо от клиента
+        request.keep_alive(true);
+        request.prepare_payload();
+        return request;
+    }
+
+    // nullopt - карта не обслуживается ни одним шардом
+    std::optional<size_t> FindShard(const StringRequest& request, std::string_view target) const {
+        constexpr std::string_view map_prefix = "/api/v1/maps/"sv;
+        if (target.starts_with(map_prefix)) {
+            return FindMapShard(target.substr(map_prefix.size()));
+        }
+
+        if (target == "/api/v1/game/join"sv) {
+            boost::system::error_code ec;
+            const json::value body = json::parse(request.body(), ec);
+            if (!ec && body.is_object() && body.as_object().contains("mapId") && body.at("mapId").is_string()) {
+                return FindMapShard(body.at("mapId").as_string().c_str());
+            }
+            // Некорректный запрос: ошибку в нужном формате вернёт сам сервер
+            return 0;
+        }
+
+        if (target.starts_with("/api/v1/game/"sv)) {
+            if (auto it = request.find(http::field::authorization); it != request.end()) {
+                const std::string_view authorization = it->value();
+                const std::string_view token = authorization.substr(authorization.find_last_of(' ') + 1);
+                if (auto shard = model::ParseShardTag(token); shard.has_value() && *shard < shards_.size()) {
+                    return *shard;
+                }
+            }
+            // Без токена или с чужим токеном ответит 401 любой шард
+            return 0;
+        }
+        return 0;
+    }
+
+    std::optional<size_t> FindMapShard(std::string_view map_id) const {
+        if (auto it = map_to_shard_.find(std::string(map_id)); it != map_to_shard_.end()) {
+            return it->second;
+        }
+        return std::nullopt;
+    }
+
+    void Broadcast(StringRequest request, Gather::Combine combine, ResponseHandler reply) {
+        auto gather = std::make_shared<Gather>(shards_.size(), std::move(combine), std::move(reply));
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            shards_[i]->Send(request, gather->Slot(i));
+        }
+    }
+
+    // Списки карт шардов - JSON-массивы, склеиваем их в один
+    static StringResponse MergeMaps(std::vector<StringResponse>& responses) {
+        std::string body = "["s;
+        for (const auto& response : responses) {
+            if (response.result() != http::status::ok) {
+                return response;
+            }
+            const std::string_view items = std::string_view(response.body());
+            const size_t begin = items.find('[');
+            const size_t end = items.rfind(']');
+            if (begin == std::string_view::npos || end == std::string_view::npos || end <= begin + 1) {
+                continue;
+            }
+            if (body.size() > 1) {
+                body += ',';
+            }
+            body += items.substr(begin + 1, end - begin - 1);
+        }
+        body += ']';
+
+        StringResponse merged = std::move(responses.front());
+        merged.body() = std::move(body);
+        merged.prepare_payload();
+        return merged;
+    }
+
+    // Тик успешен, если его выполнили все шарды
+    static StringResponse FirstError(std::vector<StringResponse>& responses) {
+        for (auto& response : responses) {
+            if (response.result() != http::status::ok) {
+                return std::move(response);
+            }
+        }
+        return std::move(responses.front());
+    }
+
+    std::vector<std::shared_ptr<Shard>> shards_;
+    std::unordered_map<std::string, size_t> map_to_shard_;
+    http_handler::AdminAccess admin_access_;
+};
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+    try {
+        std::optional<Args> args = ParseCommandLine(argc, argv);
+        if (!args.has_value()) {
+            return EXIT_FAILURE;
+        }
+
+        const unsigned num_threads = args->threads != 0 ? args->threads : cpu_topology::GetAvailableCpus();
+        net::io_context ioc(static_cast<int>(num_threads));
+
+        Router router{ioc, args->shards, args->admin_token};
+        router.LoadMapTable();
+
+        net::signal_set signals(ioc, SIGINT, SIGTERM);
+        signals.async_wait([&ioc](const boost::system::error_code& ec, int) {
+            if (!ec) {
+                ioc.stop();
+            }
+        });
+
+        const auto port = static_cast<net::ip::port_type>(args->port);
+        http_server::ServeHttp(ioc, {net::ip::make_address("0.0.0.0"), port}, [&router](auto&& req, auto&& send, const tcp::endpoint& remote_endpoint) {
+            router(std::forward<decltype(req)>(req), std::forward<decltype(send)>(send), remote_endpoint);
+        });
+
+        json::value custom_data{{"port"s, args->port}, {"shards"s, args->shards.size()}, {"maps"s, router.GetMapCount()}};
+        logger::LogJSON(custom_data, "router started"sv);
+
+        std::vector<std::jthread> workers;
+        for (unsigned i = 1; i < num_threads; ++i) {
+            workers.emplace_back([&ioc] {
+                ioc.run();
+            });
+        }
+        ioc.run();
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}